@@ -0,0 +1,71 @@
+#include "molcpp/box.hpp"
+
+#include <benchmark/benchmark.h>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+// What `Box::wrap` used to do on every call: find the style from the matrix,
+// then compute lengths or invert the matrix through LAPACK.
+static xt::xarray<double> wrap_uncached(const Box &box, const xt::xarray<double> &xyz)
+{
+    auto matrix = box.get_matrix();
+    switch (Box::calc_style_from_matrix(matrix))
+    {
+    case Box::ORTHOGONAL: {
+        Box::calc_style_from_matrix(matrix); // get_lengths() did it again
+        Vec3 lengths = {matrix(0, 0), matrix(1, 1), matrix(2, 2)};
+        return xyz - xt::round(xyz / lengths) * lengths;
+    }
+    case Box::TRICLINIC: {
+        auto fractional = xt::linalg::dot(xt::linalg::inv(matrix), xt::transpose(xyz));
+        return xt::transpose(xt::linalg::dot(matrix, fractional - xt::round(fractional)));
+    }
+    default:
+        return xyz;
+    }
+}
+
+static Box make_box(bool triclinic)
+{
+    return triclinic ? Box::from_lengths_angles({10, 11, 12}, {90, 80, 120}) : Box({10, 11, 12});
+}
+
+static void BM_BoxWrapUncached(benchmark::State &state)
+{
+    auto box = make_box(state.range(1));
+    xt::xarray<double> xyz = xt::random::rand<double>({static_cast<size_t>(state.range(0)), size_t{3}}, -50, 50);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(wrap_uncached(box, xyz));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_BoxWrap(benchmark::State &state)
+{
+    auto box = make_box(state.range(1));
+    xt::xarray<double> xyz = xt::random::rand<double>({static_cast<size_t>(state.range(0)), size_t{3}}, -50, 50);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(box.wrap(xyz));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_BoxGetters(benchmark::State &state)
+{
+    auto box = make_box(true);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(box.get_lengths());
+        benchmark::DoNotOptimize(box.get_angles());
+        benchmark::DoNotOptimize(box.get_volume());
+        benchmark::DoNotOptimize(box.get_distance_between_faces());
+    }
+}
+
+// args: {number of atoms, triclinic}
+BENCHMARK(BM_BoxWrapUncached)->ArgsProduct({{1, 1 << 16}, {0, 1}});
+BENCHMARK(BM_BoxWrap)->ArgsProduct({{1, 1 << 16}, {0, 1}});
+BENCHMARK(BM_BoxGetters);
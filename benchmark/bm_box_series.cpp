@@ -0,0 +1,106 @@
+#include "molcpp/box_series.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+/// Row-major matrices of a fluctuating triclinic box over `n_frames` frames
+static auto npt_matrices(size_t n_frames) -> std::vector<double>
+{
+    std::vector<double> matrices(9 * n_frames, 0.0);
+    for (size_t frame = 0; frame < n_frames; frame++)
+    {
+        const double scale = 1.0 + 0.01 * std::sin(0.1 * static_cast<double>(frame));
+        double *m = matrices.data() + 9 * frame;
+        m[0] = 30.0 * scale;
+        m[1] = 3.0 * scale;
+        m[2] = -2.0 * scale;
+        m[4] = 31.0 * scale;
+        m[5] = 4.0 * scale;
+        m[8] = 32.0 * scale;
+    }
+    return matrices;
+}
+
+// One `Box` per frame, as trajectories had to be processed
+static void BM_BoxPerFrameWrap(benchmark::State &state)
+{
+    const auto n_frames = static_cast<size_t>(state.range(0));
+    const auto n_atoms = static_cast<size_t>(state.range(1));
+    auto matrices = npt_matrices(n_frames);
+    xt::xarray<double> xyz = xt::random::rand<double>({n_frames, n_atoms, size_t{3}}, -50, 50);
+    for (auto _ : state)
+    {
+        for (size_t frame = 0; frame < n_frames; frame++)
+        {
+            Mat3 matrix;
+            std::copy_n(matrices.data() + 9 * frame, 9, matrix.begin());
+            Box box(matrix);
+            box.wrap_inplace(xyz.data() + 3 * n_atoms * frame, n_atoms);
+        }
+        benchmark::DoNotOptimize(xyz.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+static void BM_BoxSeriesWrap(benchmark::State &state)
+{
+    const auto n_frames = static_cast<size_t>(state.range(0));
+    const auto n_atoms = static_cast<size_t>(state.range(1));
+    auto matrices = npt_matrices(n_frames);
+    xt::xarray<double> xyz = xt::random::rand<double>({n_frames, n_atoms, size_t{3}}, -50, 50);
+    for (auto _ : state)
+    {
+        BoxSeries series(matrices.data(), n_frames);
+        series.wrap_inplace(xyz.data(), 0, n_frames, n_atoms, {static_cast<size_t>(state.range(2))});
+        benchmark::DoNotOptimize(xyz.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+// Construction and volumes alone, where the per-frame `Box` pays its LAPACK
+// determinant and cached lengths and angles
+static void BM_BoxPerFrameVolume(benchmark::State &state)
+{
+    const auto n_frames = static_cast<size_t>(state.range(0));
+    auto matrices = npt_matrices(n_frames);
+    std::vector<double> volumes(n_frames);
+    for (auto _ : state)
+    {
+        for (size_t frame = 0; frame < n_frames; frame++)
+        {
+            Mat3 matrix;
+            std::copy_n(matrices.data() + 9 * frame, 9, matrix.begin());
+            volumes[frame] = Box(matrix).get_volume();
+        }
+        benchmark::DoNotOptimize(volumes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_BoxSeriesVolume(benchmark::State &state)
+{
+    const auto n_frames = static_cast<size_t>(state.range(0));
+    auto matrices = npt_matrices(n_frames);
+    std::vector<double> volumes(n_frames);
+    for (auto _ : state)
+    {
+        BoxSeries series(matrices.data(), n_frames);
+        series.volumes(volumes.data());
+        benchmark::DoNotOptimize(volumes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_BoxPerFrameWrap)->Args({1000, 100})->Args({100, 10000})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BoxSeriesWrap)
+    ->Args({1000, 100, 1})
+    ->Args({100, 10000, 1})
+    ->Args({100, 10000, 0})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BoxPerFrameVolume)->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BoxSeriesVolume)->Arg(10000)->Unit(benchmark::kMicrosecond);
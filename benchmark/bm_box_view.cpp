@@ -0,0 +1,79 @@
+#include "molcpp/box_view.hpp"
+
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+static Box make_box(bool triclinic)
+{
+    return triclinic ? Box::from_lengths_angles({10, 11, 12}, {90, 80, 120}) : Box({10, 11, 12});
+}
+
+// Minimum-image distances with the runtime-dispatched kernel of `Box`
+static void BM_BoxMicDistances(benchmark::State &state)
+{
+    const auto n = static_cast<size_t>(state.range(0));
+    auto box = make_box(state.range(1));
+    xt::xarray<double> ri = xt::random::rand<double>({size_t{3}, n}, -50, 50);
+    xt::xarray<double> rj = xt::random::rand<double>({size_t{3}, n}, -50, 50);
+    std::vector<double> r2(n);
+    for (auto _ : state)
+    {
+        box.mic_distances2({ri.data(), ri.data() + n, ri.data() + 2 * n}, {rj.data(), rj.data() + n, rj.data() + 2 * n},
+                           n, r2.data());
+        benchmark::DoNotOptimize(r2.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// The same distances through a view, dispatching once per batch
+template <typename T> static void BM_BoxViewMicDistances(benchmark::State &state)
+{
+    const auto n = static_cast<size_t>(state.range(0));
+    auto box = make_box(state.range(1));
+    xt::xarray<T> ri = xt::random::rand<double>({size_t{3}, n}, -50, 50);
+    xt::xarray<T> rj = xt::random::rand<double>({size_t{3}, n}, -50, 50);
+    std::vector<T> r2(n);
+    for (auto _ : state)
+    {
+        visit_box<T>(box, [&](const auto &view) {
+            view.mic_distances2({ri.data(), ri.data() + n, ri.data() + 2 * n},
+                                {rj.data(), rj.data() + n, rj.data() + 2 * n}, n, r2.data());
+        });
+        benchmark::DoNotOptimize(r2.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_BoxWrapXarray(benchmark::State &state)
+{
+    auto box = make_box(state.range(1));
+    xt::xarray<double> xyz = xt::random::rand<double>({static_cast<size_t>(state.range(0)), size_t{3}}, -50, 50);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(box.wrap(xyz));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename T> static void BM_BoxViewWrap(benchmark::State &state)
+{
+    const auto n = static_cast<size_t>(state.range(0));
+    auto box = make_box(state.range(1));
+    xt::xarray<T> xyz = xt::random::rand<double>({n, size_t{3}}, -50, 50);
+    for (auto _ : state)
+    {
+        visit_box<T>(box, [&](const auto &view) { view.wrap_inplace(xyz.data(), n); });
+        benchmark::DoNotOptimize(xyz.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_BoxMicDistances)->Args({1 << 16, 0})->Args({1 << 16, 1});
+BENCHMARK(BM_BoxViewMicDistances<double>)->Args({1 << 16, 0})->Args({1 << 16, 1});
+BENCHMARK(BM_BoxViewMicDistances<float>)->Args({1 << 16, 0})->Args({1 << 16, 1});
+BENCHMARK(BM_BoxWrapXarray)->Args({1 << 16, 0})->Args({1 << 16, 1});
+BENCHMARK(BM_BoxViewWrap<double>)->Args({1 << 16, 0})->Args({1 << 16, 1});
+BENCHMARK(BM_BoxViewWrap<float>)->Args({1 << 16, 0})->Args({1 << 16, 1});
@@ -0,0 +1,100 @@
+#include "molcpp/engine.hpp"
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+static constexpr size_t N_ATOMS = 50000;
+static constexpr size_t N_FRAMES = 20;
+static constexpr double LENGTH = 80.0;
+
+/// Trajectory of random walkers, written once for all benchmarks
+static auto trajectory_path() -> std::string
+{
+    static const std::string path = []() {
+        auto path = (std::filesystem::temp_directory_path() / "molcpp_bm_engine.moltraj").string();
+        xt::random::seed(42);
+        xt::xarray<double> xyz = xt::random::rand<double>({N_ATOMS, size_t{3}}) * LENGTH;
+        BinaryTrajectoryWriter writer(path, N_ATOMS);
+        for (size_t frame = 0; frame < N_FRAMES; frame++)
+        {
+            xyz += xt::random::randn<double>({N_ATOMS, size_t{3}}) * 0.1;
+            writer.write(xyz, Box({LENGTH, LENGTH, LENGTH}));
+        }
+        return path;
+    }();
+    return path;
+}
+
+static auto atom_types() -> std::vector<int>
+{
+    std::vector<int> types(N_ATOMS);
+    for (size_t i = 0; i < N_ATOMS; i++)
+    {
+        types[i] = static_cast<int>(i % 2);
+    }
+    return types;
+}
+
+/// The analyses run by both benchmarks
+struct Analyses
+{
+    RDFCompute rdf{10.0, 200};
+    RDFCompute rdf_01{8.0, 160};
+    RDFCompute rdf_11{8.0, 160};
+    StreamingMSDCompute msd;
+
+    Analyses()
+    {
+        rdf_01.select_pair(0, 1);
+        rdf_11.select_pair(1, 1);
+    }
+};
+
+// One pass over the trajectory per analysis, each reading every frame and
+// building its own neighbor list
+static void BM_SeparatePasses(benchmark::State &state)
+{
+    BinaryTrajectory trajectory(trajectory_path());
+    for (auto _ : state)
+    {
+        Analyses analyses;
+        auto run = [&](auto &compute) {
+            ComputeEngine engine;
+            engine.set_types(atom_types());
+            engine.add(compute);
+            engine.run(trajectory);
+        };
+        run(analyses.rdf);
+        run(analyses.rdf_01);
+        run(analyses.rdf_11);
+        run(analyses.msd);
+        benchmark::DoNotOptimize(analyses.msd.n_frames());
+    }
+    state.SetItemsProcessed(state.iterations() * N_FRAMES);
+}
+
+// A single pass, sharing reads and the neighbor list between analyses
+static void BM_FusedPass(benchmark::State &state)
+{
+    BinaryTrajectory trajectory(trajectory_path());
+    for (auto _ : state)
+    {
+        Analyses analyses;
+        ComputeEngine engine;
+        engine.set_types(atom_types());
+        engine.add(analyses.rdf);
+        engine.add(analyses.rdf_01);
+        engine.add(analyses.rdf_11);
+        engine.add(analyses.msd);
+        engine.run(trajectory);
+        benchmark::DoNotOptimize(analyses.msd.n_frames());
+        state.counters["shared_s"] = engine.get_shared_time();
+    }
+    state.SetItemsProcessed(state.iterations() * N_FRAMES);
+}
+
+BENCHMARK(BM_SeparatePasses)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FusedPass)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,37 @@
+#include "molcpp/box.hpp"
+#include "molcpp/simd.hpp"
+
+#include <benchmark/benchmark.h>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+// args: {number of pairs, triclinic, simd level}
+template <typename T> static void BM_MicDistances2(benchmark::State &state)
+{
+    auto n = static_cast<size_t>(state.range(0));
+    auto box = state.range(1) ? Box::from_lengths_angles({30, 31, 32}, {70, 80, 120}) : Box({30, 31, 32});
+    set_simd_level(static_cast<SimdLevel>(state.range(2)));
+    if (get_simd_level() != static_cast<SimdLevel>(state.range(2)))
+    {
+        state.SkipWithError("instruction set not supported by this CPU");
+    }
+
+    xt::xarray<T> ri = xt::random::rand<T>({size_t{3}, n}, -50, 50);
+    xt::xarray<T> rj = xt::random::rand<T>({size_t{3}, n}, -50, 50);
+    xt::xarray<T> r2 = xt::zeros<T>({n});
+    SoA3<const T> pi{&ri(0, 0), &ri(1, 0), &ri(2, 0)};
+    SoA3<const T> pj{&rj(0, 0), &rj(1, 0), &rj(2, 0)};
+    for (auto _ : state)
+    {
+        box.mic_distances2(pi, pj, n, r2.data());
+        benchmark::DoNotOptimize(r2.data());
+        benchmark::ClobberMemory();
+    }
+    state.counters["pairs/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * n), benchmark::Counter::kIsRate);
+    set_simd_level(detect_simd_level());
+}
+
+BENCHMARK(BM_MicDistances2<double>)->ArgsProduct({{1 << 12, 1 << 20}, {0, 1}, {0, 1, 2}});
+BENCHMARK(BM_MicDistances2<float>)->ArgsProduct({{1 << 12, 1 << 20}, {0, 1}, {0, 1, 2}});
@@ -0,0 +1,84 @@
+#include "molcpp/compute.hpp"
+#include "molcpp/fft.hpp"
+
+#include <benchmark/benchmark.h>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+// Windowed MSD of a single atom, the unit of work of MSDCompute. A full
+// 10^5 frames x 10^4 atoms run costs 10^4 times this (and 24 GB of input).
+static void BM_WindowMSDKernel(benchmark::State &state)
+{
+    auto n_frames = static_cast<size_t>(state.range(0));
+    xt::xarray<double> xyz = xt::cumsum(xt::random::randn<double>({n_frames, size_t{3}}), 0);
+    std::vector<double> msd(n_frames);
+
+    WindowMSDKernel kernel(n_frames);
+    for (auto _ : state)
+    {
+        kernel.compute(xyz.data(), 3, msd.data());
+        benchmark::DoNotOptimize(msd.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Direct O(T^2) average over time origins, for comparison
+static void BM_WindowMSDNaive(benchmark::State &state)
+{
+    auto n_frames = static_cast<size_t>(state.range(0));
+    xt::xarray<double> xyz = xt::cumsum(xt::random::randn<double>({n_frames, size_t{3}}), 0);
+    std::vector<double> msd(n_frames);
+
+    for (auto _ : state)
+    {
+        for (size_t lag = 0; lag < n_frames; lag++)
+        {
+            double sum = 0;
+            for (size_t t = 0; t + lag < n_frames; t++)
+            {
+                for (size_t d = 0; d < 3; d++)
+                {
+                    double delta = xyz(t + lag, d) - xyz(t, d);
+                    sum += delta * delta;
+                }
+            }
+            msd[lag] = sum / static_cast<double>(n_frames - lag);
+        }
+        benchmark::DoNotOptimize(msd.data());
+    }
+}
+
+static void BM_MSDComputeWindow(benchmark::State &state)
+{
+    auto n_frames = static_cast<size_t>(state.range(0));
+    auto n_atoms = static_cast<size_t>(state.range(1));
+    xt::xarray<double> xyz = xt::cumsum(xt::random::randn<double>({n_frames, n_atoms, size_t{3}}), 0);
+
+    MSDCompute msd(MSDCompute::MSDStyle::WINDOW);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(msd.compute(xyz));
+    }
+    state.SetItemsProcessed(state.iterations() * n_atoms);
+}
+
+static void BM_MSDComputeWindowThreads(benchmark::State &state)
+{
+    auto n_threads = static_cast<size_t>(state.range(0));
+    xt::xarray<double> xyz = xt::cumsum(xt::random::randn<double>({size_t{10000}, size_t{1000}, size_t{3}}), 0);
+
+    MSDCompute msd(MSDCompute::MSDStyle::WINDOW, false, {n_threads});
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(msd.compute(xyz));
+    }
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+BENCHMARK(BM_WindowMSDKernel)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WindowMSDNaive)->RangeMultiplier(10)->Range(1000, 10000)->Unit(benchmark::kMillisecond);
+// args: {frames, atoms}
+BENCHMARK(BM_MSDComputeWindow)->Args({1000, 10000})->Args({100000, 100})->Unit(benchmark::kMillisecond);
+// 10^4 frames of 10^3 atoms, by number of threads
+BENCHMARK(BM_MSDComputeWindowThreads)->RangeMultiplier(2)->Range(1, 128)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,76 @@
+#include "molcpp/box.hpp"
+#include "molcpp/neighbor.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+// Atoms at liquid-like density (0.1 / Å^3) in a cubic or triclinic box,
+// with a 3 Å cutoff (~11 neighbors per atom)
+static void BM_CellListBuild(benchmark::State &state)
+{
+    auto n = static_cast<size_t>(state.range(0));
+    double length = std::cbrt(static_cast<double>(n) / 0.1);
+    auto box = state.range(1) ? Box::from_lengths_angles({length, length, length}, {80, 85, 100})
+                              : Box({length, length, length});
+    xt::xarray<double> xyz = xt::random::rand<double>({n, size_t{3}}, -length / 2, length / 2);
+
+    CellList cells(3.0);
+    NeighborList list;
+    for (auto _ : state)
+    {
+        cells.build(xyz.data(), n, box, list);
+        benchmark::DoNotOptimize(list.indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.counters["pairs/atom"] = static_cast<double>(list.n_pairs()) / static_cast<double>(n);
+    state.counters["bytes/atom"] = static_cast<double>(list.memory_usage()) / static_cast<double>(n);
+}
+
+static void BM_CellListBuildFree(benchmark::State &state)
+{
+    auto n = static_cast<size_t>(state.range(0));
+    double length = std::cbrt(static_cast<double>(n) / 0.1);
+    xt::xarray<double> xyz = xt::random::rand<double>({n, size_t{3}}, -length / 2, length / 2);
+
+    CellList cells(3.0);
+    NeighborList list;
+    for (auto _ : state)
+    {
+        cells.build(xyz.data(), n, Box(), list);
+        benchmark::DoNotOptimize(list.indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.counters["bytes/atom"] = static_cast<double>(list.memory_usage()) / static_cast<double>(n);
+}
+
+// Strong scaling of a build, from a small system where waking the threads
+// matters to 4M atoms
+static void BM_CellListBuildThreads(benchmark::State &state)
+{
+    auto n = static_cast<size_t>(state.range(0));
+    double length = std::cbrt(static_cast<double>(n) / 0.1);
+    auto box = Box({length, length, length});
+    xt::xarray<double> xyz = xt::random::rand<double>({n, size_t{3}}, -length / 2, length / 2);
+
+    CellList cells(3.0);
+    cells.set_n_threads(static_cast<size_t>(state.range(1)));
+    NeighborList list;
+    for (auto _ : state)
+    {
+        cells.build(xyz.data(), n, box, list);
+        benchmark::DoNotOptimize(list.indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// args: {number of atoms, triclinic}
+BENCHMARK(BM_CellListBuild)->ArgsProduct({{1 << 12, 1 << 16, 1 << 20, 1 << 23}, {0, 1}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CellListBuildFree)->RangeMultiplier(16)->Range(1 << 12, 1 << 20)->Unit(benchmark::kMillisecond);
+// args: {number of atoms, number of threads}
+BENCHMARK(BM_CellListBuildThreads)
+    ->ArgsProduct({{1 << 12, 1 << 22}, benchmark::CreateRange(1, 128, 2)})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
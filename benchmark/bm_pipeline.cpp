@@ -0,0 +1,70 @@
+#include "molcpp/compute.hpp"
+#include "molcpp/pipeline.hpp"
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+static constexpr size_t N_ATOMS = 100000;
+static constexpr size_t N_FRAMES = 200;
+
+/// float32 trajectory of random walkers, written once for all benchmarks
+static auto trajectory_path() -> std::string
+{
+    static const std::string path = []() {
+        auto path = (std::filesystem::temp_directory_path() / "molcpp_bm_pipeline.moltraj").string();
+        xt::xarray<double> xyz = xt::random::rand<double>({N_ATOMS, size_t{3}}) * 50.0;
+        BinaryTrajectoryWriter writer(path, N_ATOMS, BinaryTrajectory::Precision::FLOAT32);
+        for (size_t frame = 0; frame < N_FRAMES; frame++)
+        {
+            xyz += xt::random::randn<double>({N_ATOMS, size_t{3}}) * 0.1;
+            writer.write(xyz, Box({50, 50, 50}));
+        }
+        return path;
+    }();
+    return path;
+}
+
+// Read a frame, then hand it to the MSD, one after the other
+static void BM_SerialReadCompute(benchmark::State &state)
+{
+    BinaryTrajectory trajectory(trajectory_path());
+    std::vector<double> xyz(3 * N_ATOMS);
+    for (auto _ : state)
+    {
+        StreamingMSDCompute msd;
+        for (size_t frame = 0; frame < N_FRAMES; frame++)
+        {
+            Box box = trajectory.read(frame, xyz.data());
+            msd.push_frame(xyz.data(), N_ATOMS, box);
+        }
+        benchmark::DoNotOptimize(msd.n_frames());
+    }
+    state.SetItemsProcessed(state.iterations() * N_FRAMES);
+}
+
+// Same work, with frames read ahead by the pipeline. args: {depth, readers}
+static void BM_PipelineReadCompute(benchmark::State &state)
+{
+    BinaryTrajectory trajectory(trajectory_path());
+    FramePipeline pipeline(trajectory, static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+    StreamingMSDCompute *msd = nullptr;
+    pipeline.add_consumer([&](const FrameBuffer &frame) { msd->push_frame(frame.xyz.data(), N_ATOMS, frame.box); });
+    for (auto _ : state)
+    {
+        StreamingMSDCompute current;
+        msd = &current;
+        pipeline.run();
+        benchmark::DoNotOptimize(current.n_frames());
+    }
+    const auto &stats = pipeline.get_stats();
+    state.counters["io_wait_s"] = stats.io_wait_time;
+    state.counters["compute_s"] = stats.compute_time[0];
+    state.counters["read_s"] = stats.read_time;
+    state.SetItemsProcessed(state.iterations() * N_FRAMES);
+}
+
+BENCHMARK(BM_SerialReadCompute)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PipelineReadCompute)->Args({1, 1})->Args({4, 1})->Args({4, 2})->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,100 @@
+#include "molcpp/types.hpp"
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+using namespace molcpp;
+
+static constexpr size_t N_ENTITIES = 100000;
+
+/// The string-keyed store which `Property` replaced, kept as a baseline
+template <typename... Args> class StringProperty
+{
+  public:
+    template <typename T> void set(std::string key, T value)
+    {
+        _data[key] = value;
+    }
+
+    template <typename T> const T get(std::string key)
+    {
+        return std::get<T>(_data[key]);
+    }
+
+  private:
+    std::unordered_map<std::string, std::variant<Args...>> _data;
+};
+
+template <typename Store> static auto make_entities() -> std::vector<Store>
+{
+    std::vector<Store> entities(N_ENTITIES);
+    for (size_t i = 0; i < N_ENTITIES; i++)
+    {
+        entities[i].template set<double>("charge", 0.1 * static_cast<double>(i % 7));
+        entities[i].template set<double>("mass", 12.0);
+        entities[i].template set<int>("type", static_cast<int>(i % 3));
+        entities[i].template set<std::string>("name", "C");
+    }
+    return entities;
+}
+
+// Sum a property over all entities, looking it up by string
+static void BM_StringPropertyGet(benchmark::State &state)
+{
+    auto entities = make_entities<StringProperty<int, double, std::string>>();
+    for (auto _ : state)
+    {
+        double sum = 0;
+        for (auto &entity : entities)
+        {
+            sum += entity.get<double>("charge");
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * N_ENTITIES);
+}
+
+// Same sum, with an interned key resolved once
+static void BM_PropertyGet(benchmark::State &state)
+{
+    auto entities = make_entities<Property<int, double, std::string>>();
+    const Key charge("charge");
+    for (auto _ : state)
+    {
+        double sum = 0;
+        for (const auto &entity : entities)
+        {
+            sum += entity.get<double>(charge);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * N_ENTITIES);
+}
+
+// Same sum over a column holding the property of every entity
+static void BM_PropertyColumnsSum(benchmark::State &state)
+{
+    PropertyColumns<int, double> columns(N_ENTITIES);
+    auto charges = columns.add_column<double>(keys::CHARGE);
+    for (size_t i = 0; i < N_ENTITIES; i++)
+    {
+        charges[i] = 0.1 * static_cast<double>(i % 7);
+    }
+    for (auto _ : state)
+    {
+        double sum = 0;
+        for (double charge : columns.column<double>(keys::CHARGE))
+        {
+            sum += charge;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * N_ENTITIES);
+}
+
+BENCHMARK(BM_StringPropertyGet);
+BENCHMARK(BM_PropertyGet);
+BENCHMARK(BM_PropertyColumnsSum);
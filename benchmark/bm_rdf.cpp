@@ -0,0 +1,30 @@
+#include "molcpp/compute.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+// g(r) of one frame of uniform positions at liquid density. args: {atoms, threads}
+static void BM_RDFFrame(benchmark::State &state)
+{
+    const auto n_atoms = static_cast<size_t>(state.range(0));
+    const double length = std::cbrt(static_cast<double>(n_atoms) / 0.1);
+    xt::random::seed(42);
+    xt::xarray<double> xyz = xt::random::rand<double>({n_atoms, size_t{3}}, 0, length);
+    Box box({length, length, length});
+    RDFCompute rdf(std::min(10.0, length / 2), 200, {static_cast<size_t>(state.range(1))});
+    for (auto _ : state)
+    {
+        rdf.push_frame(xyz, box);
+    }
+    benchmark::DoNotOptimize(rdf.get_pair_counts());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n_atoms));
+}
+
+BENCHMARK(BM_RDFFrame)
+    ->ArgsProduct({{10000, 100000, 1000000}, {1, 4}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,74 @@
+#include "molcpp/region.hpp"
+#include "molcpp/simd.hpp"
+
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+static auto positions(size_t n) -> xt::xarray<double>
+{
+    xt::random::seed(42);
+    return xt::random::rand<double>({n, size_t{3}}, -50, 50);
+}
+
+// The selection through xarray temporaries, as `isin` callers had to write
+static void BM_RegionSphereXarray(benchmark::State &state)
+{
+    const auto n = static_cast<size_t>(state.range(0));
+    auto xyz = positions(n);
+    Vec3 center = {1, 2, 3};
+    for (auto _ : state)
+    {
+        xt::xarray<double> d = xyz - center;
+        xt::xarray<bool> mask = xt::sum(d * d, {1}) < 400.0;
+        benchmark::DoNotOptimize(mask.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Bitmask of a sphere, at each instruction set
+static void BM_RegionSphereBits(benchmark::State &state)
+{
+    const auto n = static_cast<size_t>(state.range(0));
+    auto xyz = positions(n);
+    Sphere sphere({1, 2, 3}, 20.0);
+    std::vector<uint64_t> bits((n + 63) / 64);
+    set_simd_level(static_cast<SimdLevel>(state.range(1)));
+    for (auto _ : state)
+    {
+        sphere.select(xyz.data(), n, bits.data());
+        benchmark::DoNotOptimize(bits.data());
+    }
+    set_simd_level(detect_simd_level());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Indices of the atoms both in a slab and in a cylinder, through the
+// bitmask of their intersection
+static void BM_RegionIntersectionIndices(benchmark::State &state)
+{
+    const auto n = static_cast<size_t>(state.range(0));
+    auto xyz = positions(n);
+    Intersection region({std::make_shared<Slab>(Vec3{0, 0, 1}, -10.0, 10.0),
+                         std::make_shared<Cylinder>(Vec3{0, 0, 0}, Vec3{0, 0, 1}, 25.0)});
+    std::vector<uint32_t> indices;
+    indices.reserve(n);
+    for (auto _ : state)
+    {
+        indices.clear();
+        region.select_indices(xyz.data(), n, indices);
+        benchmark::DoNotOptimize(indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_RegionSphereXarray)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RegionSphereBits)
+    ->Args({1 << 20, static_cast<int64_t>(SimdLevel::SCALAR)})
+    ->Args({1 << 20, static_cast<int64_t>(SimdLevel::AVX2)})
+    ->Args({1 << 20, static_cast<int64_t>(SimdLevel::AVX512)})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RegionIntersectionIndices)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
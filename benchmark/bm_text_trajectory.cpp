@@ -0,0 +1,65 @@
+#include "molcpp/trajectory.hpp"
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace molcpp;
+
+static constexpr size_t N_ATOMS = 100000;
+static constexpr size_t N_FRAMES = 50;
+
+/// LAMMPS dump of random positions, written once for all benchmarks
+static auto dump_path() -> std::string
+{
+    static const std::string path = []() {
+        auto path = (std::filesystem::temp_directory_path() / "molcpp_bm_text.lammpstrj").string();
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> uniform(0.0, 50.0);
+        std::ofstream file(path);
+        file.precision(8);
+        for (size_t frame = 0; frame < N_FRAMES; frame++)
+        {
+            file << "ITEM: TIMESTEP\n" << frame * 1000 << "\nITEM: NUMBER OF ATOMS\n" << N_ATOMS << "\n";
+            file << "ITEM: BOX BOUNDS pp pp pp\n0 50\n0 50\n0 50\nITEM: ATOMS id type xu yu zu\n";
+            for (size_t i = 0; i < N_ATOMS; i++)
+            {
+                file << i + 1 << " 1 " << uniform(rng) << " " << uniform(rng) << " " << uniform(rng) << "\n";
+            }
+        }
+        return path;
+    }();
+    return path;
+}
+
+// Build the frame index without the sidecar file. args: {threads}
+static void BM_LAMMPSDumpScan(benchmark::State &state)
+{
+    const auto path = dump_path();
+    const ExecutionPolicy policy{static_cast<size_t>(state.range(0))};
+    for (auto _ : state)
+    {
+        std::filesystem::remove(FrameIndex::sidecar_path(path));
+        LAMMPSDumpTrajectory trajectory(path, policy);
+        benchmark::DoNotOptimize(trajectory.n_frames());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(std::filesystem::file_size(path)));
+}
+
+// Parse every frame. args: {threads}
+static void BM_LAMMPSDumpRead(benchmark::State &state)
+{
+    const auto path = dump_path();
+    LAMMPSDumpTrajectory trajectory(path);
+    const ExecutionPolicy policy{static_cast<size_t>(state.range(0))};
+    for (auto _ : state)
+    {
+        auto xyz = trajectory.read_positions(0, N_FRAMES, policy);
+        benchmark::DoNotOptimize(xyz.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(std::filesystem::file_size(path)));
+}
+
+BENCHMARK(BM_LAMMPSDumpScan)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LAMMPSDumpRead)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,92 @@
+#include "molcpp/topology.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+
+using namespace molcpp;
+
+static constexpr size_t CHAIN_LENGTH = 100;
+
+/// Bonds of linear chains of `CHAIN_LENGTH` beads, with a side atom on
+/// every other bead
+static auto polymer_bonds(size_t n_atoms) -> std::vector<Bond>
+{
+    std::vector<Bond> bonds;
+    bonds.reserve(n_atoms);
+    const size_t per_chain = CHAIN_LENGTH + CHAIN_LENGTH / 2;
+    for (size_t start = 0; start + per_chain <= n_atoms; start += per_chain)
+    {
+        for (size_t bead = 0; bead + 1 < CHAIN_LENGTH; bead++)
+        {
+            bonds.push_back({static_cast<uint32_t>(start + bead), static_cast<uint32_t>(start + bead + 1)});
+        }
+        for (size_t bead = 0; bead < CHAIN_LENGTH; bead += 2)
+        {
+            bonds.push_back(
+                {static_cast<uint32_t>(start + bead), static_cast<uint32_t>(start + CHAIN_LENGTH + bead / 2)});
+        }
+    }
+    return bonds;
+}
+
+// Build the graph from a bond list, then enumerate everything from it
+static void BM_TopologyEnumerate(benchmark::State &state)
+{
+    const auto n_atoms = static_cast<size_t>(state.range(0));
+    const auto n_threads = static_cast<size_t>(state.range(1));
+    auto bonds = polymer_bonds(n_atoms);
+    for (auto _ : state)
+    {
+        Topology topology(n_atoms, ExecutionPolicy{n_threads});
+        topology.set_bonds(bonds);
+        auto angles = topology.angles();
+        auto dihedrals = topology.dihedrals();
+        auto impropers = topology.impropers();
+        auto molecules = topology.molecules();
+        benchmark::DoNotOptimize(angles.data());
+        benchmark::DoNotOptimize(dihedrals.data());
+        benchmark::DoNotOptimize(impropers.data());
+        benchmark::DoNotOptimize(molecules.data());
+        state.counters["graph_bytes_per_bond"] =
+            static_cast<double>(topology.memory_usage()) / static_cast<double>(topology.n_bonds());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n_atoms));
+}
+
+// Find bonds between atoms of a cubic lattice from their distances
+static void BM_TopologyGuessBonds(benchmark::State &state)
+{
+    const auto side = static_cast<size_t>(std::cbrt(static_cast<double>(state.range(0))));
+    const size_t n_atoms = side * side * side;
+    const auto n_threads = static_cast<size_t>(state.range(1));
+    std::vector<double> xyz(3 * n_atoms);
+    for (size_t i = 0; i < n_atoms; i++)
+    {
+        xyz[3 * i] = static_cast<double>(i % side) + 0.5;
+        xyz[3 * i + 1] = static_cast<double>(i / side % side) + 0.5;
+        xyz[3 * i + 2] = static_cast<double>(i / side / side) + 0.5;
+    }
+    const auto length = static_cast<double>(side);
+    Box box({length, length, length});
+    for (auto _ : state)
+    {
+        Topology topology(n_atoms, ExecutionPolicy{n_threads});
+        topology.guess_bonds(xyz.data(), n_atoms, box, 1.1);
+        benchmark::DoNotOptimize(topology.n_bonds());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n_atoms));
+}
+
+BENCHMARK(BM_TopologyEnumerate)
+    ->Args({1000000, 1})
+    ->Args({1000000, 0})
+    ->Args({10000000, 0})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TopologyGuessBonds)
+    ->Args({1000000, 1})
+    ->Args({1000000, 0})
+    ->Args({10000000, 0})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "molcpp/export.hpp"
+#include "molcpp/capi/types.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Element types of frame columns
+typedef enum {  // NOLINT: this is both a C and C++ file
+    MOL_FLOAT64 = 0,
+    MOL_FLOAT32 = 1,
+    MOL_INT32 = 2,
+    MOL_INT64 = 3,
+} mol_dtype;
+
+/// Interned column name, resolved once with `mol_key_intern`
+typedef uint32_t mol_key;
+
+/// Keys of the position columns, always present in a frame
+#define MOL_KEY_X 0
+#define MOL_KEY_Y 1
+#define MOL_KEY_Z 2
+
+/// Intern `name` in `key`, giving the same key for the same name
+MOLCPP_EXPORT mol_status mol_key_intern(const char* name, mol_key* key);
+
+/// Create a frame of `n_atoms` atoms at the origin, in an infinite box, or
+/// return NULL on error. The frame must be released with `mol_frame_destroy`.
+MOLCPP_EXPORT MOL_FRAME* mol_frame(size_t n_atoms);
+
+MOLCPP_EXPORT void mol_frame_destroy(MOL_FRAME* frame);
+
+/// Get the number of atoms of the frame in `n_atoms`
+MOLCPP_EXPORT mol_status mol_frame_atoms(const MOL_FRAME* frame, size_t* n_atoms);
+
+/// Change the number of atoms, keeping the first ones. This invalidates the
+/// pointers to every column.
+MOLCPP_EXPORT mol_status mol_frame_resize(MOL_FRAME* frame, size_t n_atoms);
+
+/// Add a column of zeros, or get the existing column if it has the same
+/// type. `data` is set to the column memory, `mol_frame_atoms` elements
+/// aligned on 64 bytes, which is NULL for a frame without atoms.
+MOLCPP_EXPORT mol_status mol_frame_add_column(MOL_FRAME* frame, mol_key key, mol_dtype dtype, void** data);
+
+/// Set `result` to true if the frame has a column `key`
+MOLCPP_EXPORT mol_status mol_frame_has_column(const MOL_FRAME* frame, mol_key key, bool* result);
+
+/// Get the memory of the column `key` in `data`, without copy, and its type
+/// in `dtype` if it is not NULL. It is an error if the frame has no such
+/// column. `data` is NULL for a frame without atoms. Pointers to columns are
+/// invalidated by resizing the frame; adding columns leaves existing columns
+/// in place.
+MOLCPP_EXPORT mol_status mol_frame_column(MOL_FRAME* frame, mol_key key, void** data, mol_dtype* dtype);
+
+/// Get the box of the frame in `box`. The box is owned by the frame, and
+/// stays valid until the frame is destroyed.
+MOLCPP_EXPORT mol_status mol_frame_box(const MOL_FRAME* frame, const MOL_BOX** box);
+
+/// Copy `box` into the frame
+MOLCPP_EXPORT mol_status mol_frame_set_box(MOL_FRAME* frame, const MOL_BOX* box);
+
+#ifdef __cplusplus
+}
+#endif
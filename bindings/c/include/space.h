@@ -17,11 +17,36 @@ typedef enum {  // NOLINT: this is both a C and C++ file
     MOL_BOX_INFINITE = 2,
 } mol_box_style;
 
+/// Create a box without periodic boundaries, or return NULL on error. The
+/// box must be released with `mol_box_destroy`.
 MOLCPP_EXPORT MOL_BOX* mol_box_free();
 
+/// Create a box from the 3 `lengths` and 3 `angles` in degrees, or return
+/// NULL on error. The box must be released with `mol_box_destroy`.
 MOLCPP_EXPORT MOL_BOX* mol_box_from_lengths_angles(const mol_array lengths, const mol_array angles);
 
-MOLCPP_EXPORT mol_array mol_box_wrap(const MOL_BOX* box, const mol_array xyz);
+MOLCPP_EXPORT void mol_box_destroy(MOL_BOX* box);
+
+/// Wrap the (n, 3) positions of `xyz` inside the box, into `wrapped`.
+///
+/// If `wrapped` has no data, the result is allocated by the library and must
+/// be released with `mol_array_free`. Otherwise `wrapped` is a buffer of the
+/// caller with the shape of `xyz`, which is written without allocation, and
+/// which may be `xyz` itself to wrap in place, or overlap it.
+MOLCPP_EXPORT mol_status mol_box_wrap(const MOL_BOX* box, const mol_array xyz, mol_array* wrapped);
+
+/// Wrap the `n` positions in `xyz` inside the box, in place
+MOLCPP_EXPORT mol_status mol_box_wrap_inplace(const MOL_BOX* box, mol_vec3* xyz, size_t n);
+
+/// Wrap `n` float positions in place, with fractional coordinates computed in
+/// double precision
+MOLCPP_EXPORT mol_status mol_box_wrap_inplace_float(const MOL_BOX* box, float (*xyz)[3], size_t n);
+
+/// Set `mask[i]` to true if the i-th of the `n` positions is inside the box
+MOLCPP_EXPORT mol_status mol_box_isin(const MOL_BOX* box, const mol_vec3* xyz, size_t n, bool* mask);
+
+/// Move the `n` positions in `xyz` by their periodic image flags, in place
+MOLCPP_EXPORT mol_status mol_box_unwrap_inplace(const MOL_BOX* box, mol_vec3* xyz, const int (*images)[3], size_t n);
 
 // MOLCPP_EXPORT MOL_BOX* mol_box(const mol_vec3 matrix[3]);
 
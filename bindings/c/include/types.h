@@ -1,6 +1,7 @@
 #pragma once
 
 #include "molcpp/export.hpp"
+#include <stdbool.h>
 #include <stddef.h>
 
 #if defined(__cplusplus)
@@ -8,17 +9,20 @@ namespace molcpp {
     class Region;
     class Boundary;
     class Box;
+    class Frame;
 }
 
 typedef molcpp::Region MOL_REGION;
 typedef molcpp::Boundary MOL_BOUNDARY;
 typedef molcpp::Box MOL_BOX;
+typedef molcpp::Frame MOL_FRAME;
 
 #else
 
 typedef struct MOL_REGION MOL_REGION;
 typedef struct MOL_BOUNDARY MOL_BOUNDARY;
 typedef struct MOL_BOX MOL_BOX;
+typedef struct MOL_FRAME MOL_FRAME;
 
 #endif
 
@@ -52,15 +56,46 @@ typedef enum {  // NOLINT: this is both a C and C++ file
 
 typedef double mol_vec3[3];
 
-const size_t MAX_DIMS = 5;
+/// Maximal number of dimensions of a `mol_array`
+#define MOL_MAX_DIMS 5
 
+/// Deprecated name of `MOL_MAX_DIMS`, kept for source compatibility. It used
+/// to be a `const size_t`, which C does not accept as an array size and which
+/// was defined again in every file including this header.
+#define MAX_DIMS MOL_MAX_DIMS
+
+/// Array of floats exchanged with the library, row-major and contiguous.
+///
+/// The memory of `data` belongs either to the caller, when `owner` is NULL,
+/// or to the library, which then keeps the storage of the array in `owner`.
+/// Arrays returned by the library must be released with `mol_array_free`;
+/// arrays made by the caller, as with `mol_array_view`, are never freed by
+/// the library.
 typedef struct {
     float *data;
     size_t size;
     size_t ndims;
-    size_t shape[MAX_DIMS];
+    size_t shape[MOL_MAX_DIMS];
+    /// Library storage of `data`, or NULL if the caller owns `data`
+    void *owner;
 } mol_array;
 
+/// Make a caller-owned array over `data`, with `ndims` dimensions given by
+/// `shape`. Its size is 0 if there are more than `MOL_MAX_DIMS` dimensions.
+MOLCPP_EXPORT mol_array mol_array_view(float *data, size_t ndims, const size_t *shape);
+
+/// Release the memory of an array returned by the library, and reset
+/// `array` to an empty array. This does nothing for caller-owned arrays and
+/// for NULL, and it is safe to call twice.
+MOLCPP_EXPORT void mol_array_free(mol_array *array);
+
+/// Message of the last error in the calling thread, or an empty string.
+/// The message stays valid until the next error in this thread.
+MOLCPP_EXPORT const char *mol_last_error(void);
+
+/// Clear the last error of the calling thread
+MOLCPP_EXPORT void mol_clear_errors(void);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -1,31 +1,28 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
 #include <string>
 #include <exception>
 
 
 #include "molcpp/capi/types.h"
-// #include "molcpp/warnings.hpp"
 #include "molcpp/types.hpp"
 #include <xtensor/xadapt.hpp>
+#include <xtensor/xarray.hpp>
 
-// #include "molcpp/Error.hpp"
 #include <functional>
 
 
 namespace molcpp {
 
-// void set_last_error(const std::string& message);
+/// Set the message returned by `mol_last_error` in the calling thread
+void set_last_error(const std::string& message);
 
-// inline size_t checked_cast(uint64_t value) {
-//     // Cast SIZE_MAX to uint64_t to be able to do the comparaison, even on
-//     // 32-bits systems
-//     if (value > static_cast<uint64_t>(SIZE_MAX)) {
-//         throw molcpp::Error("got a value too big to be represented by a size_t on this system");
-//     }
-//     return static_cast<size_t>(value);
-// }
+/// Storage of the arrays owned by the library, kept in `mol_array::owner`
+using ArrayStorage = xt::xarray<float>;
 
 /// Convert a C mol_array to a C++ xt::xarray
 inline xt::xarray<float> to_xarray(const mol_array vector) {
@@ -38,89 +35,118 @@ inline xt::xarray<float> to_xarray(const mol_array vector) {
     return xt::adapt(vector.data, vector.size, xt::no_ownership(), shape);
 }
 
+/// Give the memory of `vector` to a library-owned mol_array, released with
+/// `mol_array_free`. Moving an xarray in does not copy its data.
 inline mol_array to_molarr(xt::xarray<float> vector) {
-    mol_array arr;
-    arr.data = vector.data();
-    arr.size = vector.size();
-    arr.ndims = vector.dimension();
-    for (size_t i = 0; i < vector.dimension(); i++) {
-        arr.shape[i] = vector.shape(i);
+    if (vector.dimension() > MOL_MAX_DIMS) {
+        throw std::runtime_error("Array has too many dimensions");
     }
+    auto storage = std::make_unique<ArrayStorage>(std::move(vector));
+    mol_array arr{};
+    arr.data = storage->data();
+    arr.size = storage->size();
+    arr.ndims = storage->dimension();
+    for (size_t i = 0; i < arr.ndims; i++) {
+        arr.shape[i] = storage->shape(i);
+    }
+    arr.owner = storage.release();
     return arr;
 }
 
-// #define CATCH_AND_RETURN(_exception_, _retval_)                                \
-//     catch (const molcpp::_exception_& e) {                                  \
-//         set_last_error(e.what());                                              \
-//         molcpp::send_warning(e.what());                                     \
-//         return _retval_;                                                       \
-//     }
-
-// #define CHECK_POINTER(_ptr_)                                                   \
-//     do {                                                                       \
-//         if ((_ptr_) == nullptr) {                                              \
-//             std::string message = fmt::format(                                 \
-//                 "parameter '{}' cannot be NULL in {}", #_ptr_, __func__        \
-//             );                                                                 \
-//             set_last_error(message);                                           \
-//             molcpp::send_warning(message.c_str());                          \
-//             return CHFL_MEMORY_ERROR;                                          \
-//         }                                                                      \
-//     } while (false)
-
-// #define CHECK_POINTER_GOTO(_ptr_)                                              \
-//     do {                                                                       \
-//         if ((_ptr_) == nullptr) {                                              \
-//             std::string message = fmt::format(                                 \
-//                 "parameter '{}' cannot be NULL in {}", #_ptr_, __func__        \
-//             );                                                                 \
-//             set_last_error(message);                                           \
-//             molcpp::send_warning(message.c_str());                          \
-//             goto error;  /* NOLINT: goto is OK here */                         \
-//         }                                                                      \
-//     } while (false)
-
-
-// /// Wrap `instructions` in a try/catch bloc automatically, and return a status
-// /// code
-// #define CHFL_ERROR_CATCH(_instructions_)                                       \
-//     try {                                                                      \
-//         _instructions_                                                         \
-//     }                                                                          \
-//     CATCH_AND_RETURN(FileError, CHFL_FILE_ERROR)                               \
-//     CATCH_AND_RETURN(MemoryError, CHFL_MEMORY_ERROR)                           \
-//     CATCH_AND_RETURN(FormatError, CHFL_FORMAT_ERROR)                           \
-//     CATCH_AND_RETURN(SelectionError, CHFL_SELECTION_ERROR)                     \
-//     CATCH_AND_RETURN(OutOfBounds, CHFL_OUT_OF_BOUNDS)                          \
-//     CATCH_AND_RETURN(PropertyError, CHFL_PROPERTY_ERROR)                       \
-//     CATCH_AND_RETURN(Error, CHFL_GENERIC_ERROR)                                \
-//     catch (const std::exception& e) {                                          \
-//         set_last_error(e.what());                                              \
-//         return CHFL_CXX_ERROR;                                                 \
-//     } catch (...) {                                                            \
-//         set_last_error("UNKNOWN ERROR");                                       \
-//         return CHFL_CXX_ERROR;                                                 \
-//     }                                                                          \
-//     return CHFL_SUCCESS;
-
-// /// Wrap `instructions` in a try/catch bloc automatically, and goto the
-// /// `error` label in case of error.
-// #define CHFL_ERROR_GOTO(_instructions_)                                        \
-//     try {                                                                      \
-//         _instructions_                                                         \
-//     } catch (const molcpp::Error& e) {                                      \
-//         set_last_error(e.what());                                              \
-//         molcpp::send_warning(e.what());                                     \
-//         goto error;  /* NOLINT: goto is OK here */                             \
-//     } catch (const std::exception& e) {                                        \
-//         set_last_error(e.what());                                              \
-//         goto error;  /* NOLINT: goto is OK here */                             \
-//     } catch (...) {                                                            \
-//         set_last_error("UNKNOWN ERROR");                                       \
-//         goto error;  /* NOLINT: goto is OK here */                             \
-//     }
+/// Number of elements of an array of the given shape
+inline size_t shape_size(const mol_array& array) {
+    size_t size = 1;
+    for (size_t i = 0; i < array.ndims; i++) {
+        size *= array.shape[i];
+    }
+    return size;
+}
+
+/// Check that `array` is a valid array of `ndims` dimensions, and that the
+/// last dimension is `last` when it is not 0
+inline void check_array(const mol_array& array, size_t ndims, size_t last, const char* name) {
+    if (array.ndims != ndims || array.size != shape_size(array) || (array.data == nullptr && array.size != 0)) {
+        throw std::runtime_error(std::string("Invalid shape for ") + name);
+    }
+    if (last != 0 && array.shape[ndims - 1] != last) {
+        throw std::runtime_error(std::string("Invalid shape for ") + name);
+    }
+}
 
+/// Prepare the output `out` for a result with the shape of `like`: a
+/// library-owned array is allocated if `out` has no data, and otherwise the
+/// caller-provided buffer must have the same shape.
+inline void prepare_output(mol_array& out, const mol_array& like) {
+    if (out.data == nullptr) {
+        auto shape = std::vector<size_t>(like.shape, like.shape + like.ndims);
+        out = to_molarr(xt::xarray<float>::from_shape(shape));
+        return;
+    }
+    bool same = out.ndims == like.ndims && out.size == like.size;
+    for (size_t i = 0; same && i < like.ndims; i++) {
+        same = out.shape[i] == like.shape[i];
+    }
+    if (!same) {
+        throw std::length_error("Wrong size for the output buffer");
+    }
+}
+
+#define CATCH_AND_RETURN(_exception_, _status_)                                \
+    catch (const _exception_& e) {                                             \
+        molcpp::set_last_error(e.what());                                      \
+        return _status_;                                                       \
+    }
+
+#define CHECK_POINTER(_ptr_)                                                   \
+    do {                                                                       \
+        if ((_ptr_) == nullptr) {                                              \
+            molcpp::set_last_error(std::string("parameter '") + #_ptr_ +       \
+                                   "' cannot be NULL in " + __func__);         \
+            return MOL_MEMORY_ERROR;                                           \
+        }                                                                      \
+    } while (false)
+
+#define CHECK_POINTER_GOTO(_ptr_)                                              \
+    do {                                                                       \
+        if ((_ptr_) == nullptr) {                                              \
+            molcpp::set_last_error(std::string("parameter '") + #_ptr_ +       \
+                                   "' cannot be NULL in " + __func__);         \
+            goto error;  /* NOLINT: goto is OK here */                         \
+        }                                                                      \
+    } while (false)
+
+/// Wrap `instructions` in a try/catch bloc automatically, and return a status
+/// code
+#define MOL_ERROR_CATCH(_instructions_)                                        \
+    try {                                                                      \
+        _instructions_                                                         \
+    }                                                                          \
+    CATCH_AND_RETURN(std::bad_alloc, MOL_MEMORY_ERROR)                         \
+    CATCH_AND_RETURN(std::length_error, MOL_MEMORY_ERROR)                      \
+    CATCH_AND_RETURN(std::out_of_range, MOL_OUT_OF_BOUNDS)                     \
+    CATCH_AND_RETURN(std::runtime_error, MOL_GENERIC_ERROR)                    \
+    catch (const std::exception& e) {                                          \
+        molcpp::set_last_error(e.what());                                      \
+        return MOL_CXX_ERROR;                                                  \
+    } catch (...) {                                                            \
+        molcpp::set_last_error("UNKNOWN ERROR");                               \
+        return MOL_CXX_ERROR;                                                  \
+    }                                                                          \
+    return MOL_SUCCESS;
+
+/// Wrap `instructions` in a try/catch bloc automatically, and goto the
+/// `error` label in case of error.
+#define MOL_ERROR_GOTO(_instructions_)                                         \
+    try {                                                                      \
+        _instructions_                                                         \
+    } catch (const std::exception& e) {                                        \
+        molcpp::set_last_error(e.what());                                      \
+        goto error;  /* NOLINT: goto is OK here */                             \
+    } catch (...) {                                                            \
+        molcpp::set_last_error("UNKNOWN ERROR");                               \
+        goto error;  /* NOLINT: goto is OK here */                             \
+    }
 
 } // namespace molcpp
 
-// #endif
\ No newline at end of file
+// #endif
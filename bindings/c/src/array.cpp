@@ -0,0 +1,53 @@
+#include "molcpp/capi/types.h"
+#include "molcpp/capi/utils.hpp"
+
+#include <string>
+
+using namespace molcpp;
+
+/// Message of the last error, one per thread so that concurrent calls do not
+/// overwrite each other's errors
+static thread_local std::string LAST_ERROR;
+
+void molcpp::set_last_error(const std::string &message)
+{
+    LAST_ERROR = message;
+}
+
+extern "C" const char *mol_last_error(void)
+{
+    return LAST_ERROR.c_str();
+}
+
+extern "C" void mol_clear_errors(void)
+{
+    LAST_ERROR.clear();
+}
+
+extern "C" mol_array mol_array_view(float *data, size_t ndims, const size_t *shape)
+{
+    mol_array array{};
+    if (ndims > MOL_MAX_DIMS || (ndims != 0 && shape == nullptr))
+    {
+        set_last_error("Invalid shape for mol_array_view");
+        return array;
+    }
+    array.data = data;
+    array.ndims = ndims;
+    for (size_t i = 0; i < ndims; i++)
+    {
+        array.shape[i] = shape[i];
+    }
+    array.size = shape_size(array);
+    return array;
+}
+
+extern "C" void mol_array_free(mol_array *array)
+{
+    if (array == nullptr || array->owner == nullptr)
+    {
+        return;
+    }
+    delete static_cast<ArrayStorage *>(array->owner);
+    *array = mol_array{};
+}
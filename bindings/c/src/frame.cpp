@@ -0,0 +1,112 @@
+#include "molcpp/capi/frame.h"
+#include "molcpp/capi/types.h"
+#include "molcpp/capi/utils.hpp"
+#include "molcpp/frame.hpp"
+
+#include <stdexcept>
+
+using namespace molcpp;
+
+static_assert(sizeof(mol_dtype) == sizeof(int), "Wrong size for mol_dtype");
+static_assert(MOL_FLOAT64 == static_cast<int>(DType::FLOAT64) && MOL_INT64 == static_cast<int>(DType::INT64),
+              "mol_dtype must match DType");
+static_assert(MOL_KEY_X == keys::X.id() && MOL_KEY_Y == keys::Y.id() && MOL_KEY_Z == keys::Z.id(),
+              "Position keys must match molcpp::keys");
+
+/// Key of `key`, which must come from `mol_key_intern`
+static auto to_key(mol_key key) -> Key
+{
+    if (key >= Key::n_interned())
+    {
+        throw std::runtime_error("Invalid key");
+    }
+    return Key::from_id(key);
+}
+
+static auto to_dtype(mol_dtype dtype) -> DType
+{
+    const auto value = static_cast<int>(dtype);
+    if (value < MOL_FLOAT64 || value > MOL_INT64)
+    {
+        throw std::runtime_error("Invalid dtype");
+    }
+    return static_cast<DType>(dtype);
+}
+
+extern "C" mol_status mol_key_intern(const char *name, mol_key *key)
+{
+    CHECK_POINTER(name);
+    CHECK_POINTER(key);
+    MOL_ERROR_CATCH(*key = Key(name).id();)
+}
+
+extern "C" MOL_FRAME *mol_frame(size_t n_atoms)
+{
+    MOL_FRAME *frame = nullptr;
+    MOL_ERROR_GOTO(frame = new Frame(n_atoms);)
+    return frame;
+error:
+    return nullptr;
+}
+
+extern "C" void mol_frame_destroy(MOL_FRAME *frame)
+{
+    delete frame;
+}
+
+extern "C" mol_status mol_frame_atoms(const MOL_FRAME *frame, size_t *n_atoms)
+{
+    CHECK_POINTER(frame);
+    CHECK_POINTER(n_atoms);
+    MOL_ERROR_CATCH(*n_atoms = frame->n_atoms();)
+}
+
+extern "C" mol_status mol_frame_resize(MOL_FRAME *frame, size_t n_atoms)
+{
+    CHECK_POINTER(frame);
+    MOL_ERROR_CATCH(frame->resize(n_atoms);)
+}
+
+extern "C" mol_status mol_frame_add_column(MOL_FRAME *frame, mol_key key, mol_dtype dtype, void **data)
+{
+    CHECK_POINTER(frame);
+    CHECK_POINTER(data);
+    MOL_ERROR_CATCH(*data = frame->add_column(to_key(key), to_dtype(dtype));)
+}
+
+extern "C" mol_status mol_frame_has_column(const MOL_FRAME *frame, mol_key key, bool *result)
+{
+    CHECK_POINTER(frame);
+    CHECK_POINTER(result);
+    MOL_ERROR_CATCH(*result = key < Key::n_interned() && frame->has_column(Key::from_id(key));)
+}
+
+extern "C" mol_status mol_frame_column(MOL_FRAME *frame, mol_key key, void **data, mol_dtype *dtype)
+{
+    CHECK_POINTER(frame);
+    CHECK_POINTER(data);
+    MOL_ERROR_CATCH(
+        auto column = to_key(key);
+        // throws if there is no such column, before anything is written
+        void *memory = frame->column_data(column);
+        if (dtype != nullptr)
+        {
+            *dtype = static_cast<mol_dtype>(frame->column_type(column));
+        }
+        *data = memory;
+    )
+}
+
+extern "C" mol_status mol_frame_box(const MOL_FRAME *frame, const MOL_BOX **box)
+{
+    CHECK_POINTER(frame);
+    CHECK_POINTER(box);
+    MOL_ERROR_CATCH(*box = &frame->get_box();)
+}
+
+extern "C" mol_status mol_frame_set_box(MOL_FRAME *frame, const MOL_BOX *box)
+{
+    CHECK_POINTER(frame);
+    CHECK_POINTER(box);
+    MOL_ERROR_CATCH(frame->set_box(*box);)
+}
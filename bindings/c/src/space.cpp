@@ -1,8 +1,9 @@
 #include "molcpp/capi/space.h"
 #include "molcpp/capi/types.h"
 #include "molcpp/capi/utils.hpp"
-#include "molcpp/space.hpp"
+#include "molcpp/box.hpp"
 #include "molcpp/types.hpp"
+#include <cstring>
 #include <memory>
 #include <xtensor/xadapt.hpp>
 #include <xtensor/xarray.hpp>
@@ -13,7 +14,11 @@ static_assert(sizeof(mol_box_style) == sizeof(int), "Wrong size for mol_box_styl
 
 extern "C" MOL_BOX *mol_box_free()
 {
-    return new Box();
+    MOL_BOX *box = nullptr;
+    MOL_ERROR_GOTO(box = new Box();)
+    return box;
+error:
+    return nullptr;
 }
 
 // extern "C" MOL_BOX *mol_box(const mol_vec3 matrix[3])
@@ -27,11 +32,81 @@ extern "C" MOL_BOX *mol_box_free()
 
 extern "C" MOL_BOX *mol_box_from_lengths_angles(const mol_array lengths, const mol_array angles)
 {
-    return new Box(Box::from_lengths_angles(to_xarray(lengths), to_xarray(angles)));
+    MOL_BOX *box = nullptr;
+    MOL_ERROR_GOTO(
+        check_array(lengths, 1, 3, "lengths");
+        check_array(angles, 1, 3, "angles");
+        box = new Box(Box::from_lengths_angles(to_xarray(lengths), to_xarray(angles)));
+    )
+    return box;
+error:
+    return nullptr;
 }
 
-extern "C" mol_array mol_box_wrap(const MOL_BOX* box, const mol_array xyz)
+extern "C" void mol_box_destroy(MOL_BOX *box)
 {
-    auto wrapped = box->wrap(to_xarray(xyz));
-    return to_molarr(wrapped);
-}
\ No newline at end of file
+    delete box;
+}
+
+extern "C" mol_status mol_box_wrap(const MOL_BOX *box, const mol_array xyz, mol_array *wrapped)
+{
+    CHECK_POINTER(box);
+    CHECK_POINTER(wrapped);
+    MOL_ERROR_CATCH(
+        check_array(xyz, 2, 3, "xyz");
+        prepare_output(*wrapped, xyz);
+        // positions are copied once into the output, which may be the input
+        // or overlap it
+        if (wrapped->data != xyz.data && xyz.size != 0)
+        {
+            std::memmove(wrapped->data, xyz.data, xyz.size * sizeof(float));
+        }
+        box->wrap_inplace(wrapped->data, xyz.shape[0]);
+    )
+}
+
+extern "C" mol_status mol_box_wrap_inplace(const MOL_BOX *box, mol_vec3 *xyz, size_t n)
+{
+    CHECK_POINTER(box);
+    if (n == 0)
+    {
+        return MOL_SUCCESS;
+    }
+    CHECK_POINTER(xyz);
+    MOL_ERROR_CATCH(box->wrap_inplace(&xyz[0][0], n);)
+}
+
+extern "C" mol_status mol_box_wrap_inplace_float(const MOL_BOX *box, float (*xyz)[3], size_t n)
+{
+    CHECK_POINTER(box);
+    if (n == 0)
+    {
+        return MOL_SUCCESS;
+    }
+    CHECK_POINTER(xyz);
+    MOL_ERROR_CATCH(box->wrap_inplace(&xyz[0][0], n);)
+}
+
+extern "C" mol_status mol_box_isin(const MOL_BOX *box, const mol_vec3 *xyz, size_t n, bool *mask)
+{
+    CHECK_POINTER(box);
+    if (n == 0)
+    {
+        return MOL_SUCCESS;
+    }
+    CHECK_POINTER(xyz);
+    CHECK_POINTER(mask);
+    MOL_ERROR_CATCH(box->isin(&xyz[0][0], n, mask);)
+}
+
+extern "C" mol_status mol_box_unwrap_inplace(const MOL_BOX *box, mol_vec3 *xyz, const int (*images)[3], size_t n)
+{
+    CHECK_POINTER(box);
+    if (n == 0)
+    {
+        return MOL_SUCCESS;
+    }
+    CHECK_POINTER(xyz);
+    CHECK_POINTER(images);
+    MOL_ERROR_CATCH(box->unwrap_inplace(&xyz[0][0], &images[0][0], n);)
+}
@@ -0,0 +1,242 @@
+/* Ownership of the arrays exchanged with the C API. Run under AddressSanitizer
+ * (the `asan` preset), so that leaks, double frees and dangling arrays fail
+ * the test. */
+#include "molcpp/capi/frame.h"
+#include "molcpp/capi/space.h"
+#include "molcpp/capi/types.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(_condition_)                                                                                             \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(_condition_))                                                                                            \
+        {                                                                                                              \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #_condition_);                          \
+            failures++;                                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+#define N_ATOMS 4
+
+static const float POSITIONS[N_ATOMS][3] = {{1, 2, 3}, {11, -2, 3}, {-6, 14, 27}, {4.5f, 4.5f, 4.5f}};
+static const float WRAPPED[N_ATOMS][3] = {{1, 2, 3}, {1, -2, 3}, {4, 4, -3}, {4.5f, 4.5f, 4.5f}};
+
+static int is_wrapped(const float *xyz)
+{
+    for (size_t i = 0; i < 3 * N_ATOMS; i++)
+    {
+        if (fabsf(xyz[i] - (&WRAPPED[0][0])[i]) > 1e-5f)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static MOL_BOX *cubic_box(void)
+{
+    float lengths[3] = {10, 10, 10};
+    float angles[3] = {90, 90, 90};
+    size_t shape[1] = {3};
+    return mol_box_from_lengths_angles(mol_array_view(lengths, 1, shape), mol_array_view(angles, 1, shape));
+}
+
+static void test_library_owned(void)
+{
+    MOL_BOX *box = cubic_box();
+    CHECK(box != NULL);
+
+    float xyz[N_ATOMS][3];
+    memcpy(xyz, POSITIONS, sizeof(xyz));
+    size_t shape[2] = {N_ATOMS, 3};
+    mol_array input = mol_array_view(&xyz[0][0], 2, shape);
+    CHECK(input.owner == NULL && input.size == 3 * N_ATOMS);
+    CHECK(sizeof(input.shape) / sizeof(input.shape[0]) == MAX_DIMS);
+
+    mol_array wrapped = {0};
+    CHECK(mol_box_wrap(box, input, &wrapped) == MOL_SUCCESS);
+    CHECK(wrapped.owner != NULL && wrapped.data != &xyz[0][0]);
+    CHECK(wrapped.ndims == 2 && wrapped.shape[0] == N_ATOMS && wrapped.shape[1] == 3);
+    CHECK(is_wrapped(wrapped.data));
+    // the input is left alone
+    CHECK(memcmp(xyz, POSITIONS, sizeof(xyz)) == 0);
+
+    mol_array_free(&wrapped);
+    CHECK(wrapped.data == NULL && wrapped.owner == NULL);
+    // freeing twice, NULL or a caller-owned array does nothing
+    mol_array_free(&wrapped);
+    mol_array_free(NULL);
+    mol_array_free(&input);
+    CHECK(input.data == &xyz[0][0]);
+
+    mol_box_destroy(box);
+}
+
+static void test_caller_provided(void)
+{
+    MOL_BOX *box = cubic_box();
+    float xyz[N_ATOMS][3];
+    memcpy(xyz, POSITIONS, sizeof(xyz));
+    size_t shape[2] = {N_ATOMS, 3};
+    mol_array input = mol_array_view(&xyz[0][0], 2, shape);
+
+    float buffer[N_ATOMS][3];
+    mol_array output = mol_array_view(&buffer[0][0], 2, shape);
+    CHECK(mol_box_wrap(box, input, &output) == MOL_SUCCESS);
+    CHECK(output.data == &buffer[0][0] && output.owner == NULL);
+    CHECK(is_wrapped(&buffer[0][0]));
+
+    // in place, when the output is the input
+    CHECK(mol_box_wrap(box, input, &input) == MOL_SUCCESS);
+    CHECK(is_wrapped(&xyz[0][0]));
+
+    memcpy(xyz, POSITIONS, sizeof(xyz));
+    CHECK(mol_box_wrap_inplace_float(box, xyz, N_ATOMS) == MOL_SUCCESS);
+    CHECK(is_wrapped(&xyz[0][0]));
+
+    // an output overlapping the input, shifted by one atom
+    float shifted[N_ATOMS + 1][3];
+    memcpy(shifted[1], POSITIONS, sizeof(POSITIONS));
+    mol_array later = mol_array_view(&shifted[1][0], 2, shape);
+    mol_array earlier = mol_array_view(&shifted[0][0], 2, shape);
+    CHECK(mol_box_wrap(box, later, &earlier) == MOL_SUCCESS);
+    CHECK(is_wrapped(&shifted[0][0]));
+
+    mol_box_destroy(box);
+}
+
+static void test_errors(void)
+{
+    MOL_BOX *box = cubic_box();
+    float xyz[N_ATOMS][3];
+    memcpy(xyz, POSITIONS, sizeof(xyz));
+    size_t shape[2] = {N_ATOMS, 3};
+    mol_array input = mol_array_view(&xyz[0][0], 2, shape);
+
+    mol_clear_errors();
+    CHECK(strcmp(mol_last_error(), "") == 0);
+
+    // a buffer of the wrong size is not written
+    float small[2][3] = {{0}};
+    size_t small_shape[2] = {2, 3};
+    mol_array output = mol_array_view(&small[0][0], 2, small_shape);
+    CHECK(mol_box_wrap(box, input, &output) == MOL_MEMORY_ERROR);
+    CHECK(strlen(mol_last_error()) > 0);
+    CHECK(small[0][0] == 0);
+
+    // positions must have shape (n, 3)
+    size_t flat_shape[1] = {3 * N_ATOMS};
+    mol_array flat = mol_array_view(&xyz[0][0], 1, flat_shape);
+    mol_array wrapped = {0};
+    CHECK(mol_box_wrap(box, flat, &wrapped) == MOL_GENERIC_ERROR);
+    CHECK(wrapped.data == NULL && wrapped.owner == NULL);
+
+    CHECK(mol_box_wrap(NULL, input, &wrapped) == MOL_MEMORY_ERROR);
+    CHECK(strstr(mol_last_error(), "box") != NULL);
+    CHECK(mol_box_wrap(box, input, NULL) == MOL_MEMORY_ERROR);
+
+    float lengths[2] = {10, 10};
+    size_t two[1] = {2};
+    CHECK(mol_box_from_lengths_angles(mol_array_view(lengths, 1, two), mol_array_view(lengths, 1, two)) == NULL);
+
+    mol_box_destroy(box);
+}
+
+static void test_frame(void)
+{
+    mol_key charge = 0, other = 0;
+    CHECK(mol_key_intern("charge", &charge) == MOL_SUCCESS);
+    CHECK(mol_key_intern("charge", &other) == MOL_SUCCESS && other == charge);
+
+    MOL_FRAME *frame = mol_frame(N_ATOMS);
+    CHECK(frame != NULL);
+    size_t n_atoms = 0;
+    CHECK(mol_frame_atoms(frame, &n_atoms) == MOL_SUCCESS && n_atoms == N_ATOMS);
+
+    bool has_column = false;
+    CHECK(mol_frame_has_column(frame, MOL_KEY_X, &has_column) == MOL_SUCCESS && has_column);
+    CHECK(mol_frame_has_column(frame, charge, &has_column) == MOL_SUCCESS && !has_column);
+
+    void *data = NULL;
+    mol_dtype dtype = MOL_INT32;
+    CHECK(mol_frame_column(frame, MOL_KEY_X, &data, &dtype) == MOL_SUCCESS);
+    CHECK(data != NULL && dtype == MOL_FLOAT64);
+    double *x = data;
+    x[N_ATOMS - 1] = 3.5;
+
+    // adding a column gives its memory, and the same memory again
+    float *charges = NULL;
+    CHECK(mol_frame_add_column(frame, charge, MOL_FLOAT32, &data) == MOL_SUCCESS);
+    charges = data;
+    CHECK(charges != NULL && charges[0] == 0);
+    CHECK(mol_frame_add_column(frame, charge, MOL_FLOAT32, &data) == MOL_SUCCESS && data == charges);
+    CHECK(mol_frame_column(frame, charge, &data, NULL) == MOL_SUCCESS && data == charges);
+    CHECK(mol_frame_column(frame, MOL_KEY_X, &data, &dtype) == MOL_SUCCESS && data == x);
+
+    // errors leave the outputs alone
+    data = NULL;
+    CHECK(mol_frame_add_column(frame, charge, MOL_FLOAT64, &data) == MOL_GENERIC_ERROR && data == NULL);
+    CHECK(mol_frame_add_column(frame, charge, (mol_dtype)7, &data) == MOL_GENERIC_ERROR && data == NULL);
+    mol_key missing = 0;
+    CHECK(mol_key_intern("missing", &missing) == MOL_SUCCESS);
+    dtype = MOL_INT32;
+    CHECK(mol_frame_column(frame, missing, &data, &dtype) == MOL_GENERIC_ERROR);
+    CHECK(data == NULL && dtype == MOL_INT32);
+    CHECK(strstr(mol_last_error(), "missing") != NULL);
+
+    CHECK(mol_frame_resize(frame, 2 * N_ATOMS) == MOL_SUCCESS);
+    CHECK(mol_frame_atoms(frame, &n_atoms) == MOL_SUCCESS && n_atoms == 2 * N_ATOMS);
+    CHECK(mol_frame_column(frame, MOL_KEY_X, &data, NULL) == MOL_SUCCESS);
+    x = data;
+    CHECK(x[N_ATOMS - 1] == 3.5 && x[N_ATOMS] == 0);
+
+    // the box is copied into the frame
+    MOL_BOX *box = cubic_box();
+    const MOL_BOX *frame_box = NULL;
+    CHECK(mol_frame_set_box(frame, box) == MOL_SUCCESS);
+    mol_box_destroy(box);
+    CHECK(mol_frame_box(frame, &frame_box) == MOL_SUCCESS && frame_box != NULL);
+    float xyz[N_ATOMS][3];
+    memcpy(xyz, POSITIONS, sizeof(xyz));
+    CHECK(mol_box_wrap_inplace_float(frame_box, xyz, N_ATOMS) == MOL_SUCCESS);
+    CHECK(is_wrapped(&xyz[0][0]));
+
+    CHECK(mol_frame_atoms(NULL, &n_atoms) == MOL_MEMORY_ERROR);
+    CHECK(mol_frame_atoms(frame, NULL) == MOL_MEMORY_ERROR);
+    CHECK(mol_frame_resize(NULL, 1) == MOL_MEMORY_ERROR);
+    CHECK(mol_frame_add_column(frame, charge, MOL_FLOAT32, NULL) == MOL_MEMORY_ERROR);
+    CHECK(mol_frame_column(frame, MOL_KEY_X, NULL, NULL) == MOL_MEMORY_ERROR);
+    CHECK(mol_frame_box(NULL, &frame_box) == MOL_MEMORY_ERROR);
+    CHECK(mol_frame_box(frame, NULL) == MOL_MEMORY_ERROR);
+    CHECK(mol_frame_set_box(frame, NULL) == MOL_MEMORY_ERROR);
+    CHECK(mol_key_intern(NULL, &other) == MOL_MEMORY_ERROR);
+    mol_frame_destroy(frame);
+
+    // a frame without atoms has columns without memory, which is not an error
+    MOL_FRAME *empty = mol_frame(0);
+    data = &n_atoms;
+    CHECK(mol_frame_add_column(empty, charge, MOL_FLOAT32, &data) == MOL_SUCCESS && data == NULL);
+    data = &n_atoms;
+    CHECK(mol_frame_column(empty, MOL_KEY_Z, &data, NULL) == MOL_SUCCESS && data == NULL);
+    mol_frame_destroy(empty);
+}
+
+int main(void)
+{
+    test_library_owned();
+    test_caller_provided();
+    test_errors();
+    test_frame();
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
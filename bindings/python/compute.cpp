@@ -0,0 +1,63 @@
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include "xtensor-python/pyarray.hpp"
+#include "xtensor-python/pytensor.hpp"
+
+#include "molcpp/compute.hpp"
+#include "utils.hpp"
+
+namespace py = pybind11;
+using namespace molcpp;
+
+/// MSD of positions with shape (frames, atoms, 3), read in place from the
+/// numpy array, without holding the GIL during the computation
+template <typename T> static auto compute_msd(MSDCompute &msd, const xt::pytensor<T, 3> &xyz) -> xt::xarray<double>
+{
+    Result1D<double> result;
+    {
+        py::gil_scoped_release release;
+        result = msd.compute(xyz);
+    }
+    return result.get("");
+}
+
+template <typename T> static void push_frame(StreamingMSDCompute &msd, contiguous_t<T> xyz, const Box &box)
+{
+    auto n = check_positions(xyz);
+    const T *data = xyz.data();
+    py::gil_scoped_release release;
+    msd.push_frame(data, n, box);
+}
+
+static constexpr const char *MSD_DOC = R"(Compute from unwrapped positions of shape (frames, atoms, 3).
+
+With Style.WINDOW, the default, returns the MSD averaged over all time
+origins for every lag, of shape (frames,), or (frames, atoms) with per_atom.
+With Style.DIRECT, returns the squared displacement of each coordinate from
+the first frame, of shape (frames, atoms, 3), which is not averaged.)";
+
+void bind_compute(py::module_ &m)
+{
+    py::class_<MSDCompute> msd(m, "MSDCompute");
+    py::enum_<MSDCompute::MSDStyle>(msd, "Style")
+        .value("DIRECT", MSDCompute::MSDStyle::DIRECT)
+        .value("WINDOW", MSDCompute::MSDStyle::WINDOW);
+    msd.def(py::init([](MSDCompute::MSDStyle style, bool per_atom, size_t n_threads) {
+                return MSDCompute(style, per_atom, ExecutionPolicy{n_threads});
+            }),
+            py::arg("style") = MSDCompute::MSDStyle::WINDOW, py::arg("per_atom") = false, py::arg("n_threads") = 1)
+        .def("compute", &compute_msd<double>, py::arg("xyz").noconvert(), MSD_DOC)
+        .def("compute", &compute_msd<float>, py::arg("xyz").noconvert(), MSD_DOC);
+
+    // frames are accumulated in the compute, so concurrent Python threads
+    // must each use their own
+    py::class_<StreamingMSDCompute>(m, "StreamingMSDCompute")
+        .def(py::init<size_t, size_t, size_t>(), py::arg("points_per_level") = 16, py::arg("decimation") = 2,
+             py::arg("n_levels") = 24)
+        .def("push_frame", &push_frame<double>, py::arg("xyz").noconvert(), py::arg("box"))
+        .def("push_frame", &push_frame<float>, py::arg("xyz").noconvert(), py::arg("box"))
+        .def("get_result", [](const StreamingMSDCompute &msd) { return msd.get_result().get(""); })
+        .def("get_lags", &StreamingMSDCompute::get_lags)
+        .def_property_readonly("n_frames", &StreamingMSDCompute::n_frames)
+        .def("memory_usage", &StreamingMSDCompute::memory_usage);
+}
@@ -0,0 +1,170 @@
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "molcpp/frame.hpp"
+
+#include <string>
+#include <unordered_map>
+
+namespace py = pybind11;
+using namespace molcpp;
+
+static auto to_dtype(const py::object &object) -> DType
+{
+    auto dtype = py::dtype::from_args(object);
+    if (dtype.kind() == 'f' && dtype.itemsize() == 8)
+    {
+        return DType::FLOAT64;
+    }
+    if (dtype.kind() == 'f' && dtype.itemsize() == 4)
+    {
+        return DType::FLOAT32;
+    }
+    if (dtype.kind() == 'i' && dtype.itemsize() == 4)
+    {
+        return DType::INT32;
+    }
+    if (dtype.kind() == 'i' && dtype.itemsize() == 8)
+    {
+        return DType::INT64;
+    }
+    throw py::type_error("columns must hold float64, float32, int32 or int64");
+}
+
+static auto to_numpy(DType dtype) -> py::dtype
+{
+    switch (dtype)
+    {
+    case DType::FLOAT64:
+        return py::dtype::of<double>();
+    case DType::FLOAT32:
+        return py::dtype::of<float>();
+    case DType::INT32:
+        return py::dtype::of<int32_t>();
+    case DType::INT64:
+        return py::dtype::of<int64_t>();
+    default:
+        throw py::type_error("invalid column type");
+    }
+}
+
+/// Number of numpy arrays alive over the columns of each frame. As numpy
+/// does for `ndarray.resize`, a frame refuses to resize or remove columns
+/// while arrays reference its memory. Only touched with the GIL held.
+static std::unordered_map<const Frame *, size_t> EXPORTS;
+
+/// Base object of the arrays over a column, holding the Python frame
+struct ColumnExport
+{
+    py::object frame;
+};
+
+static void release_export(void *pointer)
+{
+    auto *exported = static_cast<ColumnExport *>(pointer);
+    auto it = EXPORTS.find(&exported->frame.cast<const Frame &>());
+    if (it != EXPORTS.end() && --it->second == 0)
+    {
+        EXPORTS.erase(it);
+    }
+    delete exported;
+}
+
+/// Throw if numpy arrays reference the columns of `frame`, which `operation`
+/// would free or move
+static void check_no_exports(const Frame &frame, const char *operation)
+{
+    auto it = EXPORTS.find(&frame);
+    if (it != EXPORTS.end() && it->second != 0)
+    {
+        throw py::value_error(std::string("cannot ") + operation +
+                              ": numpy arrays reference the columns of this frame");
+    }
+}
+
+/// Array over the memory of a column, keeping `owner`, the Python frame,
+/// alive as long as the array, and counted in `EXPORTS`
+static auto column_array(Frame &frame, Key key, const py::object &owner) -> py::array
+{
+    auto dtype = frame.column_type(key);
+    py::capsule base(new ColumnExport{owner}, &release_export);
+    EXPORTS[&frame]++;
+    return py::array(to_numpy(dtype), {static_cast<py::ssize_t>(frame.n_atoms())},
+                     {static_cast<py::ssize_t>(dtype_size(dtype))}, frame.column_data(key), base);
+}
+
+void bind_frame(py::module_ &m)
+{
+    py::class_<Key>(m, "Key")
+        .def(py::init<std::string_view>())
+        .def_property_readonly("name", &Key::name)
+        .def_property_readonly("id", &Key::id)
+        .def("__eq__", [](const Key &a, const Key &b) { return a == b; })
+        .def("__hash__", [](const Key &key) { return key.id(); })
+        .def("__repr__", [](const Key &key) { return "Key('" + key.name() + "')"; });
+    py::implicitly_convertible<py::str, Key>();
+
+    // arrays returned by `column` and `add_column` share the frame memory,
+    // so `resize` and `remove_column` raise while any of them is alive
+    py::class_<Frame>(m, "Frame")
+        .def(py::init<size_t>(), py::arg("n_atoms") = 0)
+        .def_property_readonly("n_atoms", &Frame::n_atoms)
+        .def(
+            "resize",
+            [](Frame &frame, size_t n_atoms) {
+                check_no_exports(frame, "resize the frame");
+                frame.resize(n_atoms);
+            },
+            py::arg("n_atoms"))
+        .def_property("box", &Frame::get_box, &Frame::set_box)
+        .def(
+            "add_column",
+            [](py::object self, Key key, const py::object &dtype) {
+                auto &frame = self.cast<Frame &>();
+                frame.add_column(key, to_dtype(dtype));
+                return column_array(frame, key, self);
+            },
+            py::arg("key"), py::arg("dtype") = py::str("float64"))
+        .def(
+            "column",
+            [](py::object self, Key key) {
+                auto &frame = self.cast<Frame &>();
+                if (!frame.has_column(key))
+                {
+                    throw py::key_error(key.name());
+                }
+                return column_array(frame, key, self);
+            },
+            py::arg("key"))
+        .def("has_column", &Frame::has_column)
+        .def(
+            "remove_column",
+            [](Frame &frame, Key key) {
+                check_no_exports(frame, "remove a column");
+                frame.remove_column(key);
+            },
+            py::arg("key"))
+        .def("keys",
+             [](const Frame &frame) {
+                 std::vector<std::string> names;
+                 for (auto key : frame.column_keys())
+                 {
+                     names.push_back(key.name());
+                 }
+                 return names;
+             })
+        .def("get_positions",
+             [](const Frame &frame) {
+                 py::array_t<double> xyz({static_cast<py::ssize_t>(frame.n_atoms()), py::ssize_t{3}});
+                 frame.get_positions(xyz.mutable_data());
+                 return xyz;
+             })
+        .def("set_positions", [](Frame &frame, py::array_t<double, py::array::c_style | py::array::forcecast> xyz) {
+            if (xyz.ndim() != 2 || static_cast<size_t>(xyz.shape(0)) != frame.n_atoms() || xyz.shape(1) != 3)
+            {
+                throw py::value_error("positions must have shape (n_atoms, 3)");
+            }
+            frame.set_positions(xyz.data());
+        });
+}
@@ -0,0 +1,58 @@
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+#include "molcpp/neighbor.hpp"
+#include "utils.hpp"
+
+#include <vector>
+
+namespace py = pybind11;
+using namespace molcpp;
+
+/// Array over the memory of `values`, keeping `owner`, the Python neighbor
+/// list, alive as long as the array
+template <typename T> static auto list_array(const std::vector<T> &values, const py::object &owner) -> py::array
+{
+    return py::array_t<T>({static_cast<py::ssize_t>(values.size())}, {static_cast<py::ssize_t>(sizeof(T))},
+                          values.data(), owner);
+}
+
+/// Build a neighbor list from positions read in place, without holding the
+/// GIL during the search
+template <typename T> static auto build(CellList &cells, contiguous_t<T> xyz, const Box &box) -> NeighborList
+{
+    auto n = check_positions(xyz);
+    const T *data = xyz.data();
+    NeighborList list;
+    {
+        py::gil_scoped_release release;
+        cells.build(data, n, box, list);
+    }
+    return list;
+}
+
+void bind_neighbor(py::module_ &m)
+{
+    // lists are not modified from Python, so the arrays over their memory
+    // stay valid as long as they are alive
+    py::class_<NeighborList>(m, "NeighborList")
+        .def_property_readonly("n_atoms", &NeighborList::n_atoms)
+        .def_property_readonly("n_pairs", &NeighborList::n_pairs)
+        .def_property_readonly("offsets",
+                               [](py::object self) { return list_array(self.cast<NeighborList &>().offsets, self); })
+        .def_property_readonly("indices",
+                               [](py::object self) { return list_array(self.cast<NeighborList &>().indices, self); })
+        .def_property_readonly(
+            "distances", [](py::object self) { return list_array(self.cast<NeighborList &>().distances, self); })
+        .def("memory_usage", &NeighborList::memory_usage);
+
+    // a cell list keeps its bins between builds, so concurrent Python threads
+    // must each use their own
+    py::class_<CellList>(m, "CellList")
+        .def(py::init<double, bool, bool>(), py::arg("cutoff"), py::arg("full") = false,
+             py::arg("with_distances") = false)
+        .def_property_readonly("cutoff", &CellList::get_cutoff)
+        .def_property("n_threads", &CellList::get_n_threads, &CellList::set_n_threads)
+        .def("build", &build<double>, py::arg("xyz").noconvert(), py::arg("box"))
+        .def("build", &build<float>, py::arg("xyz").noconvert(), py::arg("box"));
+}
@@ -1,23 +1,111 @@
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #define FORCE_IMPORT_ARRAY
 #include "xtensor-python/pyarray.hpp"
+#include "xtensor-python/pytensor.hpp"
+
+#include "molcpp/box.hpp"
+#include "utils.hpp"
 
 namespace py = pybind11;
+using namespace molcpp;
+
+/// Wrap positions in place, without holding the GIL while the kernel runs
+template <typename T> static void wrap_inplace(const Box &box, contiguous_t<T> xyz)
+{
+    auto n = check_positions(xyz);
+    // taken with the GIL held, as it checks that the array is writeable
+    T *data = xyz.mutable_data();
+    py::gil_scoped_release release;
+    box.wrap_inplace(data, n);
+}
+
+/// Wrapped copy of positions, in the precision of the input
+template <typename T> static auto wrap(const Box &box, const xt::pytensor<T, 2> &xyz) -> xt::pytensor<T, 2>
+{
+    if (xyz.shape(1) != 3)
+    {
+        throw py::value_error("positions must have shape (n, 3)");
+    }
+    // the only copy, from the caller's array to the result
+    auto wrapped = xt::pytensor<T, 2>::from_shape(xyz.shape());
+    xt::noalias(wrapped) = xyz;
+    T *data = wrapped.data();
+    const size_t n = wrapped.shape(0);
+    {
+        py::gil_scoped_release release;
+        box.wrap_inplace(data, n);
+    }
+    return wrapped;
+}
+
+static constexpr const char *WRAP_DOC = R"(Wrapped copy of positions of shape (n, 3).
+
+float32 arrays are wrapped in float32. Anything else convertible to an array,
+such as lists or integer arrays, is converted to float64.)";
+
+void bind_types(py::module_ &m);
+void bind_frame(py::module_ &m);
+void bind_neighbor(py::module_ &m);
+void bind_compute(py::module_ &m);
 
 PYBIND11_MODULE(molcpp, m) {
 
     xt::import_numpy();
 
     m.doc() = "molcpp python bindings";
-    py::class_<Box>(m, "Box")
-        .def(py::init<>())
+
+    bind_types(m);
+
+    // the kernels release the GIL, so that Python threads can run them on
+    // the same box concurrently
+    py::class_<Box> box_class(m, "Box");
+    py::enum_<Box::Style>(box_class, "Style")
+        .value("FREE", Box::FREE)
+        .value("ORTHOGONAL", Box::ORTHOGONAL)
+        .value("TRICLINIC", Box::TRICLINIC);
+    box_class.def(py::init<>())
         .def_static("from_lengths_angles", &Box::from_lengths_angles)
-        .def("wrap", &Box::wrap)
+        .def("wrap", &wrap<float>, py::arg("xyz").noconvert(), WRAP_DOC)
+        .def("wrap", &wrap<double>, py::arg("xyz"), WRAP_DOC)
+        .def("wrap_inplace", &wrap_inplace<double>, py::arg("xyz").noconvert())
+        .def("wrap_inplace", &wrap_inplace<float>, py::arg("xyz").noconvert())
+        .def(
+            "isin",
+            [](const Box &box, contiguous_t<double> xyz) {
+                auto n = check_positions(xyz);
+                py::array_t<bool> mask(static_cast<py::ssize_t>(n));
+                const double *data = xyz.data();
+                bool *out = mask.mutable_data();
+                {
+                    py::gil_scoped_release release;
+                    box.isin(data, n, out);
+                }
+                return mask;
+            },
+            py::arg("xyz").noconvert())
+        .def(
+            "unwrap_inplace",
+            [](const Box &box, contiguous_t<double> xyz, contiguous_t<int> images) {
+                auto n = check_positions(xyz);
+                if (check_positions(images) != n)
+                {
+                    throw py::value_error("images must have the same shape as positions");
+                }
+                double *data = xyz.mutable_data();
+                const int *flags = images.data();
+                py::gil_scoped_release release;
+                box.unwrap_inplace(data, flags, n);
+            },
+            py::arg("xyz").noconvert(), py::arg("images"))
         .def("get_style", &Box::get_style)
         .def("get_matrix", &Box::get_matrix)
         .def("get_inv", &Box::get_inv)
         .def("get_lengths", &Box::get_lengths)
         .def("get_angles", &Box::get_angles)
-        .def("get_volume", &Box::get_volume)
+        .def("get_volume", &Box::get_volume);
 
-}
\ No newline at end of file
+    bind_frame(m);
+    bind_neighbor(m);
+    bind_compute(m);
+}
@@ -0,0 +1,44 @@
+"""Numpy arrays over frame columns, which must never outlive their memory."""
+
+import gc
+
+import numpy as np
+import pytest
+
+import molcpp
+
+
+def test_columns_share_memory():
+    frame = molcpp.Frame(4)
+    charge = frame.add_column("charge", "float32")
+    charge[:] = [1, 2, 3, 4]
+    np.testing.assert_array_equal(frame.column("charge"), [1, 2, 3, 4])
+
+    # arrays keep the frame alive
+    x = frame.column("x")
+    del frame
+    gc.collect()
+    x[0] = 1.0
+    assert x[0] == 1.0
+
+
+def test_resize_refused_while_arrays_are_alive():
+    frame = molcpp.Frame(4)
+    frame.add_column("charge")
+    x = frame.column("x")
+    with pytest.raises(ValueError):
+        frame.resize(10**6)
+    with pytest.raises(ValueError):
+        frame.remove_column("charge")
+    x[0] = 1.0
+
+    # adding columns does not move existing ones
+    frame.add_column("mass")
+    assert x[0] == 1.0 and frame.column("x")[0] == 1.0
+
+    del x
+    gc.collect()
+    frame.resize(10**6)
+    assert frame.n_atoms == 10**6
+    frame.remove_column("charge")
+    assert not frame.has_column("charge")
@@ -0,0 +1,152 @@
+"""Bindings against numpy equivalents, timed with pytest-benchmark.
+
+Run from the build directory of the `python` preset, where the module is:
+
+    PYTHONPATH=build/python/bindings/python pytest bindings/python/tests --benchmark-group-by=func
+"""
+
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+import pytest
+
+import molcpp
+
+N_ATOMS = 100_000
+N_FRAMES = 256
+LENGTH = 30.0
+
+
+@pytest.fixture(scope="module")
+def box():
+    return molcpp.Box.from_lengths_angles([LENGTH] * 3, [90.0] * 3)
+
+
+@pytest.fixture(scope="module")
+def positions():
+    rng = np.random.default_rng(42)
+    return rng.uniform(-2 * LENGTH, 2 * LENGTH, size=(N_ATOMS, 3))
+
+
+@pytest.fixture(scope="module")
+def trajectory():
+    rng = np.random.default_rng(7)
+    steps = rng.normal(scale=0.1, size=(N_FRAMES, 1000, 3))
+    return np.cumsum(steps, axis=0)
+
+
+def numpy_wrap(xyz):
+    return xyz - LENGTH * np.round(xyz / LENGTH)
+
+
+def numpy_window_msd(xyz):
+    # average over all time origins, one lag at a time
+    n_frames = xyz.shape[0]
+    msd = np.zeros(n_frames)
+    for lag in range(1, n_frames):
+        msd[lag] = np.mean(np.sum((xyz[lag:] - xyz[:-lag]) ** 2, axis=-1))
+    return msd
+
+
+def numpy_pairs(xyz, cutoff):
+    d = xyz[None, :, :] - xyz[:, None, :]
+    d = numpy_wrap(d)
+    r2 = np.sum(d**2, axis=-1)
+    i, j = np.nonzero(np.triu(r2 < cutoff**2, k=1))
+    return set(zip(i.tolist(), j.tolist()))
+
+
+def test_wrap_matches_numpy(box, positions):
+    np.testing.assert_allclose(box.wrap(positions), numpy_wrap(positions), atol=1e-12)
+
+    xyz = positions.copy()
+    box.wrap_inplace(xyz)
+    np.testing.assert_allclose(xyz, numpy_wrap(positions), atol=1e-12)
+
+    xyz = positions.astype(np.float32)
+    box.wrap_inplace(xyz)
+    np.testing.assert_allclose(xyz, numpy_wrap(positions), atol=1e-4)
+
+
+def test_wrap_converts(box, positions):
+    wrapped = box.wrap(positions.astype(np.float32))
+    assert wrapped.dtype == np.float32
+    np.testing.assert_allclose(wrapped, numpy_wrap(positions), atol=1e-4)
+
+    # lists and integer arrays are converted to float64
+    expected = numpy_wrap(positions[:10])
+    np.testing.assert_allclose(box.wrap(positions[:10].tolist()), expected, atol=1e-12)
+    integers = np.array([[31, -2, 44], [0, 16, -16]])
+    assert box.wrap(integers).dtype == np.float64
+    np.testing.assert_allclose(box.wrap(integers), numpy_wrap(integers.astype(np.float64)))
+
+
+def test_wrap_inplace_does_not_copy(box, positions):
+    # a non contiguous array would be written through a copy, so it is refused
+    with pytest.raises(TypeError):
+        box.wrap_inplace(np.asfortranarray(positions))
+    xyz = positions.copy()
+    xyz.flags.writeable = False
+    with pytest.raises(ValueError):
+        box.wrap_inplace(xyz)
+
+
+def test_concurrent_threads(box, positions):
+    chunks = [positions[k::4].copy() for k in range(4)]
+    with ThreadPoolExecutor(4) as pool:
+        list(pool.map(box.wrap_inplace, chunks))
+    for k, chunk in enumerate(chunks):
+        np.testing.assert_allclose(chunk, numpy_wrap(positions[k::4]), atol=1e-12)
+
+
+def test_neighbors_match_numpy(box):
+    rng = np.random.default_rng(3)
+    xyz = rng.uniform(0, LENGTH, size=(500, 3))
+    neighbors = molcpp.CellList(4.0).build(xyz, box)
+
+    pairs = set()
+    for i in range(neighbors.n_atoms):
+        for j in neighbors.indices[neighbors.offsets[i] : neighbors.offsets[i + 1]]:
+            pairs.add((min(i, int(j)), max(i, int(j))))
+    assert pairs == numpy_pairs(xyz, 4.0)
+
+
+def test_window_msd_matches_numpy(trajectory):
+    msd = molcpp.MSDCompute(molcpp.MSDCompute.Style.WINDOW).compute(trajectory)
+    np.testing.assert_allclose(msd, numpy_window_msd(trajectory), rtol=1e-8, atol=1e-10)
+
+    # the default style is the window MSD, the direct style is not averaged
+    assert molcpp.MSDCompute().compute(trajectory).shape == (N_FRAMES,)
+    direct = molcpp.MSDCompute(molcpp.MSDCompute.Style.DIRECT).compute(trajectory)
+    assert direct.shape == trajectory.shape
+
+
+def test_bench_wrap_molcpp(benchmark, box, positions):
+    xyz = positions.copy()
+    benchmark(box.wrap_inplace, xyz)
+
+
+def test_bench_wrap_numpy(benchmark, positions):
+    benchmark(numpy_wrap, positions)
+
+
+def test_bench_neighbors_molcpp(benchmark, box):
+    rng = np.random.default_rng(3)
+    xyz = rng.uniform(0, LENGTH, size=(1000, 3))
+    cells = molcpp.CellList(4.0)
+    benchmark(cells.build, xyz, box)
+
+
+def test_bench_neighbors_numpy(benchmark):
+    rng = np.random.default_rng(3)
+    xyz = rng.uniform(0, LENGTH, size=(1000, 3))
+    benchmark(numpy_pairs, xyz, 4.0)
+
+
+def test_bench_msd_molcpp(benchmark, trajectory):
+    msd = molcpp.MSDCompute(molcpp.MSDCompute.Style.WINDOW, n_threads=0)
+    benchmark(msd.compute, trajectory)
+
+
+def test_bench_msd_numpy(benchmark, trajectory):
+    benchmark(numpy_window_msd, trajectory)
@@ -1,4 +1,17 @@
 #include <pybind11/pybind11.h>
 
+#include "molcpp/simd.hpp"
+
 namespace py = pybind11;
+using namespace molcpp;
 
+void bind_types(py::module_ &m)
+{
+    py::enum_<SimdLevel>(m, "SimdLevel")
+        .value("SCALAR", SimdLevel::SCALAR)
+        .value("AVX2", SimdLevel::AVX2)
+        .value("AVX512", SimdLevel::AVX512);
+    m.def("detect_simd_level", &detect_simd_level);
+    m.def("get_simd_level", &get_simd_level);
+    m.def("set_simd_level", &set_simd_level, py::arg("level"));
+}
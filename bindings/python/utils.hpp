@@ -0,0 +1,25 @@
+#pragma once
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+#include <cstddef>
+
+namespace py = pybind11;
+
+/// C-contiguous array of `T`, taken without conversion nor copy so that the
+/// kernels read and write the caller's memory. Bind arguments of this type
+/// with `.noconvert()`, so that arrays of another type fall through to the
+/// next overload instead of being copied.
+template <typename T> using contiguous_t = py::array_t<T, py::array::c_style>;
+
+/// Number of positions in an (n, 3) array
+inline auto check_positions(const py::array &xyz) -> size_t
+{
+    if (xyz.ndim() != 2 || xyz.shape(1) != 3)
+    {
+        throw py::value_error("positions must have shape (n, 3)");
+    }
+    return static_cast<size_t>(xyz.shape(0));
+}
+
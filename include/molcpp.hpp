@@ -4,6 +4,18 @@
 #include "molcpp/export.hpp"
 #include "molcpp/types.hpp"
 #include "molcpp/box.hpp"
+#include "molcpp/box_series.hpp"
+#include "molcpp/box_view.hpp"
 #include "molcpp/compute.hpp"
+#include "molcpp/engine.hpp"
+#include "molcpp/fft.hpp"
+#include "molcpp/frame.hpp"
+#include "molcpp/key.hpp"
+#include "molcpp/neighbor.hpp"
+#include "molcpp/pipeline.hpp"
+#include "molcpp/region.hpp"
+#include "molcpp/simd.hpp"
+#include "molcpp/topology.hpp"
+#include "molcpp/trajectory.hpp"
 
 #endif // MOLCPP_HPP
\ No newline at end of file
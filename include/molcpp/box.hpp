@@ -3,9 +3,13 @@
 
 #include "molcpp/types.hpp"
 #include "molcpp/export.hpp"
+#include "molcpp/parallel.hpp"
 
 #include "xtensor-blas/xlinalg.hpp"
+#include <cstdint>
 #include <initializer_list>
+#include <span>
+#include <vector>
 #include <xtensor/xarray.hpp>
 #include <xtensor/xbuilder.hpp>
 #include <xtensor/xfixed.hpp>
@@ -15,6 +19,14 @@
 namespace molcpp
 {
 
+namespace detail
+{
+struct MicCell;
+}
+
+struct MoleculeTrees;
+class Topology;
+
 constexpr double pi = 3.141592653589793238463;
 
 static double deg2rad(double x)
@@ -84,7 +96,22 @@ class MOLCPP_EXPORT Region
     auto operator=(Region &&) -> Region & = default;
 
     /// Check if points is inside the region
-    virtual auto isin(const xt::xarray<double> &xyz) const -> xt::xarray<bool> = 0;
+    virtual auto isin(const xt::xarray<double> &xyz) const -> xt::xarray<bool>;
+
+    /// Set bit `i % 64` of `bits[i / 64]` if the i-th of `n` positions in a
+    /// contiguous (n, 3) buffer is inside the region, and clear it otherwise.
+    /// `bits` holds `(n + 63) / 64` words, and bits past `n` are cleared.
+    virtual void select(const double *xyz, size_t n, uint64_t *bits) const = 0;
+
+    /// Write in `mask[i]` whether the i-th position of the contiguous (n, 3)
+    /// buffer `xyz` is inside the region.
+    void isin(const double *xyz, size_t n, bool *mask) const;
+
+    /// Append to `indices` the indices of the positions inside the region
+    void select_indices(const double *xyz, size_t n, std::vector<uint32_t> &indices) const;
+
+    /// Number of positions inside the region
+    auto count(const double *xyz, size_t n) const -> size_t;
 
   private:
 };
@@ -162,7 +189,12 @@ class MOLCPP_EXPORT Box : public Region, public Boundary
 
     void set_lengths_tilts(const Vec3 &lengths, const Vec3 &tilts);
 
-    auto isin(const xt::xarray<double> &xyz) const -> xt::xarray<bool> override;
+    /// Positions inside the box, centered on the origin as `wrap` maps
+    /// positions to fractional coordinates in [-0.5, 0.5). Every position is
+    /// inside a `FREE` box.
+    void select(const double *xyz, size_t n, uint64_t *bits) const override;
+
+    using Region::isin;
 
     auto wrap(const xt::xarray<double> &xyz) const -> xt::xarray<double> override;
 
@@ -172,8 +204,68 @@ class MOLCPP_EXPORT Box : public Region, public Boundary
 
     auto wrap_free(const xt::xarray<double> &xyz) const -> xt::xarray<double>;
 
+    /// Wrap `n` positions stored as a contiguous (n, 3) buffer, in place and
+    /// without allocation.
+    void wrap_inplace(double *xyz, size_t n) const;
+
+    void wrap_inplace(std::span<double> xyz) const;
+
+    /// Wrap float positions in place. Fractional coordinates are computed in
+    /// double, so only the stored positions are rounded to float.
+    void wrap_inplace(float *xyz, size_t n) const;
+
+    void wrap_inplace(std::span<float> xyz) const;
+
+    void isin(std::span<const double> xyz, std::span<bool> mask) const;
+
+    /// Undo wrapping in place, moving each position by its (n, 3) image
+    /// flags: `xyz += matrix . images`.
+    void unwrap_inplace(double *xyz, const int *images, size_t n) const;
+
+    void unwrap_inplace(std::span<double> xyz, std::span<const int> images) const;
+
+    /// Undo wrapping in place, moving each position to the periodic image
+    /// closest to the matching position in the (n, 3) `reference` buffer.
+    void unwrap_inplace(double *xyz, const double *reference, size_t n) const;
+
+    void unwrap_inplace(std::span<double> xyz, std::span<const double> reference) const;
+
+    /// Update the (n, 3) image flags `images` of the wrapped positions `xyz`
+    /// from the wrapped positions `previous` of the previous frame, counting
+    /// the boundaries crossed by each atom in between. `unwrap_inplace` then
+    /// gives the positions unwrapped over time. Atoms must move by less than
+    /// half the box between the two frames.
+    void update_images(const double *xyz, const double *previous, int *images, size_t n,
+                       ExecutionPolicy policy = {}) const;
+
+    /// Make molecules whole in place: move the atoms of each molecule so that
+    /// every bond of its spanning tree in `trees` is its own minimum image,
+    /// keeping the first atom of the molecule in place. Bond vectors are
+    /// computed with the batched minimum-image kernel, and molecules are
+    /// processed in parallel.
+    void make_whole(double *xyz, size_t n, const MoleculeTrees &trees, ExecutionPolicy policy = {}) const;
+
+    /// Make the molecules of `topology` whole. Prefer the `MoleculeTrees`
+    /// overload to process many frames of the same topology.
+    void make_whole(double *xyz, size_t n, const Topology &topology, ExecutionPolicy policy = {}) const;
+
+    /// Minimum-image displacements `d[k] = mic(rj[k] - ri[k])` for `n` pairs
+    /// of SoA positions. Uses AVX2/AVX-512 when the CPU supports it.
+    void mic_displacements(SoA3<const double> ri, SoA3<const double> rj, size_t n, SoA3<double> d) const;
+
+    /// Minimum-image squared distances `r2[k] = |mic(rj[k] - ri[k])|^2` for
+    /// `n` pairs of SoA positions.
+    void mic_distances2(SoA3<const double> ri, SoA3<const double> rj, size_t n, double *r2) const;
+
+    /// Minimum-image displacements of float positions, which are converted to
+    /// double as they are loaded, so that images are found in double
+    /// precision while reading half as much memory
+    void mic_displacements(SoA3<const float> ri, SoA3<const float> rj, size_t n, SoA3<float> d) const;
+
+    void mic_distances2(SoA3<const float> ri, SoA3<const float> rj, size_t n, float *r2) const;
+
     auto get_style() const -> Style{
-        return calc_style_from_matrix(_matrix);
+        return _style;
     }
 
     auto get_matrix() const -> Mat3
@@ -183,19 +275,46 @@ class MOLCPP_EXPORT Box : public Region, public Boundary
 
     auto get_inv() const -> Mat3
     {
-        return xt::linalg::inv(_matrix);
+        return _inv;
     }
 
-    auto get_lengths() const -> Vec3;
+    auto get_lengths() const -> Vec3
+    {
+        return _lengths;
+    }
 
-    auto get_angles() const -> Vec3;
+    auto get_angles() const -> Vec3
+    {
+        return _angles;
+    }
 
-    auto get_volume() const -> double;
+    auto get_volume() const -> double
+    {
+        return _volume;
+    }
 
-    auto get_distance_between_faces() const -> Vec3;
+    auto get_distance_between_faces() const -> Vec3
+    {
+        return _faces;
+    }
 
   private:
+    /// Recompute every quantity derived from `_matrix`. Must be called
+    /// whenever `_matrix` changes, so that getters and `wrap` never have to.
+    void update_cache();
+
+    /// Cell description consumed by the batched minimum-image kernels
+    auto mic_cell() const -> detail::MicCell;
+
     Mat3 _matrix;
+
+    // derived from `_matrix` by `update_cache`
+    Style _style = FREE;
+    Mat3 _inv;
+    Vec3 _lengths;
+    Vec3 _angles;
+    double _volume = 0;
+    Vec3 _faces;
 };
 
 bool MOLCPP_EXPORT operator==(const Box &rhs, const Box &lhs);
@@ -0,0 +1,106 @@
+#ifndef MOLCPP_BOX_SERIES_HPP
+#define MOLCPP_BOX_SERIES_HPP
+
+#include "molcpp/box.hpp"
+#include "molcpp/export.hpp"
+#include "molcpp/parallel.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <xtensor/xarray.hpp>
+
+namespace molcpp
+{
+
+/// Boxes of the frames of a trajectory, as with a varying cell under NPT.
+/// The upper-triangular matrix of each frame and its inverse are stored
+/// contiguously, computed once when the frame is added: the inverse and the
+/// determinant of a triangular matrix come from its diagonal, without the
+/// LAPACK calls of `Box::set_matrix`. Bulk operations then work on every
+/// frame of a (frames, atoms, 3) buffer in one call.
+///
+///     BoxSeries boxes(matrices.data(), n_frames);
+///     boxes.wrap_inplace(xyz, 0, n_frames, n_atoms, {0});
+///     auto volumes = boxes.get_volumes();
+class MOLCPP_EXPORT BoxSeries
+{
+  public:
+    BoxSeries() = default;
+
+    /// Boxes of `n_frames` frames from a contiguous (n_frames, 3, 3) buffer
+    /// of row-major matrices, the columns being the box vectors as in
+    /// `Box::get_matrix`. An all-zero matrix is a `FREE` box.
+    BoxSeries(const double *matrices, size_t n_frames);
+
+    /// Boxes from matrices of shape (n_frames, 3, 3)
+    explicit BoxSeries(const xt::xarray<double> &matrices);
+
+    explicit BoxSeries(std::span<const Box> boxes);
+
+    /// Append the box of a frame, from a row-major 3x3 matrix
+    void push_back(const double *matrix);
+
+    void push_back(const Box &box);
+
+    void reserve(size_t n_frames);
+
+    auto n_frames() const -> size_t
+    {
+        return _styles.size();
+    }
+
+    auto get_style(size_t frame) const -> Box::Style
+    {
+        return _styles[frame];
+    }
+
+    /// Box of one frame
+    auto get_box(size_t frame) const -> Box;
+
+    /// Matrices of shape (n_frames, 3, 3)
+    auto get_matrices() const -> xt::xarray<double>;
+
+    /// Volume of each frame, 0 for `FREE` boxes
+    void volumes(double *out) const;
+
+    /// Lengths of the box vectors, as a contiguous (n_frames, 3) buffer
+    void lengths(double *out) const;
+
+    /// Angles between the box vectors in degrees, as a contiguous
+    /// (n_frames, 3) buffer, ordered as in `Box::get_angles`
+    void angles(double *out) const;
+
+    auto get_volumes() const -> xt::xarray<double>;
+
+    auto get_lengths() const -> xt::xarray<double>;
+
+    auto get_angles() const -> xt::xarray<double>;
+
+    /// Wrap the positions of frames `first` to `first + n_frames - 1` in
+    /// place, from a contiguous (n_frames, n_atoms, 3) buffer, each frame by
+    /// its own box as `Box::wrap_inplace` would. Frames and blocks of atoms
+    /// are processed in parallel.
+    void wrap_inplace(double *xyz, size_t first, size_t n_frames, size_t n_atoms, ExecutionPolicy policy = {}) const;
+
+    /// Wrap float positions, with fractional coordinates computed in double
+    void wrap_inplace(float *xyz, size_t first, size_t n_frames, size_t n_atoms, ExecutionPolicy policy = {}) const;
+
+    /// Wrapped copy of positions of shape (n_frames, n_atoms, 3), starting at
+    /// frame `first`
+    auto wrap(const xt::xarray<double> &xyz, size_t first = 0, ExecutionPolicy policy = {}) const
+        -> xt::xarray<double>;
+
+  private:
+    template <typename T>
+    void wrap_frames(T *xyz, size_t first, size_t n_frames, size_t n_atoms, ExecutionPolicy policy) const;
+
+    std::vector<Box::Style> _styles;
+    // upper triangles `{xx, xy, xz, yy, yz, zz}` of the matrix and of its
+    // inverse, 6 values per frame
+    std::vector<double> _h;
+    std::vector<double> _inv;
+};
+
+} // namespace molcpp
+#endif // MOLCPP_BOX_SERIES_HPP
@@ -0,0 +1,205 @@
+#ifndef MOLCPP_BOX_VIEW_HPP
+#define MOLCPP_BOX_VIEW_HPP
+
+#include "molcpp/box.hpp"
+#include "molcpp/types.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace molcpp
+{
+
+namespace detail
+{
+
+/// Nearest integer, halves rounded up, so that `x - round_half_up(x)` is in
+/// [-0.5, 0.5) as in `Box::wrap_inplace`. Also usable in constant
+/// expressions.
+template <typename T> constexpr auto round_half_up(T x) -> T
+{
+    if (std::is_constant_evaluated())
+    {
+        const T y = x + T(0.5);
+        const auto i = static_cast<long long>(y);
+        // the cast truncates toward zero, floor goes down
+        return static_cast<T>(static_cast<T>(i) > y ? i - 1 : i);
+    }
+    return std::floor(x + T(0.5));
+}
+
+} // namespace detail
+
+/// Box whose style `S` and scalar type `T` are fixed at compile time, for
+/// inner loops. Its kernels are inline, without virtual calls nor a branch on
+/// the style, and compute in `T`: with `float`, the cell and its inverse are
+/// rounded to single precision once, when the view is made.
+///
+/// Views copy the cell, so they stay valid when the box changes but do not
+/// follow it. Use `visit_box` to get the view matching a runtime box.
+template <Box::Style S, typename T = double> class BoxView
+{
+    static_assert(std::is_floating_point_v<T>, "BoxView needs a floating point scalar type");
+
+  public:
+    using value_type = T;
+    static constexpr Box::Style style = S;
+
+    constexpr BoxView() = default;
+
+    /// View of an upper-triangular cell `h` and its inverse `inv`, both
+    /// stored as `{xx, xy, xz, yy, yz, zz}`
+    constexpr BoxView(const std::array<T, 6> &h, const std::array<T, 6> &inv) : _h(h), _inv(inv)
+    {
+    }
+
+    /// View of `box`, which must have style `S`
+    explicit BoxView(const Box &box)
+    {
+        if (box.get_style() != S)
+        {
+            throw std::runtime_error("Box style does not match the view");
+        }
+        const Mat3 matrix = box.get_matrix();
+        const Mat3 inv = box.get_inv();
+        const std::pair<size_t, size_t> upper[6] = {{0, 0}, {0, 1}, {0, 2}, {1, 1}, {1, 2}, {2, 2}};
+        for (size_t k = 0; k < 6; k++)
+        {
+            _h[k] = static_cast<T>(matrix(upper[k].first, upper[k].second));
+            _inv[k] = static_cast<T>(inv(upper[k].first, upper[k].second));
+        }
+    }
+
+    /// Minimum image of the vector `(x, y, z)`, in place. This also wraps a
+    /// position in the box centered on the origin.
+    constexpr void mic(T &x, T &y, T &z) const
+    {
+        if constexpr (S == Box::ORTHOGONAL)
+        {
+            x -= _h[0] * detail::round_half_up(x * _inv[0]);
+            y -= _h[3] * detail::round_half_up(y * _inv[3]);
+            z -= _h[5] * detail::round_half_up(z * _inv[5]);
+        }
+        else if constexpr (S == Box::TRICLINIC)
+        {
+            T s0 = _inv[0] * x + _inv[1] * y + _inv[2] * z;
+            T s1 = _inv[3] * y + _inv[4] * z;
+            T s2 = _inv[5] * z;
+            s0 -= detail::round_half_up(s0);
+            s1 -= detail::round_half_up(s1);
+            s2 -= detail::round_half_up(s2);
+            x = _h[0] * s0 + _h[1] * s1 + _h[2] * s2;
+            y = _h[3] * s1 + _h[4] * s2;
+            z = _h[5] * s2;
+        }
+    }
+
+    /// Wrap the position `r[0..3]` in place
+    constexpr void wrap(T *r) const
+    {
+        mic(r[0], r[1], r[2]);
+    }
+
+    /// Minimum-image vector from `a` to `b`, written to `d`
+    constexpr void displacement(const T *a, const T *b, T *d) const
+    {
+        d[0] = b[0] - a[0];
+        d[1] = b[1] - a[1];
+        d[2] = b[2] - a[2];
+        mic(d[0], d[1], d[2]);
+    }
+
+    /// Squared minimum-image distance between `a` and `b`
+    constexpr auto distance2(const T *a, const T *b) const -> T
+    {
+        T d[3] = {};
+        displacement(a, b, d);
+        return d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+    }
+
+    /// Wrap `n` positions of a contiguous (n, 3) buffer in place
+    void wrap_inplace(T *xyz, size_t n) const
+    {
+        if constexpr (S != Box::FREE)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                wrap(xyz + 3 * i);
+            }
+        }
+    }
+
+    /// Minimum-image displacements `d[k] = mic(rj[k] - ri[k])` for `n` pairs
+    /// of SoA positions
+    void mic_displacements(SoA3<const T> ri, SoA3<const T> rj, size_t n, SoA3<T> d) const
+    {
+        for (size_t k = 0; k < n; k++)
+        {
+            T x = rj.x[k] - ri.x[k];
+            T y = rj.y[k] - ri.y[k];
+            T z = rj.z[k] - ri.z[k];
+            mic(x, y, z);
+            d.x[k] = x;
+            d.y[k] = y;
+            d.z[k] = z;
+        }
+    }
+
+    /// Minimum-image squared distances `r2[k] = |mic(rj[k] - ri[k])|^2` for
+    /// `n` pairs of SoA positions
+    void mic_distances2(SoA3<const T> ri, SoA3<const T> rj, size_t n, T *r2) const
+    {
+        for (size_t k = 0; k < n; k++)
+        {
+            T x = rj.x[k] - ri.x[k];
+            T y = rj.y[k] - ri.y[k];
+            T z = rj.z[k] - ri.z[k];
+            mic(x, y, z);
+            r2[k] = x * x + y * y + z * z;
+        }
+    }
+
+    constexpr auto get_h() const -> const std::array<T, 6> &
+    {
+        return _h;
+    }
+
+    constexpr auto get_inv() const -> const std::array<T, 6> &
+    {
+        return _inv;
+    }
+
+  private:
+    std::array<T, 6> _h = {};
+    std::array<T, 6> _inv = {};
+};
+
+/// Call `fn(view)` with the `BoxView<style, T>` of `box`, branching on its
+/// style once: write the loop over a batch inside `fn`, and it is compiled
+/// for each style. Returns what `fn` returns, which must be the same type for
+/// every style.
+///
+///     visit_box<float>(box, [&](const auto &view) {
+///         view.wrap_inplace(xyz, n);
+///     });
+template <typename T = double, typename F> decltype(auto) visit_box(const Box &box, F &&fn)
+{
+    switch (box.get_style())
+    {
+    case Box::FREE:
+        return std::forward<F>(fn)(BoxView<Box::FREE, T>(box));
+    case Box::ORTHOGONAL:
+        return std::forward<F>(fn)(BoxView<Box::ORTHOGONAL, T>(box));
+    case Box::TRICLINIC:
+        return std::forward<F>(fn)(BoxView<Box::TRICLINIC, T>(box));
+    default:
+        throw std::runtime_error("Invalid Style");
+    }
+}
+
+} // namespace molcpp
+#endif // MOLCPP_BOX_VIEW_HPP
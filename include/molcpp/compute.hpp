@@ -1,7 +1,21 @@
 #ifndef MOLCPP_COMPUTE_HPP
 #define MOLCPP_COMPUTE_HPP
+#include "molcpp/box.hpp"
+#include "molcpp/export.hpp"
+#include "molcpp/fft.hpp"
+#include "molcpp/neighbor.hpp"
+#include "molcpp/parallel.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 #include <xtensor/xarray.hpp>
+#include <xtensor/xbuilder.hpp>
+#include <xtensor/xmanipulation.hpp>
+#include <xtensor/xmath.hpp>
 #include <xtensor/xview.hpp>
 
 namespace molcpp
@@ -9,13 +23,26 @@ namespace molcpp
 
 class Result
 {
+  public:
+    Result(std::string key = "") : _key(std::move(key))
+    {
+    }
+
+    /// Name of the quantity held by the result
+    auto get_key() const -> const std::string &
+    {
+        return _key;
+    }
+
+  protected:
+    std::string _key;
 };
 
 template <typename T> class Result1D : public Result
 {
   public:
-    Result1D(std::string key = "") : _key(key) {};
-    Result1D(std::string key, const xt::xarray<T> &data) : _key(key), _data(data)
+    Result1D(std::string key = "") : Result(std::move(key)) {};
+    Result1D(std::string key, const xt::xarray<T> &data) : Result(std::move(key)), _data(data)
     {
     }
     auto get(std::string key) -> xt::xarray<T>
@@ -24,16 +51,128 @@ template <typename T> class Result1D : public Result
     }
 
   private:
-    std::string _key;
     xt::xarray<T> _data;
 };
 
+/// Values sampled along an axis, such as g(r) at the center of each bin
 class Result2D : public Result
 {
+  public:
+    Result2D(std::string key = "") : Result(std::move(key))
+    {
+    }
+    Result2D(std::string key, const xt::xarray<double> &axis, const xt::xarray<double> &data)
+        : Result(std::move(key)), _axis(axis), _data(data)
+    {
+    }
+
+    auto get_axis() const -> const xt::xarray<double> &
+    {
+        return _axis;
+    }
+
+    auto get() const -> const xt::xarray<double> &
+    {
+        return _data;
+    }
+
+  private:
+    xt::xarray<double> _axis;
+    xt::xarray<double> _data;
+};
+
+/// What a compute needs from every frame. A `ComputeEngine` prepares it
+/// once per frame for all its computes.
+struct FrameRequirements
+{
+    /// Cutoff of the half neighbor list with distances, 0 if not needed
+    double neighbor_cutoff = 0;
+    /// Whether the positions wrapped in the box are needed
+    bool wrapped = false;
+};
+
+/// One frame given to the computes of a `ComputeEngine`. Intermediates are
+/// computed when the frame is loaded, and shared by every compute.
+class MOLCPP_EXPORT FrameContext
+{
+  public:
+    /// Index of the frame in the trajectory
+    auto index() const -> size_t
+    {
+        return _index;
+    }
+
+    auto n_atoms() const -> size_t
+    {
+        return _n_atoms;
+    }
+
+    /// Positions as read, in a contiguous (n_atoms, 3) buffer
+    auto positions() const -> const double *
+    {
+        return _xyz;
+    }
+
+    auto box() const -> const Box &
+    {
+        return *_box;
+    }
+
+    /// Type of each atom, or `nullptr` if the engine was given none
+    auto types() const -> const int *
+    {
+        return _types;
+    }
+
+    /// Positions wrapped in the box, if a compute requested them
+    auto wrapped_positions() const -> const double *;
+
+    /// Half list of pairs closer than the largest cutoff requested by the
+    /// computes, with their distances. Computes with a smaller cutoff must
+    /// skip the pairs beyond it.
+    auto neighbors() const -> const NeighborList &;
+
+  private:
+    friend class ComputeEngine;
+
+    size_t _index = 0;
+    size_t _n_atoms = 0;
+    const double *_xyz = nullptr;
+    const Box *_box = nullptr;
+    const int *_types = nullptr;
+    bool _has_wrapped = false;
+    bool _has_neighbors = false;
+    std::vector<double> _wrapped;
+    NeighborList _list;
 };
 
+/// Base of the analyses. Besides their own API, computes which implement
+///
+///     void accumulate(const FrameContext &frame);
+///
+/// can be added to a `ComputeEngine`, which runs several of them in a
+/// single pass over a trajectory. The other hooks have defaults here, and
+/// are replaced by declaring them in `Derived`.
 template <typename Derived, typename ResultType> class Compute
 {
+  public:
+    using result_type = ResultType;
+
+    /// What `accumulate` needs from every frame
+    auto requirements() const -> FrameRequirements
+    {
+        return {};
+    }
+
+    /// Called before the first frame of a pass over `n_atoms` atoms
+    void begin(size_t)
+    {
+    }
+
+    /// Called after the last frame of a pass
+    void finalize()
+    {
+    }
 };
 
 class MSDCompute : public Compute<MSDCompute, Result1D<double>>
@@ -46,11 +185,25 @@ class MSDCompute : public Compute<MSDCompute, Result1D<double>>
         DIRECT,
         WINDOW
     };
-    MSDCompute(MSDStyle style = MSDStyle::DIRECT) : _style(style)
+    /// With `per_atom`, the `WINDOW` style keeps the MSD of each atom, with
+    /// shape (frames, atoms), instead of averaging over atoms. `policy`
+    /// sets the number of threads used by the `WINDOW` style.
+    MSDCompute(MSDStyle style = MSDStyle::DIRECT, bool per_atom = false, ExecutionPolicy policy = {})
+        : _style(style), _per_atom(per_atom), _policy(policy)
     {
     }
 
-    Result1D<double> compute(const xt::xarray<double> &xyz)
+    /// Compute the MSD of positions with shape (frames, atoms, 3), which
+    /// must be unwrapped. Besides `xt::xarray`, `xyz` can be any xtensor
+    /// container, such as the strided views of `BinaryTrajectory`, which are
+    /// used without copies as long as each frame is contiguous. Positions
+    /// may be stored as float, and are accumulated in double.
+    template <class E> Result1D<double> compute(const E &xyz)
+    {
+        return compute(xyz, _policy);
+    }
+
+    template <class E> Result1D<double> compute(const E &xyz, ExecutionPolicy policy)
     {
         Result1D<double> result;
         switch (_style)
@@ -60,6 +213,7 @@ class MSDCompute : public Compute<MSDCompute, Result1D<double>>
             break;
 
         case MSDStyle::WINDOW:
+            result = window_msd_compute(xyz, policy);
             break;
         default:
             break;
@@ -67,17 +221,260 @@ class MSDCompute : public Compute<MSDCompute, Result1D<double>>
         return result;
     }
 
-    Result1D<double> direct_msd_compute(const xt::xarray<double> &xyz)
+    /// Squared displacement of each coordinate from the first frame, with
+    /// the same shape as `xyz`. Float positions are subtracted in double.
+    template <class E> Result1D<double> direct_msd_compute(const E &xyz)
     {
         auto xyz0 = xt::view(xyz, 0, xt::all(), xt::all());
-        auto diff = xt::pow(xyz, 2) - xt::pow(xyz0, 2);
+        auto diff = xt::pow(xt::cast<double>(xyz) - xt::cast<double>(xyz0), 2);
         Result1D<double> result{"direct_msd", diff};
 
         return result;
     }
 
+    /// MSD averaged over all time origins for every lag, with shape
+    /// (frames) or (frames, atoms) with `per_atom`. Uses the FFT algorithm,
+    /// in O(frames log(frames)) per atom.
+    ///
+    /// Atoms are split in a fixed number of contiguous blocks, which threads
+    /// take from a shared queue. Each block sums its atoms in its own
+    /// accumulator, and the blocks are reduced in order, so the result is
+    /// the same for any number of threads.
+    template <class E> Result1D<double> window_msd_compute(const E &xyz, ExecutionPolicy policy = {})
+    {
+        if (xyz.dimension() != 3 || xyz.shape(2) != 3)
+        {
+            throw std::runtime_error("Positions must have shape (frames, atoms, 3)");
+        }
+        const size_t n_frames = xyz.shape(0);
+        const size_t n_atoms = xyz.shape(1);
+        // xtensor uses a stride of 0 for dimensions of size 1
+        if (xyz.strides()[2] != 1 || (n_atoms > 1 && xyz.strides()[1] != 3))
+        {
+            throw std::runtime_error("Positions of each frame must be contiguous");
+        }
+        const auto frame_stride = static_cast<size_t>(xyz.strides()[0]);
+        // views point `data()` at the start of the underlying buffer
+        const auto *origin = xyz.data() + xyz.data_offset();
+        const size_t n_blocks = std::max<size_t>(1, std::min<size_t>(n_atoms, MSD_BLOCKS));
+        const size_t n_threads = std::min(resolve_n_threads(policy.n_threads), n_blocks);
+
+        xt::xarray<double> per_atom;
+        xt::xarray<double> block_sums;
+        if (_per_atom)
+        {
+            per_atom = xt::zeros<double>({n_atoms, n_frames});
+        }
+        else
+        {
+            block_sums = xt::zeros<double>({n_blocks, n_frames});
+        }
+
+        std::vector<std::unique_ptr<WindowMSDKernel>> kernels(n_threads);
+        std::vector<std::vector<double>> scratch(n_threads);
+        parallel_for(n_blocks, n_threads, [&](size_t block, size_t thread) {
+            if (!kernels[thread])
+            {
+                kernels[thread] = std::make_unique<WindowMSDKernel>(n_frames);
+                scratch[thread].resize(n_frames);
+            }
+            double *msd = scratch[thread].data();
+            for (size_t atom = n_atoms * block / n_blocks; atom < n_atoms * (block + 1) / n_blocks; atom++)
+            {
+                if (_per_atom)
+                {
+                    msd = per_atom.data() + atom * n_frames;
+                }
+                kernels[thread]->compute(origin + 3 * atom, frame_stride, msd);
+                if (!_per_atom)
+                {
+                    double *sum = block_sums.data() + block * n_frames;
+                    for (size_t t = 0; t < n_frames; t++)
+                    {
+                        sum[t] += msd[t];
+                    }
+                }
+            }
+        });
+
+        if (_per_atom)
+        {
+            return {"window_msd", xt::transpose(per_atom)};
+        }
+        return {"window_msd", xt::sum(block_sums, {0}) / static_cast<double>(n_atoms)};
+    }
+
   private:
+    /// Number of blocks of atoms the `WINDOW` style is split in
+    static constexpr size_t MSD_BLOCKS = 256;
+
     MSDStyle _style;
+    bool _per_atom;
+    ExecutionPolicy _policy;
+};
+
+/// MSD accumulated one frame at a time, for trajectories too large to be
+/// held in memory.
+///
+/// Positions are unwrapped on the fly: each atom is moved to the periodic
+/// image closest to its previous unwrapped position, which is correct as
+/// long as atoms move less than half a box between frames.
+///
+/// Lags are sampled with a multiple-tau scheme: level 0 keeps the last
+/// `points_per_level` frames and gives lags 0 to `points_per_level - 1`,
+/// every `decimation`-th point of a level is passed to the next one, and
+/// level `l` gives lags `j * decimation^l` for `j` from
+/// `points_per_level / decimation`. Points are subsampled instead of block
+/// averaged, so every MSD value is an exact average over its (subsampled)
+/// time origins. Memory is `points_per_level * 3 * atoms` doubles per level
+/// reached, allocated when the level is first used.
+class MOLCPP_EXPORT StreamingMSDCompute : public Compute<StreamingMSDCompute, Result1D<double>>
+{
+  public:
+    explicit StreamingMSDCompute(size_t points_per_level = 16, size_t decimation = 2, size_t n_levels = 24);
+
+    /// Add a frame of `n_atoms` wrapped positions in a contiguous (n, 3)
+    /// buffer
+    void push_frame(const double *xyz, size_t n_atoms, const Box &box);
+
+    void push_frame(const xt::xarray<double> &xyz, const Box &box);
+
+    /// Add a frame of float positions, unwrapped and accumulated in double
+    void push_frame(const float *xyz, size_t n_atoms, const Box &box);
+
+    /// Forget the frames pushed so far, for a `ComputeEngine` pass
+    void begin(size_t n_atoms);
+
+    /// Push the positions of `frame`
+    void accumulate(const FrameContext &frame);
+
+    /// MSD for the lags given by `get_lags`, from the frames pushed so far
+    auto get_result() const -> Result1D<double>;
+
+    /// Lags, in frames, at which the MSD is known
+    auto get_lags() const -> xt::xarray<size_t>;
+
+    auto n_frames() const -> size_t
+    {
+        return _n_frames;
+    }
+
+    /// Bytes used by the history of positions
+    auto memory_usage() const -> size_t;
+
+  private:
+    template <typename T> void push(const T *xyz, size_t n_atoms, const Box &box);
+
+    void add(size_t level, const double *xyz);
+
+    size_t _points;
+    size_t _decimation;
+    size_t _n_levels;
+    size_t _n_atoms = 0;
+    size_t _n_frames = 0;
+
+    std::vector<double> _unwrapped;
+    std::vector<double> _scratch;
+    // circular (points, atoms, 3) history of each level, newest at `_head`
+    std::vector<std::vector<double>> _history;
+    std::vector<size_t> _head;
+    std::vector<size_t> _filled;
+    std::vector<size_t> _pushed;
+    // sum of squared displacements over atoms and number of time origins
+    // for each (level, point)
+    std::vector<double> _sums;
+    std::vector<size_t> _counts;
+};
+
+/// Radial distribution function g(r), accumulated over the frames given to
+/// `push_frame`.
+///
+/// Pairs closer than `r_max` come from a `CellList`, so a frame costs O(N).
+/// Threads histogram disjoint ranges of atoms in their own bins, which are
+/// added at the end of the frame; counts are integers, so the result does
+/// not depend on the number of threads. The normalization uses the volume
+/// of each frame: g(r) is the number of pairs found at r over all frames,
+/// divided by the number expected at the density of each frame, which
+/// handles boxes changing along NPT trajectories.
+class MOLCPP_EXPORT RDFCompute : public Compute<RDFCompute, Result2D>
+{
+  public:
+    /// Histogram distances in `n_bins` bins between 0 and `r_max`, which
+    /// must be at most half the distance between box faces
+    explicit RDFCompute(double r_max, size_t n_bins = 100, ExecutionPolicy policy = {});
+
+    /// Only count pairs between an atom of `type_a` and one of `type_b`, from
+    /// the types given to `push_frame`. Forgets the frames pushed so far.
+    void select_pair(int type_a, int type_b);
+
+    /// Count pairs between all atoms, the default. Forgets the frames pushed
+    /// so far.
+    void select_all();
+
+    /// Add a frame of `n_atoms` positions in a contiguous (n, 3) buffer, with
+    /// the type of each atom in `types`, which is required after
+    /// `select_pair`
+    void push_frame(const double *xyz, size_t n_atoms, const Box &box, const int *types = nullptr);
+
+    /// Add a frame of float positions, binned in double precision
+    void push_frame(const float *xyz, size_t n_atoms, const Box &box, const int *types = nullptr);
+
+    void push_frame(const xt::xarray<double> &xyz, const Box &box);
+
+    void push_frame(const xt::xarray<double> &xyz, const Box &box, const xt::xarray<int> &types);
+
+    /// Neighbor list up to `r_max`, for a `ComputeEngine` pass
+    auto requirements() const -> FrameRequirements
+    {
+        return {_r_max, false};
+    }
+
+    /// Forget the frames pushed so far, for a `ComputeEngine` pass
+    void begin(size_t n_atoms);
+
+    /// Add `frame`, using its shared neighbor list
+    void accumulate(const FrameContext &frame);
+
+    /// g(r) of positions with shape (frames, atoms, 3), all in `box`,
+    /// discarding frames pushed before
+    auto compute(const xt::xarray<double> &xyz, const Box &box) -> Result2D;
+
+    /// g(r) from the frames pushed so far, along the bin centers as axis
+    auto get_result() const -> Result2D;
+
+    auto get_bin_centers() const -> xt::xarray<double>;
+
+    /// Number of pairs found in each bin, over all frames
+    auto get_pair_counts() const -> xt::xarray<uint64_t>;
+
+    auto n_frames() const -> size_t
+    {
+        return _n_frames;
+    }
+
+    /// Forget all frames pushed so far
+    void reset();
+
+  private:
+    /// Histogram the pairs of `list` closer than `r_max`
+    void add_frame(const NeighborList &list, size_t n_atoms, const Box &box, const int *types);
+
+    double _r_max;
+    size_t _n_bins;
+    ExecutionPolicy _policy;
+    bool _select_pair = false;
+    int _type_a = 0;
+    int _type_b = 0;
+
+    CellList _cells;
+    NeighborList _list;
+    // bins of each thread, for the current frame
+    std::vector<std::vector<uint64_t>> _thread_counts;
+
+    size_t _n_frames = 0;
+    std::vector<uint64_t> _counts;
+    // sum over frames of the number of selected pairs over the volume
+    double _pair_density = 0;
 };
 
 } // namespace molcpp
@@ -0,0 +1,115 @@
+#ifndef MOLCPP_ENGINE_HPP
+#define MOLCPP_ENGINE_HPP
+
+#include "molcpp/box.hpp"
+#include "molcpp/compute.hpp"
+#include "molcpp/export.hpp"
+#include "molcpp/neighbor.hpp"
+#include "molcpp/parallel.hpp"
+#include "molcpp/trajectory.hpp"
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace molcpp
+{
+
+/// Run several computes in a single pass over the frames of a trajectory.
+/// Each frame is read once, and the intermediates requested by the computes,
+/// such as the neighbor list, are computed once and shared by all of them.
+///
+///     RDFCompute rdf(10.0);
+///     StreamingMSDCompute msd;
+///     ComputeEngine engine;
+///     engine.add(rdf);
+///     engine.add(msd);
+///     engine.run(trajectory);
+///
+/// Computes must outlive the engine. A pass calls `begin` on every compute,
+/// then `accumulate` for every frame in order, then `finalize`.
+class MOLCPP_EXPORT ComputeEngine
+{
+  public:
+    /// Use `policy` to build the shared intermediates
+    explicit ComputeEngine(ExecutionPolicy policy = {});
+
+    template <typename Derived, typename ResultType> void add(Compute<Derived, ResultType> &compute)
+    {
+        auto &derived = static_cast<Derived &>(compute);
+        _hooks.push_back({[&derived]() { return derived.requirements(); },
+                          [&derived](size_t n_atoms) { derived.begin(n_atoms); },
+                          [&derived](const FrameContext &frame) { derived.accumulate(frame); },
+                          [&derived]() { derived.finalize(); }});
+    }
+
+    auto n_computes() const -> size_t
+    {
+        return _hooks.size();
+    }
+
+    /// Type of each atom, given to every frame, or none if empty
+    void set_types(std::vector<int> types)
+    {
+        _types = std::move(types);
+    }
+
+    /// Run every compute on the frames `begin`, `begin + stride`, ... before
+    /// `end`, reading frames ahead in another thread
+    void run(const TrajectoryReader &reader, size_t begin, size_t end, size_t stride = 1);
+
+    /// Run every compute on every frame of `reader`
+    void run(const TrajectoryReader &reader);
+
+    /// Run every compute on positions with shape (frames, atoms, 3), all in
+    /// `box`
+    void run(const xt::xarray<double> &xyz, const Box &box);
+
+    /// Start a pass over frames of `n_atoms` atoms, for callers which read
+    /// frames themselves and give them to `accumulate`
+    void begin(size_t n_atoms);
+
+    /// Give a frame of positions in a contiguous (n_atoms, 3) buffer to
+    /// every compute
+    void accumulate(size_t frame, const double *xyz, size_t n_atoms, const Box &box);
+
+    /// End the pass
+    void finalize();
+
+    /// Seconds spent in each compute during the last pass, in the order
+    /// they were added, and in the shared intermediates
+    auto get_compute_times() const -> const std::vector<double> &
+    {
+        return _compute_times;
+    }
+
+    auto get_shared_time() const -> double
+    {
+        return _shared_time;
+    }
+
+  private:
+    struct Hooks
+    {
+        std::function<FrameRequirements()> requirements;
+        std::function<void(size_t)> begin;
+        std::function<void(const FrameContext &)> accumulate;
+        std::function<void()> finalize;
+    };
+
+    ExecutionPolicy _policy;
+    std::vector<Hooks> _hooks;
+    std::vector<int> _types;
+
+    // merged requirements of the current pass
+    FrameRequirements _requirements;
+    std::unique_ptr<CellList> _cells;
+    FrameContext _frame;
+
+    std::vector<double> _compute_times;
+    double _shared_time = 0;
+};
+
+} // namespace molcpp
+#endif // MOLCPP_ENGINE_HPP
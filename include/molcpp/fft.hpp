@@ -0,0 +1,79 @@
+#ifndef MOLCPP_FFT_HPP
+#define MOLCPP_FFT_HPP
+
+#include "molcpp/export.hpp"
+
+#include <complex>
+#include <vector>
+
+namespace molcpp
+{
+
+/// In place radix-2 complex FFT of a fixed power of two size. The twiddle
+/// factors and bit reversal permutation are computed once, so a single
+/// `FFT` should be reused for many transforms of the same size.
+class MOLCPP_EXPORT FFT
+{
+  public:
+    explicit FFT(size_t size);
+
+    /// Forward transform, `X[k] = sum_t x[t] exp(-2 i pi k t / size)`
+    void forward(std::complex<double> *data) const;
+
+    /// Inverse transform, including the `1 / size` normalization
+    void inverse(std::complex<double> *data) const;
+
+    auto size() const -> size_t
+    {
+        return _size;
+    }
+
+    /// Smallest power of two larger than or equal to `n`
+    static auto next_size(size_t n) -> size_t;
+
+  private:
+    void transform(std::complex<double> *data, bool inverse) const;
+
+    size_t _size;
+    std::vector<std::complex<double>> _twiddles;
+    std::vector<size_t> _bit_reversed;
+};
+
+/// Time-averaged mean squared displacement of a single particle over all
+/// time origins,
+///
+///     MSD(m) = 1 / (T - m) sum_{t=0}^{T-m-1} |r(t + m) - r(t)|^2
+///
+/// for every lag `m` in `[0, T)`, computed in O(T log T) with the FFT
+/// algorithm of Kneller et al. (Comput. Phys. Commun. 91, 191 (1995)):
+/// the cross term is an autocorrelation obtained by FFT, and the squared
+/// terms are accumulated with a recurrence.
+class MOLCPP_EXPORT WindowMSDKernel
+{
+  public:
+    explicit WindowMSDKernel(size_t n_frames);
+
+    /// Compute the MSD of the trajectory `r(t)_d = xyz[t * stride + d]` in
+    /// `msd[0]` to `msd[n_frames - 1]`
+    void compute(const double *xyz, size_t stride, double *msd);
+
+    /// Same with float positions, accumulated in double precision
+    void compute(const float *xyz, size_t stride, double *msd);
+
+    auto n_frames() const -> size_t
+    {
+        return _n_frames;
+    }
+
+  private:
+    template <typename T> void compute_impl(const T *xyz, size_t stride, double *msd);
+
+    size_t _n_frames;
+    FFT _fft;
+    std::vector<std::complex<double>> _xy;
+    std::vector<std::complex<double>> _z;
+    std::vector<double> _squares;
+};
+
+} // namespace molcpp
+#endif // MOLCPP_FFT_HPP
@@ -0,0 +1,219 @@
+#ifndef MOLCPP_FRAME_HPP
+#define MOLCPP_FRAME_HPP
+
+#include "molcpp/box.hpp"
+#include "molcpp/export.hpp"
+#include "molcpp/key.hpp"
+#include "molcpp/types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace molcpp
+{
+
+/// Element type of a `Frame` column
+enum class DType : uint8_t
+{
+    FLOAT64 = 0,
+    FLOAT32 = 1,
+    INT32 = 2,
+    INT64 = 3
+};
+
+template <typename T> struct DTypeOf;
+template <> struct DTypeOf<double>
+{
+    static constexpr DType value = DType::FLOAT64;
+};
+template <> struct DTypeOf<float>
+{
+    static constexpr DType value = DType::FLOAT32;
+};
+template <> struct DTypeOf<int32_t>
+{
+    static constexpr DType value = DType::INT32;
+};
+template <> struct DTypeOf<int64_t>
+{
+    static constexpr DType value = DType::INT64;
+};
+
+/// Bytes of one element of `dtype`
+MOLCPP_EXPORT auto dtype_size(DType dtype) -> size_t;
+
+namespace detail
+{
+
+/// Zero-initialized bytes, aligned on 64 bytes and padded to a multiple of
+/// 64 bytes, so that loops over a column can use aligned vector loads
+class MOLCPP_EXPORT AlignedBuffer
+{
+  public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    AlignedBuffer() = default;
+
+    explicit AlignedBuffer(size_t size);
+
+    ~AlignedBuffer();
+
+    AlignedBuffer(const AlignedBuffer &other);
+    auto operator=(const AlignedBuffer &other) -> AlignedBuffer &;
+    AlignedBuffer(AlignedBuffer &&other) noexcept;
+    auto operator=(AlignedBuffer &&other) noexcept -> AlignedBuffer &;
+
+    auto data() const -> std::byte *
+    {
+        return _data;
+    }
+
+    auto size() const -> size_t
+    {
+        return _size;
+    }
+
+    /// Change the size, keeping the first bytes and zeroing new ones
+    void resize(size_t size);
+
+  private:
+    std::byte *_data = nullptr;
+    size_t _size = 0;
+    size_t _capacity = 0;
+};
+
+} // namespace detail
+
+/// Atoms of one frame, with their box. Per-atom data is stored as a struct
+/// of arrays: each quantity is a contiguous, 64-byte aligned column of one
+/// of the `DType` types, so that loops over atoms read memory linearly.
+///
+/// Columns are named by interned `Key`s, and stored in a table indexed by
+/// key id: resolving a column is an array access, and the spans it returns
+/// can be kept across a loop. Positions are the `keys::X`, `keys::Y` and
+/// `keys::Z` columns, which every frame has.
+///
+///     Frame frame(n_atoms);
+///     auto charge = frame.add_column<double>(keys::CHARGE);
+///     auto [x, y, z] = frame.positions();
+///
+/// `resize` invalidates spans and pointers to every column, and
+/// `remove_column` those to the removed column. Adding columns leaves the
+/// memory of existing columns in place. Bindings give access to the column
+/// memory without copies.
+class MOLCPP_EXPORT Frame
+{
+  public:
+    /// Frame of `n_atoms` atoms, with zero positions
+    explicit Frame(size_t n_atoms = 0);
+
+    auto n_atoms() const -> size_t
+    {
+        return _n_atoms;
+    }
+
+    /// Change the number of atoms, keeping the values of the first atoms and
+    /// setting those of new atoms to zero
+    void resize(size_t n_atoms);
+
+    auto get_box() const -> const Box &
+    {
+        return _box;
+    }
+
+    void set_box(const Box &box)
+    {
+        _box = box;
+    }
+
+    /// Add a column of zeros named `key`, or return the existing column if
+    /// it has the same type
+    auto add_column(Key key, DType dtype) -> void *;
+
+    template <typename T> auto add_column(Key key) -> std::span<T>
+    {
+        return {static_cast<T *>(add_column(key, DTypeOf<T>::value)), _n_atoms};
+    }
+
+    auto has_column(Key key) const -> bool
+    {
+        return slot(key) != NONE;
+    }
+
+    void remove_column(Key key);
+
+    /// Keys of all columns, in the order they were added
+    auto column_keys() const -> std::vector<Key>;
+
+    auto column_type(Key key) const -> DType
+    {
+        return get(key).dtype;
+    }
+
+    /// Memory of the column `key`, holding `n_atoms()` elements of
+    /// `column_type(key)`
+    auto column_data(Key key) -> void *
+    {
+        return get(key).data.data();
+    }
+
+    auto column_data(Key key) const -> const void *
+    {
+        return get(key).data.data();
+    }
+
+    /// The column `key`, which must hold elements of type `T`
+    template <typename T> auto column(Key key) -> std::span<T>
+    {
+        return {static_cast<T *>(typed_data(key, DTypeOf<T>::value)), _n_atoms};
+    }
+
+    template <typename T> auto column(Key key) const -> std::span<const T>
+    {
+        return {static_cast<const T *>(const_cast<Frame *>(this)->typed_data(key, DTypeOf<T>::value)), _n_atoms};
+    }
+
+    /// The x, y and z columns
+    auto positions() -> SoA3<double>
+    {
+        return {column<double>(keys::X).data(), column<double>(keys::Y).data(), column<double>(keys::Z).data()};
+    }
+
+    /// Copy positions from a contiguous (n_atoms, 3) buffer
+    void set_positions(const double *xyz);
+
+    /// Copy positions to a contiguous (n_atoms, 3) buffer
+    void get_positions(double *xyz) const;
+
+  private:
+    struct Column
+    {
+        Key key;
+        DType dtype;
+        detail::AlignedBuffer data;
+    };
+
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    /// Index of the column `key` in `_columns`, or `NONE`
+    auto slot(Key key) const -> uint32_t
+    {
+        return key.id() < _slots.size() ? _slots[key.id()] : NONE;
+    }
+
+    auto get(Key key) const -> const Column &;
+    auto get(Key key) -> Column &;
+    auto typed_data(Key key, DType dtype) -> void *;
+
+    size_t _n_atoms = 0;
+    Box _box;
+    std::vector<Column> _columns;
+    // column index of each key id
+    std::vector<uint32_t> _slots;
+};
+
+} // namespace molcpp
+#endif // MOLCPP_FRAME_HPP
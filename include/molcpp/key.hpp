@@ -0,0 +1,76 @@
+#ifndef MOLCPP_KEY_HPP
+#define MOLCPP_KEY_HPP
+
+#include "molcpp/export.hpp"
+
+#include <compare>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace molcpp
+{
+
+/// Handle of an interned name. Each name is interned once in a process-wide
+/// table and gets a small integer id, so that containers can look keys up
+/// by id instead of hashing and comparing strings on every access:
+///
+///     const Key velocity("vx");   // resolved once
+///     auto vx = frame.column<double>(velocity);
+///
+/// Interning is thread-safe. Ids are dense, and the keys of `keys` below
+/// have fixed ids, so they are known at compile time.
+class MOLCPP_EXPORT Key
+{
+  public:
+    /// An invalid key, which matches no name
+    constexpr Key() = default;
+
+    /// Intern `name`, returning the same key for the same name
+    explicit Key(std::string_view name);
+
+    /// Key of the `id`-th interned name, which must exist
+    static constexpr auto from_id(uint32_t id) -> Key
+    {
+        Key key;
+        key._id = id;
+        return key;
+    }
+
+    constexpr auto id() const -> uint32_t
+    {
+        return _id;
+    }
+
+    constexpr auto is_valid() const -> bool
+    {
+        return _id != INVALID;
+    }
+
+    /// Interned name of this key
+    auto name() const -> const std::string &;
+
+    /// Number of names interned so far
+    static auto n_interned() -> size_t;
+
+    constexpr auto operator<=>(const Key &) const = default;
+
+  private:
+    static constexpr uint32_t INVALID = UINT32_MAX;
+    uint32_t _id = INVALID;
+};
+
+/// Keys of the usual per-atom quantities, interned before any other name
+namespace keys
+{
+inline constexpr Key X = Key::from_id(0);
+inline constexpr Key Y = Key::from_id(1);
+inline constexpr Key Z = Key::from_id(2);
+inline constexpr Key ID = Key::from_id(3);
+inline constexpr Key TYPE = Key::from_id(4);
+inline constexpr Key MASS = Key::from_id(5);
+inline constexpr Key CHARGE = Key::from_id(6);
+} // namespace keys
+
+} // namespace molcpp
+#endif // MOLCPP_KEY_HPP
@@ -0,0 +1,233 @@
+#ifndef MOLCPP_NEIGHBOR_HPP
+#define MOLCPP_NEIGHBOR_HPP
+
+#include "molcpp/box.hpp"
+#include "molcpp/export.hpp"
+#include "molcpp/parallel.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <xtensor/xarray.hpp>
+
+namespace molcpp
+{
+
+/// Pairs of atoms closer than a cutoff, in compressed sparse row format: the
+/// neighbors of atom `i` are `indices[offsets[i]]` to
+/// `indices[offsets[i + 1] - 1]`, at the matching `distances` if requested.
+struct MOLCPP_EXPORT NeighborList
+{
+    std::vector<size_t> offsets;
+    std::vector<uint32_t> indices;
+    std::vector<double> distances;
+
+    auto n_atoms() const -> size_t
+    {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    auto n_pairs() const -> size_t
+    {
+        return indices.size();
+    }
+
+    auto neighbors(size_t i) const -> std::span<const uint32_t>
+    {
+        return {indices.data() + offsets[i], indices.data() + offsets[i + 1]};
+    }
+
+    /// Bytes used by the list storage
+    auto memory_usage() const -> size_t
+    {
+        return offsets.capacity() * sizeof(size_t) + indices.capacity() * sizeof(uint32_t) +
+               distances.capacity() * sizeof(double);
+    }
+};
+
+/// Linked-cell neighbor search. Atoms are binned in cells at least `cutoff`
+/// wide, and only the 27 surrounding cells are searched, so a build is
+/// linear in the number of atoms.
+///
+/// Periodic boxes are binned in fractional coordinates, with as many cells
+/// along each axis as fit in the distance between the box faces, which keeps
+/// triclinic cells correct. A `FREE` box uses a grid over the bounding box
+/// of the positions.
+class MOLCPP_EXPORT CellList
+{
+  public:
+    /// Search pairs closer than `cutoff`. With `full`, each pair is stored
+    /// for both atoms, otherwise only for the lowest index. With
+    /// `with_distances`, pair distances are stored alongside the indices.
+    explicit CellList(double cutoff, bool full = false, bool with_distances = false);
+
+    /// Build the list for `n` positions in a contiguous (n, 3) buffer
+    void build(const double *xyz, size_t n, const Box &box, NeighborList &list);
+
+    auto build(const double *xyz, size_t n, const Box &box) -> NeighborList;
+
+    auto build(const xt::xarray<double> &xyz, const Box &box) -> NeighborList;
+
+    /// Build the list for float positions. They are binned in double
+    /// precision fractional coordinates, so only the storage is float.
+    void build(const float *xyz, size_t n, const Box &box, NeighborList &list);
+
+    auto build(const float *xyz, size_t n, const Box &box) -> NeighborList;
+
+    auto get_cutoff() const -> double
+    {
+        return _cutoff;
+    }
+
+    /// Use `n_threads` threads for the builds, 0 meaning one per hardware
+    /// thread. The list does not depend on the number of threads.
+    void set_n_threads(size_t n_threads)
+    {
+        _n_threads = n_threads;
+    }
+
+    auto get_n_threads() const -> size_t
+    {
+        return _n_threads;
+    }
+
+    /// Number of cells along each axis used by the last build
+    auto get_grid() const -> std::array<size_t, 3>
+    {
+        return _grid;
+    }
+
+  private:
+    template <typename T> void bin(const T *xyz, size_t n, const Box &box);
+
+    /// Replace the `n` values by their inclusive prefix sums, in parallel
+    void prefix_sum(size_t *values, size_t n) const;
+
+    /// Search the atoms binned by `bin`, for the style of `box`
+    void search_binned(const Box &box, NeighborList &list);
+
+    /// Pairs found for a range of atoms, taken in cell order
+    struct Chunk
+    {
+        std::vector<uint32_t> indices;
+        std::vector<double> distances;
+        std::vector<uint32_t> counts; // number of neighbors of each atom
+    };
+
+    template <Box::Style S> void search(const Box &box, NeighborList &list);
+
+    template <Box::Style S> void search_range(const Box &box, size_t begin, size_t end, Chunk &chunk) const;
+
+    /// Gather the pairs of all chunks in a list in atom order
+    void merge(NeighborList &list) const;
+
+    /// Number of independent pieces of work to split a build in
+    auto n_tasks() const -> size_t
+    {
+        return _n_threads == 1 ? 1 : 16 * resolve_n_threads(_n_threads);
+    }
+
+    double _cutoff;
+    bool _full;
+    bool _with_distances;
+    size_t _n_threads = 1;
+
+    // buffers reused between builds
+    std::array<size_t, 3> _grid = {0, 0, 0};
+    std::array<bool, 3> _periodic = {false, false, false};
+    std::vector<double> _coords;      // binning coordinates, in atom order
+    std::vector<uint32_t> _cell_of;   // cell of each atom
+    std::vector<size_t> _cell_start;  // CSR offsets of atoms in each cell
+    std::vector<uint32_t> _sorted;    // atoms sorted by cell
+    std::vector<double> _sorted_coords;
+    std::vector<size_t> _chunk_start; // first sorted atom of each chunk
+    std::vector<Chunk> _chunks;
+};
+
+/// Counters of a `VerletList`, to tune its skin
+struct VerletStats
+{
+    /// Number of calls to `update`
+    size_t n_updates = 0;
+    /// Number of times the list was rebuilt
+    size_t n_rebuilds = 0;
+    /// Largest atom displacement since the last rebuild, at the last update
+    double max_displacement = 0;
+    /// Seconds spent rebuilding the list
+    double rebuild_time = 0;
+    /// Seconds spent checking whether a rebuild was needed
+    double check_time = 0;
+};
+
+/// Neighbor list with a skin, for consecutive frames of a trajectory.
+///
+/// The list holds all pairs closer than `cutoff + skin` in the frame it was
+/// built for, and stays valid while no pair can have moved from outside
+/// `cutoff + skin` to inside `cutoff`. `update` only rebuilds it when
+/// `2 * max_displacement + deformation > skin`, where `max_displacement` is
+/// the largest minimum-image displacement since the last build and
+/// `deformation` bounds how much a change of the box (e.g. in NPT
+/// trajectories) moves periodic images: the sum of the norms of the
+/// changes of the three cell vectors.
+class MOLCPP_EXPORT VerletList
+{
+  public:
+    VerletList(double cutoff, double skin, bool full = false);
+
+    /// Update the list for new positions in a contiguous (n, 3) buffer.
+    /// Returns `true` if the list was rebuilt.
+    auto update(const double *xyz, size_t n, const Box &box) -> bool;
+
+    auto update(const xt::xarray<double> &xyz, const Box &box) -> bool;
+
+    /// Pairs closer than `cutoff + skin` at the last rebuild, with their
+    /// distances at that time
+    auto get_list() const -> const NeighborList &
+    {
+        return _list;
+    }
+
+    auto get_stats() const -> const VerletStats &
+    {
+        return _stats;
+    }
+
+    void reset_stats()
+    {
+        _stats = VerletStats();
+    }
+
+    auto get_cutoff() const -> double
+    {
+        return _cutoff;
+    }
+
+    auto get_skin() const -> double
+    {
+        return _skin;
+    }
+
+    /// Number of threads used to rebuild the list, see `CellList`
+    void set_n_threads(size_t n_threads)
+    {
+        _cells.set_n_threads(n_threads);
+    }
+
+  private:
+    auto needs_rebuild(const double *xyz, size_t n, const Box &box) -> bool;
+
+    double _cutoff;
+    double _skin;
+    CellList _cells;
+    NeighborList _list;
+
+    bool _built = false;
+    Box _reference_box;
+    std::vector<double> _reference;
+    std::vector<double> _displacements;
+    VerletStats _stats;
+};
+
+} // namespace molcpp
+#endif // MOLCPP_NEIGHBOR_HPP
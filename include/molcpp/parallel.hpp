@@ -0,0 +1,183 @@
+#ifndef MOLCPP_PARALLEL_HPP
+#define MOLCPP_PARALLEL_HPP
+
+#include "molcpp/export.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef MOLCPP_USE_OPENMP
+#include <omp.h>
+#endif
+
+namespace molcpp
+{
+
+/// How a computation spreads its work over threads
+struct ExecutionPolicy
+{
+    /// Number of threads, 0 meaning one per hardware thread
+    size_t n_threads = 1;
+};
+
+/// Number of threads to use when asked for `n_threads`, where 0 means one
+/// per hardware thread
+inline auto resolve_n_threads(size_t n_threads) -> size_t
+{
+    if (n_threads == 0)
+    {
+        n_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    return n_threads;
+}
+
+namespace detail
+{
+
+/// Worker threads kept alive between calls of `parallel_for`, so that a call
+/// costs a wake up of the workers instead of starting and joining threads.
+/// Workers are started on demand, up to the largest number of threads asked
+/// for, and stopped when the program exits.
+class MOLCPP_EXPORT ThreadPool
+{
+  public:
+    ThreadPool() = default;
+    ThreadPool(const ThreadPool &) = delete;
+    auto operator=(const ThreadPool &) -> ThreadPool & = delete;
+    ~ThreadPool();
+
+    /// The pool used by `parallel_for`
+    static auto global() -> ThreadPool &;
+
+    /// Call `job(thread)` for every `thread` in `[0, n_threads)`, thread 0
+    /// on the calling thread, and return true once all calls returned.
+    /// Returns false without calling `job` if the pool is already running a
+    /// job, as for a nested `parallel_for` or one in another thread. `job`
+    /// must not throw.
+    template <typename F> auto try_run(size_t n_threads, F &job) -> bool
+    {
+        return try_run(n_threads, [](void *context, size_t thread) { (*static_cast<F *>(context))(thread); }, &job);
+    }
+
+    auto try_run(size_t n_threads, void (*job)(void *, size_t), void *context) -> bool;
+
+  private:
+    void work(size_t thread, uint64_t generation);
+
+    std::atomic<bool> _busy{false};
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::vector<std::thread> _workers;
+    // current job, guarded by `_mutex`
+    void (*_job)(void *, size_t) = nullptr;
+    void *_context = nullptr;
+    size_t _n_threads = 0;
+    size_t _pending = 0;
+    uint64_t _generation = 0;
+    bool _stop = false;
+};
+
+/// Call `job(thread)` for every `thread` in `[0, n_threads)` on the global
+/// pool, or on threads started for this call when the pool is busy
+template <typename F> void run_on_threads(size_t n_threads, F &job)
+{
+    if (ThreadPool::global().try_run(n_threads, job))
+    {
+        return;
+    }
+    std::vector<std::thread> threads;
+    threads.reserve(n_threads - 1);
+    for (size_t thread = 1; thread < n_threads; thread++)
+    {
+        threads.emplace_back(job, thread);
+    }
+    job(size_t{0});
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+} // namespace detail
+
+/// Call `fn(task, thread)` for every task in `[0, n_tasks)` using up to
+/// `n_threads` threads (0 for all hardware threads). `thread` is in
+/// `[0, n_threads)` and can index per-thread scratch buffers.
+///
+/// Tasks are handed out one at a time from a shared counter, so a thread
+/// that finishes early keeps taking the remaining tasks of the others: split
+/// the work in more tasks than threads to balance uneven workloads. Threads
+/// come from a pool kept between calls. With the `MOLCPP_USE_OPENMP` backend,
+/// an OpenMP dynamic schedule on the OpenMP thread pool does the same.
+/// The first exception thrown by `fn` is rethrown once all threads stopped.
+template <typename F> void parallel_for(size_t n_tasks, size_t n_threads, F &&fn)
+{
+    n_threads = std::min(resolve_n_threads(n_threads), n_tasks);
+    if (n_threads <= 1)
+    {
+        for (size_t task = 0; task < n_tasks; task++)
+        {
+            fn(task, size_t{0});
+        }
+        return;
+    }
+
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto guarded = [&](size_t task, size_t thread) {
+        try
+        {
+            fn(task, thread);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    };
+
+#ifdef MOLCPP_USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(static_cast<int>(n_threads))
+    for (long task = 0; task < static_cast<long>(n_tasks); task++)
+    {
+        guarded(static_cast<size_t>(task), static_cast<size_t>(omp_get_thread_num()));
+    }
+#else
+    std::atomic<size_t> next{0};
+    auto worker = [&](size_t thread) {
+        for (size_t task = next++; task < n_tasks; task = next++)
+        {
+            guarded(task, thread);
+        }
+    };
+    detail::run_on_threads(n_threads, worker);
+#endif
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+/// Split `[0, n)` in `n_ranges` contiguous ranges of (almost) equal sizes
+/// and call `fn(begin, end)` on each of them with `parallel_for`. The ranges
+/// only depend on `n` and `n_ranges`, not on the number of threads.
+template <typename F> void parallel_ranges(size_t n, size_t n_ranges, size_t n_threads, F &&fn)
+{
+    n_ranges = std::max<size_t>(1, std::min(n, n_ranges));
+    parallel_for(n_ranges, n_threads, [&](size_t range, size_t) { fn(n * range / n_ranges, n * (range + 1) / n_ranges); });
+}
+
+} // namespace molcpp
+#endif // MOLCPP_PARALLEL_HPP
@@ -0,0 +1,114 @@
+#ifndef MOLCPP_PIPELINE_HPP
+#define MOLCPP_PIPELINE_HPP
+
+#include "molcpp/box.hpp"
+#include "molcpp/export.hpp"
+#include "molcpp/trajectory.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace molcpp
+{
+
+/// Positions and box of one frame. Buffers belong to a `FramePipeline`, and
+/// are reused for later frames once every consumer has seen them.
+struct FrameBuffer
+{
+    /// Index of the frame in the trajectory
+    size_t frame = 0;
+    /// Positions, as a contiguous (n_atoms, 3) buffer
+    std::vector<double> xyz;
+    Box box;
+};
+
+/// Where the time of a `FramePipeline` run went, in seconds
+struct PipelineStats
+{
+    size_t n_frames = 0;
+    /// Time spent decoding frames, summed over reader threads
+    double read_time = 0;
+    /// Time reader threads spent waiting for a free buffer: when large,
+    /// consumers are the bottleneck
+    double read_wait_time = 0;
+    /// Time consumers waited for the next frame: when large, reading is the
+    /// bottleneck
+    double io_wait_time = 0;
+    /// Time spent in each consumer, in the order they were added
+    std::vector<double> compute_time;
+};
+
+/// Feed the frames of a trajectory to several consumers in a single pass.
+/// Reader threads decode the next `depth` frames while consumers process
+/// the current one, and frames go through `depth` buffers allocated once,
+/// so that a run does not allocate once started.
+///
+///     FramePipeline pipeline(trajectory);
+///     pipeline.add_consumer([&](const FrameBuffer &frame) {
+///         msd.push_frame(frame.xyz.data(), trajectory.n_atoms(), frame.box);
+///     });
+///     pipeline.run();
+///
+/// Consumers are called on the thread calling `run`, for every frame in
+/// order, even with several reader threads.
+class MOLCPP_EXPORT FramePipeline
+{
+  public:
+    using Consumer = std::function<void(const FrameBuffer &)>;
+
+    /// Read frames of `reader`, which must outlive the pipeline, up to
+    /// `depth` frames ahead of consumers with `n_readers` threads
+    explicit FramePipeline(const TrajectoryReader &reader, size_t depth = 4, size_t n_readers = 1);
+
+    FramePipeline(const FramePipeline &) = delete;
+    auto operator=(const FramePipeline &) -> FramePipeline & = delete;
+
+    void add_consumer(Consumer consumer);
+
+    /// Give the frames `begin`, `begin + stride`, ... before `end` to every
+    /// consumer. Exceptions thrown while reading or by a consumer stop the
+    /// run and are rethrown here.
+    void run(size_t begin, size_t end, size_t stride = 1);
+
+    /// Give every frame of the trajectory to every consumer
+    void run();
+
+    /// Statistics of the last run
+    auto get_stats() const -> const PipelineStats &
+    {
+        return _stats;
+    }
+
+    auto get_depth() const -> size_t
+    {
+        return _buffers.size();
+    }
+
+  private:
+    void read_frames(size_t begin, size_t stride, size_t n_frames);
+    void stop(std::exception_ptr error);
+
+    const TrajectoryReader &_reader;
+    size_t _n_readers;
+    std::vector<Consumer> _consumers;
+    PipelineStats _stats;
+
+    // frame `k` of a run goes in buffer `k % depth`
+    std::vector<FrameBuffer> _buffers;
+    // which frame of the run each buffer holds, or `EMPTY`
+    std::vector<size_t> _ready;
+    static constexpr size_t EMPTY = static_cast<size_t>(-1);
+    size_t _next = 0;
+    size_t _consumed = 0;
+    bool _stopped = false;
+    std::exception_ptr _error;
+    std::mutex _mutex;
+    std::condition_variable _frame_ready;
+    std::condition_variable _buffer_free;
+};
+
+} // namespace molcpp
+#endif // MOLCPP_PIPELINE_HPP
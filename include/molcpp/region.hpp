@@ -0,0 +1,135 @@
+#ifndef MOLCPP_REGION_HPP
+#define MOLCPP_REGION_HPP
+
+#include "molcpp/box.hpp"
+#include "molcpp/export.hpp"
+#include "molcpp/types.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace molcpp
+{
+
+// Regions test positions as given: wrap them first to select atoms of a
+// periodic system in a region crossing the box boundaries.
+
+/// Points closer than `radius` to `center`
+class MOLCPP_EXPORT Sphere : public Region
+{
+  public:
+    Sphere(const Vec3 &center, double radius);
+
+    void select(const double *xyz, size_t n, uint64_t *bits) const override;
+
+    auto get_center() const -> Vec3
+    {
+        return _center;
+    }
+
+    auto get_radius() const -> double
+    {
+        return _radius;
+    }
+
+  private:
+    Vec3 _center;
+    double _radius;
+};
+
+/// Points closer than `radius` to the line through `center` along `axis`,
+/// and within `length / 2` of `center` along the axis
+class MOLCPP_EXPORT Cylinder : public Region
+{
+  public:
+    Cylinder(const Vec3 &center, const Vec3 &axis, double radius,
+             double length = std::numeric_limits<double>::infinity());
+
+    void select(const double *xyz, size_t n, uint64_t *bits) const override;
+
+    auto get_center() const -> Vec3
+    {
+        return _center;
+    }
+
+    /// Unit vector along the axis
+    auto get_axis() const -> Vec3
+    {
+        return _axis;
+    }
+
+    auto get_radius() const -> double
+    {
+        return _radius;
+    }
+
+    auto get_length() const -> double
+    {
+        return _length;
+    }
+
+  private:
+    Vec3 _center;
+    Vec3 _axis;
+    double _radius;
+    double _length;
+};
+
+/// Points `r` with `lo <= r . normal < hi`, for a unit `normal`
+class MOLCPP_EXPORT Slab : public Region
+{
+  public:
+    Slab(const Vec3 &normal, double lo, double hi);
+
+    void select(const double *xyz, size_t n, uint64_t *bits) const override;
+
+    /// Unit normal of the slab
+    auto get_normal() const -> Vec3
+    {
+        return _normal;
+    }
+
+    auto get_lo() const -> double
+    {
+        return _lo;
+    }
+
+    auto get_hi() const -> double
+    {
+        return _hi;
+    }
+
+  private:
+    Vec3 _normal;
+    double _lo;
+    double _hi;
+};
+
+/// Points inside any of the regions
+class MOLCPP_EXPORT Union : public Region
+{
+  public:
+    explicit Union(std::vector<std::shared_ptr<const Region>> regions);
+
+    void select(const double *xyz, size_t n, uint64_t *bits) const override;
+
+  private:
+    std::vector<std::shared_ptr<const Region>> _regions;
+};
+
+/// Points inside all of the regions
+class MOLCPP_EXPORT Intersection : public Region
+{
+  public:
+    explicit Intersection(std::vector<std::shared_ptr<const Region>> regions);
+
+    void select(const double *xyz, size_t n, uint64_t *bits) const override;
+
+  private:
+    std::vector<std::shared_ptr<const Region>> _regions;
+};
+
+} // namespace molcpp
+#endif // MOLCPP_REGION_HPP
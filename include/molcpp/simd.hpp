@@ -0,0 +1,29 @@
+#ifndef MOLCPP_SIMD_HPP
+#define MOLCPP_SIMD_HPP
+
+#include "molcpp/export.hpp"
+
+namespace molcpp
+{
+
+/// Instruction sets the batched kernels can run on, from slowest to fastest
+enum class SimdLevel
+{
+    SCALAR,
+    AVX2,
+    AVX512
+};
+
+/// Best instruction set supported by the running CPU
+MOLCPP_EXPORT auto detect_simd_level() -> SimdLevel;
+
+/// Instruction set currently used by the batched kernels. Defaults to
+/// `detect_simd_level()`.
+MOLCPP_EXPORT auto get_simd_level() -> SimdLevel;
+
+/// Restrict the batched kernels to `level`, or to the best supported level
+/// if the CPU can not run `level`. Mostly useful for testing and benchmarks.
+MOLCPP_EXPORT void set_simd_level(SimdLevel level);
+
+} // namespace molcpp
+#endif // MOLCPP_SIMD_HPP
@@ -0,0 +1,142 @@
+#ifndef MOLCPP_TOPOLOGY_HPP
+#define MOLCPP_TOPOLOGY_HPP
+
+#include "molcpp/box.hpp"
+#include "molcpp/export.hpp"
+#include "molcpp/parallel.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <xtensor/xarray.hpp>
+
+namespace molcpp
+{
+
+typedef std::array<uint32_t, 2> Bond;
+typedef std::array<uint32_t, 3> Angle;
+typedef std::array<uint32_t, 4> Dihedral;
+typedef std::array<uint32_t, 4> Improper;
+
+/// Spanning tree of each molecule, as the bonds to follow from its first
+/// atom: the edges of molecule `m` are `edges[offsets[m]]` to
+/// `edges[offsets[m + 1] - 1]`, as `(parent, child)` pairs in breadth-first
+/// order, so that each parent is reached before its children.
+struct MOLCPP_EXPORT MoleculeTrees
+{
+    std::vector<size_t> offsets;
+    std::vector<Bond> edges;
+
+    auto n_molecules() const -> size_t
+    {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+};
+
+/// Bond graph of a system, stored as a compressed sparse row adjacency: the
+/// atoms bonded to atom `i` are `adjacency[offsets[i]]` to
+/// `adjacency[offsets[i + 1] - 1]`, sorted. Each bond appears once for each
+/// of its atoms, so the graph takes 8 bytes per bond and 4 per atom.
+///
+/// Angles, dihedrals and impropers are not stored, but enumerated from the
+/// graph in time linear in their number, and molecules are the connected
+/// components of the graph.
+///
+///     Topology topology(n_atoms);
+///     topology.guess_bonds(xyz, n_atoms, box, 1.6);
+///     auto angles = topology.angles();
+///     auto molecules = topology.molecules();
+class MOLCPP_EXPORT Topology
+{
+  public:
+    /// Topology of `n_atoms` atoms without bonds, using `policy` for the
+    /// enumerations and bond guessing
+    explicit Topology(size_t n_atoms = 0, ExecutionPolicy policy = {});
+
+    auto n_atoms() const -> size_t
+    {
+        return _offsets.size() - 1;
+    }
+
+    auto n_bonds() const -> size_t
+    {
+        return _adjacency.size() / 2;
+    }
+
+    /// Replace the bonds by `n_bonds` pairs of atoms in a contiguous
+    /// (n_bonds, 2) buffer. Bonds given twice are kept once.
+    void set_bonds(const uint32_t *pairs, size_t n_bonds);
+
+    void set_bonds(std::span<const Bond> bonds);
+
+    void set_bonds(const xt::xarray<uint32_t> &bonds);
+
+    /// Replace the bonds by the pairs of atoms closer than `cutoff`, taking
+    /// periodic images into account, from `n` positions in a contiguous
+    /// (n, 3) buffer
+    void guess_bonds(const double *xyz, size_t n, const Box &box, double cutoff);
+
+    /// Replace the bonds by the pairs of atoms `i` and `j` closer than
+    /// `radii[i] + radii[j] + tolerance`, as with covalent radii
+    void guess_bonds(const double *xyz, size_t n, const Box &box, std::span<const double> radii, double tolerance);
+
+    /// Atoms bonded to atom `i`, sorted
+    auto neighbors(size_t i) const -> std::span<const uint32_t>
+    {
+        return {_adjacency.data() + _offsets[i], _adjacency.data() + _offsets[i + 1]};
+    }
+
+    auto degree(size_t i) const -> size_t
+    {
+        return _offsets[i + 1] - _offsets[i];
+    }
+
+    /// Bonds `(i, j)` with `i < j`, sorted
+    auto bonds() const -> std::vector<Bond>;
+
+    /// Angles `(i, j, k)` centered on `j`, with `i < k`
+    auto angles() const -> std::vector<Angle>;
+
+    /// Proper dihedrals `(i, j, k, l)` around the bond `(j, k)`, with `j < k`
+    auto dihedrals() const -> std::vector<Dihedral>;
+
+    /// Impropers `(i, j, k, l)` centered on `i`, for every triple `j < k < l`
+    /// of atoms bonded to `i`
+    auto impropers() const -> std::vector<Improper>;
+
+    /// Number of angles, without enumerating them
+    auto n_angles() const -> size_t;
+
+    /// Number of impropers, without enumerating them
+    auto n_impropers() const -> size_t;
+
+    /// Molecule of each atom: connected components of the bond graph,
+    /// numbered in order of their first atom
+    auto molecules() const -> std::vector<uint32_t>;
+
+    /// Number of molecules, isolated atoms included
+    auto n_molecules() const -> size_t;
+
+    /// Spanning trees of the molecules, numbered as in `molecules`, to make
+    /// them whole with `Box::make_whole`
+    auto molecule_trees() const -> MoleculeTrees;
+
+    /// Bytes used by the graph storage
+    auto memory_usage() const -> size_t
+    {
+        return _offsets.capacity() * sizeof(uint32_t) + _adjacency.capacity() * sizeof(uint32_t);
+    }
+
+  private:
+    /// Build the adjacency from the bonds given by `for_each_bond(fn)`,
+    /// which calls `fn(a, b)` for each bond, the same way on every call
+    template <typename ForEachBond> void build(ForEachBond &&for_each_bond);
+
+    ExecutionPolicy _policy;
+    std::vector<uint32_t> _offsets;
+    std::vector<uint32_t> _adjacency;
+};
+
+} // namespace molcpp
+#endif // MOLCPP_TOPOLOGY_HPP
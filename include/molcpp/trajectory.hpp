@@ -0,0 +1,452 @@
+#ifndef MOLCPP_TRAJECTORY_HPP
+#define MOLCPP_TRAJECTORY_HPP
+
+#include "molcpp/box.hpp"
+#include "molcpp/export.hpp"
+#include "molcpp/parallel.hpp"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <xtensor/xadapt.hpp>
+#include <xtensor/xarray.hpp>
+
+namespace molcpp
+{
+
+/// Read-only memory mapping of a whole file. The mapping is released when
+/// the object is destroyed.
+class MOLCPP_EXPORT MappedFile
+{
+  public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    auto operator=(const MappedFile &) -> MappedFile & = delete;
+
+    MappedFile(MappedFile &&other) noexcept;
+    auto operator=(MappedFile &&other) noexcept -> MappedFile &;
+
+    auto data() const -> const char *
+    {
+        return _data;
+    }
+
+    auto size() const -> size_t
+    {
+        return _size;
+    }
+
+  private:
+    void unmap();
+
+    const char *_data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void *_file = nullptr;
+    void *_mapping = nullptr;
+#endif
+};
+
+/// Random access to the frames of a trajectory. `read` does not modify the
+/// reader, and can be called from several threads at once.
+class MOLCPP_EXPORT TrajectoryReader
+{
+  public:
+    TrajectoryReader() = default;
+
+    virtual ~TrajectoryReader() = default;
+
+    TrajectoryReader(const TrajectoryReader &) = default;
+    auto operator=(const TrajectoryReader &) -> TrajectoryReader & = default;
+    TrajectoryReader(TrajectoryReader &&) = default;
+    auto operator=(TrajectoryReader &&) -> TrajectoryReader & = default;
+
+    virtual auto n_frames() const -> size_t = 0;
+
+    virtual auto n_atoms() const -> size_t = 0;
+
+    /// Copy the positions of `frame` in the contiguous (n_atoms, 3) buffer
+    /// `xyz`, and return the box of this frame
+    virtual auto read(size_t frame, double *xyz) const -> Box = 0;
+
+    /// Positions of the frames in `[begin, end)`, with shape (frames, atoms,
+    /// 3) as expected by the Compute classes. Frames are read in parallel
+    /// according to `policy`.
+    auto read_positions(size_t begin, size_t end, ExecutionPolicy policy = {}) const -> xt::xarray<double>;
+
+  protected:
+    /// Throw if `frame` is not a valid frame index
+    void check_frame(size_t frame) const;
+};
+
+/// Byte offsets of the frames of a trajectory file whose frames do not all
+/// have the same size, giving O(1) access to any frame. Finding the offsets
+/// requires scanning the whole file, so they are saved in a sidecar file
+/// next to the trajectory and reused as long as the trajectory keeps the
+/// same size and modification time.
+class MOLCPP_EXPORT FrameIndex
+{
+  public:
+    /// Find the offsets of all frames in `file`, followed by the offset of
+    /// the end of the last frame
+    using Scanner = std::function<std::vector<uint64_t>(const MappedFile &file)>;
+
+    FrameIndex() = default;
+
+    /// Index of the trajectory `file` found at `path`, loaded from the
+    /// sidecar file or built with `scan`
+    FrameIndex(const std::string &path, const MappedFile &file, const Scanner &scan);
+
+    auto n_frames() const -> size_t
+    {
+        return _offsets.empty() ? 0 : _offsets.size() - 1;
+    }
+
+    /// Offset of the first byte of `frame`
+    auto begin(size_t frame) const -> size_t
+    {
+        return _offsets[frame];
+    }
+
+    /// Offset past the last byte of `frame`
+    auto end(size_t frame) const -> size_t
+    {
+        return _offsets[frame + 1];
+    }
+
+    /// Whether the offsets were loaded from the sidecar file
+    auto from_sidecar() const -> bool
+    {
+        return _from_sidecar;
+    }
+
+    /// Path of the sidecar file of the trajectory at `path`
+    static auto sidecar_path(const std::string &path) -> std::string;
+
+  private:
+    auto load(const std::string &path, size_t file_size) -> bool;
+    void save(const std::string &path, size_t file_size) const;
+
+    std::vector<uint64_t> _offsets;
+    bool _from_sidecar = false;
+};
+
+/// Reader for the molcpp binary trajectory format, which is memory-mapped so
+/// that frames can be used in place. All values are little-endian.
+///
+/// The file starts with a 64 bytes header:
+///
+///     offset  type      content
+///     0       char[8]   magic, "MOLTRAJ" followed by a null byte
+///     8       uint32    format version, currently 1
+///     12      uint32    precision, bytes per coordinate: 4 or 8
+///     16      uint64    number of atoms
+///     24      uint64    number of frames
+///     32      uint64    bytes between two frames, a multiple of 64
+///     40      -         reserved, zero
+///
+/// followed by the frames. Frame `i` starts at `64 + i * frame_bytes`, with
+///
+///     offset  type          content
+///     0       float64[9]    box matrix in row-major order, the columns being
+///                           the box vectors. All zeros for an infinite box
+///     72      -             reserved, zero
+///     128     float[n, 3]   positions, as float32 or float64
+///
+/// and zero padding up to `frame_bytes`. Positions of every frame are
+/// aligned on 64 bytes.
+class MOLCPP_EXPORT BinaryTrajectory : public TrajectoryReader
+{
+  public:
+    enum class Precision : uint32_t
+    {
+        FLOAT32 = 4,
+        FLOAT64 = 8
+    };
+
+    static constexpr size_t HEADER_BYTES = 64;
+    static constexpr size_t FRAME_HEADER_BYTES = 128;
+
+    /// Bytes between two frames of `n_atoms` atoms
+    static auto frame_bytes(size_t n_atoms, Precision precision) -> size_t;
+
+    /// Zero-copy view of the positions of one frame, with shape (atoms, 3)
+    template <typename T>
+    using FrameView = decltype(xt::adapt(std::declval<const T *>(), size_t{}, xt::no_ownership(),
+                                         std::declval<std::array<size_t, 2>>()));
+
+    /// Zero-copy view of the positions of every frame, with shape (frames,
+    /// atoms, 3)
+    template <typename T>
+    using TrajectoryView =
+        decltype(xt::adapt(std::declval<const T *>(), size_t{}, xt::no_ownership(),
+                           std::declval<std::array<size_t, 3>>(), std::declval<std::array<size_t, 3>>()));
+
+    explicit BinaryTrajectory(const std::string &path);
+
+    auto n_frames() const -> size_t override
+    {
+        return _n_frames;
+    }
+
+    auto n_atoms() const -> size_t override
+    {
+        return _n_atoms;
+    }
+
+    auto get_precision() const -> Precision
+    {
+        return _precision;
+    }
+
+    auto read(size_t frame, double *xyz) const -> Box override;
+
+    auto box(size_t frame) const -> Box;
+
+    /// Positions of `frame` in the mapped file. `T` must match the precision
+    /// of the file.
+    template <typename T> auto positions(size_t frame) const -> FrameView<T>
+    {
+        check_frame(frame);
+        check_type<T>();
+        return xt::adapt(reinterpret_cast<const T *>(frame_data(frame) + FRAME_HEADER_BYTES), 3 * _n_atoms,
+                         xt::no_ownership(), std::array<size_t, 2>{_n_atoms, 3});
+    }
+
+    /// Positions of every frame in the mapped file, skipping the frame
+    /// headers with strides. `T` must match the precision of the file.
+    template <typename T> auto positions() const -> TrajectoryView<T>
+    {
+        check_type<T>();
+        const size_t stride = _frame_bytes / sizeof(T);
+        const size_t size = _n_frames == 0 ? 0 : (_n_frames - 1) * stride + 3 * _n_atoms;
+        return xt::adapt(reinterpret_cast<const T *>(_file.data() + HEADER_BYTES + FRAME_HEADER_BYTES), size,
+                         xt::no_ownership(), std::array<size_t, 3>{_n_frames, _n_atoms, 3},
+                         std::array<size_t, 3>{stride, 3, 1});
+    }
+
+  private:
+    auto frame_data(size_t frame) const -> const char *
+    {
+        return _file.data() + HEADER_BYTES + frame * _frame_bytes;
+    }
+
+    template <typename T> void check_type() const
+    {
+        if (sizeof(T) != static_cast<size_t>(_precision))
+        {
+            throw std::runtime_error("Requested type does not match the precision of the trajectory");
+        }
+    }
+
+    MappedFile _file;
+    Precision _precision = Precision::FLOAT64;
+    size_t _n_atoms = 0;
+    size_t _n_frames = 0;
+    size_t _frame_bytes = 0;
+};
+
+/// Reader for DCD files written by CHARMM, NAMD or LAMMPS, in either byte
+/// order. All frames of a DCD file have the same size, so frames are found
+/// from the header alone and no index is needed. Files with fixed atoms are
+/// not supported.
+class MOLCPP_EXPORT DCDTrajectory : public TrajectoryReader
+{
+  public:
+    explicit DCDTrajectory(const std::string &path);
+
+    auto n_frames() const -> size_t override
+    {
+        return _n_frames;
+    }
+
+    auto n_atoms() const -> size_t override
+    {
+        return _n_atoms;
+    }
+
+    /// Read `frame`. The box comes from the unit cell of the frame, and is
+    /// infinite if the file has none.
+    auto read(size_t frame, double *xyz) const -> Box override;
+
+  private:
+    auto load_int(size_t offset) const -> int32_t;
+
+    MappedFile _file;
+    bool _swap = false;
+    bool _has_cell = false;
+    size_t _n_atoms = 0;
+    size_t _n_frames = 0;
+    size_t _first_frame = 0;
+    size_t _frame_bytes = 0;
+};
+
+/// Reader for GROMACS XTC files. Frames are compressed to different sizes,
+/// so their offsets come from a `FrameIndex`. Positions and box are in the
+/// units of the file, nm.
+class MOLCPP_EXPORT XTCTrajectory : public TrajectoryReader
+{
+  public:
+    explicit XTCTrajectory(const std::string &path);
+
+    auto n_frames() const -> size_t override
+    {
+        return _index.n_frames();
+    }
+
+    auto n_atoms() const -> size_t override
+    {
+        return _n_atoms;
+    }
+
+    /// Decompress `frame`
+    auto read(size_t frame, double *xyz) const -> Box override;
+
+    auto get_step(size_t frame) const -> int32_t;
+
+    auto get_time(size_t frame) const -> float;
+
+    auto get_index() const -> const FrameIndex &
+    {
+        return _index;
+    }
+
+  private:
+    MappedFile _file;
+    FrameIndex _index;
+    size_t _n_atoms = 0;
+};
+
+/// Reader for LAMMPS text dump files, as written by `dump atom` or `dump
+/// custom`. Frame offsets come from a `FrameIndex`, which is built by
+/// scanning chunks of the file in parallel according to `policy`. A last
+/// frame which was not completely written is ignored.
+///
+/// Positions are taken from the unwrapped `xu yu zu` columns when present,
+/// then from `x y z`, then from the scaled `xsu ysu zsu` or `xs ys zs`.
+/// Atoms are sorted by the `id` column when ids go from 1 to the number of
+/// atoms, and are in file order otherwise. Triclinic boxes are converted
+/// from the LAMMPS bounds to the matrix built by `Box::set_lengths_tilts`.
+class MOLCPP_EXPORT LAMMPSDumpTrajectory : public TrajectoryReader
+{
+  public:
+    explicit LAMMPSDumpTrajectory(const std::string &path, ExecutionPolicy policy = {});
+
+    auto n_frames() const -> size_t override
+    {
+        return _index.n_frames();
+    }
+
+    auto n_atoms() const -> size_t override
+    {
+        return _n_atoms;
+    }
+
+    /// Parse `frame`
+    auto read(size_t frame, double *xyz) const -> Box override;
+
+    auto get_step(size_t frame) const -> int64_t;
+
+    auto get_index() const -> const FrameIndex &
+    {
+        return _index;
+    }
+
+  private:
+    MappedFile _file;
+    FrameIndex _index;
+    size_t _n_atoms = 0;
+};
+
+/// Reader for XYZ files, including the extended XYZ comment line written by
+/// ASE and others. Every frame must have the same number of atoms, so that
+/// frames start every `n_atoms + 2` lines: the `FrameIndex` is built by
+/// counting lines in chunks of the file in parallel according to `policy`.
+///
+/// The box comes from the `Lattice="ax ay az bx by bz cx cy cz"` key of the
+/// comment line, and is infinite without it. Positions are the `pos`
+/// columns of the `Properties` key, or the three columns after the name.
+class MOLCPP_EXPORT ExtendedXYZTrajectory : public TrajectoryReader
+{
+  public:
+    explicit ExtendedXYZTrajectory(const std::string &path, ExecutionPolicy policy = {});
+
+    auto n_frames() const -> size_t override
+    {
+        return _index.n_frames();
+    }
+
+    auto n_atoms() const -> size_t override
+    {
+        return _n_atoms;
+    }
+
+    /// Parse `frame`
+    auto read(size_t frame, double *xyz) const -> Box override;
+
+    auto get_index() const -> const FrameIndex &
+    {
+        return _index;
+    }
+
+  private:
+    MappedFile _file;
+    FrameIndex _index;
+    size_t _n_atoms = 0;
+};
+
+/// Writer for the format read by `BinaryTrajectory`. The number of frames in
+/// the header is updated by `close`, which the destructor calls.
+class MOLCPP_EXPORT BinaryTrajectoryWriter
+{
+  public:
+    using Precision = BinaryTrajectory::Precision;
+
+    BinaryTrajectoryWriter(const std::string &path, size_t n_atoms, Precision precision = Precision::FLOAT64);
+
+    ~BinaryTrajectoryWriter();
+
+    BinaryTrajectoryWriter(const BinaryTrajectoryWriter &) = delete;
+    auto operator=(const BinaryTrajectoryWriter &) -> BinaryTrajectoryWriter & = delete;
+
+    /// Append a frame with positions in the contiguous (n_atoms, 3) buffer
+    /// `xyz`
+    void write(const double *xyz, const Box &box);
+
+    /// Append a frame with positions of shape (n_atoms, 3)
+    void write(const xt::xarray<double> &xyz, const Box &box);
+
+    void close();
+
+    auto n_frames() const -> size_t
+    {
+        return _n_frames;
+    }
+
+  private:
+    std::ofstream _file;
+    Precision _precision;
+    size_t _n_atoms;
+    size_t _n_frames = 0;
+    std::vector<char> _buffer;
+};
+
+/// Convert the XYZ file at `xyz_path` to a binary trajectory at `path`,
+/// using the lattice of each frame, or `box` for frames without one.
+/// Returns the number of frames.
+MOLCPP_EXPORT auto xyz_to_binary(const std::string &xyz_path, const std::string &path, const Box &box = Box(),
+                                 BinaryTrajectory::Precision precision = BinaryTrajectory::Precision::FLOAT64)
+    -> size_t;
+
+} // namespace molcpp
+#endif // MOLCPP_TRAJECTORY_HPP
@@ -6,33 +6,360 @@
 typedef xt::xtensor_fixed<double, xt::xshape<3>> Vec3;
 typedef xt::xtensor_fixed<double, xt::xshape<3, 3>> Mat3;
 
+#include "molcpp/key.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 #include <variant>
+#include <vector>
 #include <xtensor/xarray.hpp>
 
 namespace molcpp
 {
+
+/// Positions stored as three separate x, y, z arrays (struct of arrays)
+template <typename T> struct SoA3
+{
+    T *x;
+    T *y;
+    T *z;
+};
+
+namespace detail
+{
+
+/// Map from `Key` to `V` in flat storage, with open addressing and linear
+/// probing on the key id. Lookups neither hash strings nor allocate, and an
+/// empty map allocates nothing. `V` must be default constructible.
+template <typename V> class FlatKeyMap
+{
+  public:
+    auto size() const -> size_t
+    {
+        return _size;
+    }
+
+    auto empty() const -> bool
+    {
+        return _size == 0;
+    }
+
+    auto find(Key key) const -> const V *
+    {
+        if (_size == 0)
+        {
+            return nullptr;
+        }
+        const size_t mask = _slots.size() - 1;
+        for (size_t i = home(key.id()); _slots[i].id != EMPTY; i = (i + 1) & mask)
+        {
+            if (_slots[i].id == key.id())
+            {
+                return &_slots[i].value;
+            }
+        }
+        return nullptr;
+    }
+
+    auto find(Key key) -> V *
+    {
+        return const_cast<V *>(std::as_const(*this).find(key));
+    }
+
+    /// Set the value of `key`, inserting it if needed
+    auto insert_or_assign(Key key, V value) -> V &
+    {
+        if (!key.is_valid())
+        {
+            throw std::runtime_error("Invalid key");
+        }
+        if (auto *existing = find(key))
+        {
+            *existing = std::move(value);
+            return *existing;
+        }
+        // keep the load factor under 3/4
+        if (4 * (_size + 1) > 3 * _slots.size())
+        {
+            rehash(_slots.empty() ? 4 : 2 * _slots.size());
+        }
+        const size_t mask = _slots.size() - 1;
+        size_t i = home(key.id());
+        while (_slots[i].id != EMPTY)
+        {
+            i = (i + 1) & mask;
+        }
+        _slots[i] = {key.id(), std::move(value)};
+        _size++;
+        return _slots[i].value;
+    }
+
+    /// Remove `key`, returning whether it was present
+    auto erase(Key key) -> bool
+    {
+        if (find(key) == nullptr)
+        {
+            return false;
+        }
+        const size_t mask = _slots.size() - 1;
+        size_t hole = home(key.id());
+        while (_slots[hole].id != key.id())
+        {
+            hole = (hole + 1) & mask;
+        }
+        // shift the following entries back instead of leaving a tombstone,
+        // so that lookups never scan removed slots
+        for (size_t i = (hole + 1) & mask; _slots[i].id != EMPTY; i = (i + 1) & mask)
+        {
+            if (((i - home(_slots[i].id)) & mask) >= ((i - hole) & mask))
+            {
+                _slots[hole] = std::move(_slots[i]);
+                hole = i;
+            }
+        }
+        _slots[hole] = Slot{};
+        _size--;
+        return true;
+    }
+
+    /// Call `function(key, value)` on every entry, in no particular order
+    template <typename Function> void for_each(Function &&function)
+    {
+        for (auto &slot : _slots)
+        {
+            if (slot.id != EMPTY)
+            {
+                function(Key::from_id(slot.id), slot.value);
+            }
+        }
+    }
+
+    template <typename Function> void for_each(Function &&function) const
+    {
+        for (const auto &slot : _slots)
+        {
+            if (slot.id != EMPTY)
+            {
+                function(Key::from_id(slot.id), slot.value);
+            }
+        }
+    }
+
+  private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    // ids and values are stored together, so that a lookup touches a
+    // single allocation
+    struct Slot
+    {
+        uint32_t id = EMPTY;
+        V value{};
+    };
+
+    /// First slot probed for the key `id`, by Fibonacci hashing
+    auto home(uint32_t id) const -> size_t
+    {
+        return static_cast<uint32_t>(id * 2654435769u) >> _shift;
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> slots(capacity);
+        std::swap(slots, _slots);
+        _shift = 32 - static_cast<unsigned>(std::countr_zero(capacity));
+        const size_t mask = capacity - 1;
+        for (auto &slot : slots)
+        {
+            if (slot.id != EMPTY)
+            {
+                size_t i = home(slot.id);
+                while (_slots[i].id != EMPTY)
+                {
+                    i = (i + 1) & mask;
+                }
+                _slots[i] = std::move(slot);
+            }
+        }
+    }
+
+    // the capacity is a power of two
+    std::vector<Slot> _slots;
+    size_t _size = 0;
+    unsigned _shift = 32;
+};
+
+} // namespace detail
+
+/// Values of one of the `Args` types, attached to an entity and named by
+/// interned `Key`s. Values live in a flat open-addressing table: reading a
+/// property by key does not allocate, and a missing key is an error rather
+/// than an insertion.
+///
+///     Property<int, double, std::string> prop;
+///     prop.set(keys::CHARGE, -0.8);
+///     double charge = prop.get<double>(keys::CHARGE);
+///
+/// Names given as strings are interned on each call; resolve them to a
+/// `Key` once in loops.
 template <typename... Args> class Property
 {
   public:
-    template <typename T> void set(std::string key, T value)
+    using value_type = std::variant<Args...>;
+
+    template <typename T> void set(Key key, T value)
+    {
+        _data.insert_or_assign(key, value_type(std::move(value)));
+    }
+
+    template <typename T> void set(std::string_view name, T value)
     {
-        _data[key] = value;
+        set(Key(name), std::move(value));
     }
 
-    void set(std::string key, std::variant<Args...> value)
+    /// Value of `key`, which must hold a `T`
+    template <typename T> auto get(Key key) const -> const T &
     {
-        _data[key] = value;
+        if (const auto *value = find<T>(key))
+        {
+            return *value;
+        }
+        if (!contains(key))
+        {
+            throw std::runtime_error("No property '" + key.name() + "'");
+        }
+        throw std::runtime_error("Property '" + key.name() + "' holds another type");
     }
 
-    template <typename T> const T get(std::string key)
+    template <typename T> auto get(std::string_view name) const -> const T &
     {
-        return std::get<T>(_data[key]);
+        return get<T>(Key(name));
+    }
+
+    /// Value of `key` if it is present and holds a `T`, or nullptr
+    template <typename T> auto find(Key key) const -> const T *
+    {
+        const auto *value = _data.find(key);
+        return value == nullptr ? nullptr : std::get_if<T>(value);
+    }
+
+    auto contains(Key key) const -> bool
+    {
+        return _data.find(key) != nullptr;
+    }
+
+    auto erase(Key key) -> bool
+    {
+        return _data.erase(key);
+    }
+
+    auto size() const -> size_t
+    {
+        return _data.size();
+    }
+
+  private:
+    detail::FlatKeyMap<value_type> _data;
+};
+
+/// Properties of many entities, stored by column: each key holds one array
+/// of a single `Args` type with a value for every entity. Use it instead of
+/// one `Property` per entity when all entities share the same keys.
+///
+///     PropertyColumns<int, double> bonds(n_bonds);
+///     auto order = bonds.add_column<int>(Key("order"));
+template <typename... Args> class PropertyColumns
+{
+  public:
+    using column_type = std::variant<std::vector<Args>...>;
+
+    explicit PropertyColumns(size_t n_entities = 0) : _n_entities(n_entities)
+    {
+    }
+
+    auto n_entities() const -> size_t
+    {
+        return _n_entities;
+    }
+
+    /// Change the number of entities, keeping the values of the first ones
+    /// and value-initializing the new ones. Invalidates spans to columns.
+    void resize(size_t n_entities)
+    {
+        _columns.for_each([n_entities](Key, column_type &column) {
+            std::visit([n_entities](auto &values) { values.resize(n_entities); }, column);
+        });
+        _n_entities = n_entities;
+    }
+
+    /// Add a value-initialized column named `key`, or return the existing
+    /// column if it holds the same type
+    template <typename T> auto add_column(Key key) -> std::span<T>
+    {
+        if (!contains(key))
+        {
+            _columns.insert_or_assign(key, column_type(std::vector<T>(_n_entities)));
+        }
+        return column<T>(key);
+    }
+
+    /// Set the column `key` to `values`, with one value per entity
+    template <typename T> void set_column(Key key, std::vector<T> values)
+    {
+        if (values.size() != _n_entities)
+        {
+            throw std::runtime_error("Column size does not match the number of entities");
+        }
+        _columns.insert_or_assign(key, column_type(std::move(values)));
+    }
+
+    template <typename T> auto column(Key key) -> std::span<T>
+    {
+        return typed<T>(key);
+    }
+
+    template <typename T> auto column(Key key) const -> std::span<const T>
+    {
+        return const_cast<PropertyColumns *>(this)->typed<T>(key);
+    }
+
+    auto contains(Key key) const -> bool
+    {
+        return _columns.find(key) != nullptr;
+    }
+
+    auto erase(Key key) -> bool
+    {
+        return _columns.erase(key);
+    }
+
+    auto n_columns() const -> size_t
+    {
+        return _columns.size();
     }
 
   private:
-    std::unordered_map<std::string, std::variant<Args...>> _data;
+    template <typename T> auto typed(Key key) -> std::vector<T> &
+    {
+        auto *column = _columns.find(key);
+        if (column == nullptr)
+        {
+            throw std::runtime_error(key.is_valid() ? "No property '" + key.name() + "'" : "Invalid key");
+        }
+        auto *values = std::get_if<std::vector<T>>(column);
+        if (values == nullptr)
+        {
+            throw std::runtime_error("Property '" + key.name() + "' holds another type");
+        }
+        return *values;
+    }
+
+    size_t _n_entities = 0;
+    detail::FlatKeyMap<column_type> _columns;
 };
 
 } // namespace molcpp
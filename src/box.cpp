@@ -1,14 +1,22 @@
 #include "molcpp/box.hpp"
+#include "mic.hpp"
+#include "region.hpp"
+#include "molcpp/topology.hpp"
 #include "xtensor-blas/xlinalg.hpp"
 #include <xtensor/xarray.hpp>
 #include <xtensor/xmath.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
 
 namespace molcpp
 {
 
 Box::Box() : _matrix{xt::zeros<double>({3, 3})}
 {
+    update_cache();
 }
 
 Box::Box(const Mat3 &matrix)
@@ -27,8 +35,8 @@ Box::Box(const std::initializer_list<std::initializer_list<double>> &matrix)
 
 Box::Box(const std::initializer_list<double> &lengths): _matrix{xt::zeros<double>({3, 3})}
 {
-    Vec3 _lengths = Vec3(lengths);
-    set_lengths(_lengths);
+    update_cache();
+    set_lengths(Vec3(lengths));
 }
 
 Box Box::from_lengths_angles(const Vec3 &lengths, const Vec3 &angles)
@@ -82,18 +90,24 @@ Mat3 Box::calc_matrix_from_lengths_angles(const Vec3 &lengths, const Vec3 &angle
 
 Mat3 Box::calc_matrix_from_size_tilts(const Vec3 &sizes, const Vec3 &tilts)
 {
+    // LAMMPS convention: a = (lx, 0, 0), b = (xy, ly, 0), c = (xz, yz, lz)
+    if (xt::any(sizes <= 0))
+    {
+        throw std::runtime_error("Sizes must be > 0");
+    }
+    double xy = tilts(0);
     double xz = tilts(1);
     double yz = tilts(2);
-    double xy = tilts(0);
-    double a = sizes(0);
-    double b = sqrt(sizes(1) * sizes(1) + xy * xy);
-    double c = sqrt(sizes(2)*sizes(2) + xz*xz + yz*yz);
 
-    double alpha = acos(xy*xz + sizes(1) * yz) / (b * c);
-    double beta = acos(xz / c);
-    double gamma = acos(xy / b);
-
-    return calc_matrix_from_lengths_angles({a, b, c}, {alpha, beta, gamma});
+    Mat3 matrix;
+    matrix.fill(0.0);
+    matrix(0, 0) = sizes(0);
+    matrix(0, 1) = xy;
+    matrix(1, 1) = sizes(1);
+    matrix(0, 2) = xz;
+    matrix(1, 2) = yz;
+    matrix(2, 2) = sizes(2);
+    return matrix;
 }
 
 Vec3 Box::calc_lengths_from_matrix(const Mat3 &matrix)
@@ -150,19 +164,20 @@ void Box::set_lengths(const Vec3 &lengths)
     {
         throw std::runtime_error("Lengths must have size 3");
     }
-    auto angles = get_angles();
-    _matrix = calc_matrix_from_lengths_angles(lengths, angles);
+    _matrix = calc_matrix_from_lengths_angles(lengths, _angles);
+    update_cache();
 }
 
 void Box::set_angles(const Vec3 &angles)
 {
-    auto lengths = get_lengths();
-    _matrix = calc_matrix_from_lengths_angles(lengths, angles);
+    _matrix = calc_matrix_from_lengths_angles(_lengths, angles);
+    update_cache();
 }
 
 void Box::set_matrix(const Mat3 &matrix)
 {
     _matrix = check_matrix(matrix);
+    update_cache();
 }
 
 void Box::set_lengths_angles(const Vec3 &lengths, const Vec3 &angles)
@@ -172,123 +187,350 @@ void Box::set_lengths_angles(const Vec3 &lengths, const Vec3 &angles)
         throw std::runtime_error("Lengths and angles must have size 3");
     }
     _matrix = calc_matrix_from_lengths_angles(lengths, angles);
+    update_cache();
 }
 
 void Box::set_lengths_tilts(const Vec3 &lengths, const Vec3 &tilts)
 {
     _matrix = calc_matrix_from_size_tilts(lengths, tilts);
+    update_cache();
 }
 
-auto Box::get_lengths() const -> Vec3
+void Box::update_cache()
 {
-    switch (calc_style_from_matrix(_matrix))
+    _style = calc_style_from_matrix(_matrix);
+    switch (_style)
     {
     case FREE:
-        return {0, 0, 0};
+        _inv.fill(0.0);
+        _lengths = {0, 0, 0};
+        _angles = {90, 90, 90};
+        _volume = 0;
+        _faces = {0, 0, 0};
+        break;
     case ORTHOGONAL:
-        return {_matrix(0, 0), _matrix(1, 1), _matrix(2, 2)};
-    case TRICLINIC:
-        return Box::calc_lengths_from_matrix(_matrix);
+        _inv.fill(0.0);
+        _inv(0, 0) = 1.0 / _matrix(0, 0);
+        _inv(1, 1) = 1.0 / _matrix(1, 1);
+        _inv(2, 2) = 1.0 / _matrix(2, 2);
+        _lengths = {_matrix(0, 0), _matrix(1, 1), _matrix(2, 2)};
+        _angles = {90, 90, 90};
+        _volume = _matrix(0, 0) * _matrix(1, 1) * _matrix(2, 2);
+        _faces = _lengths;
+        break;
+    case TRICLINIC: {
+        // the matrix is upper triangular, so is its inverse
+        double a = _matrix(0, 0), b = _matrix(0, 1), c = _matrix(0, 2);
+        double d = _matrix(1, 1), e = _matrix(1, 2);
+        double f = _matrix(2, 2);
+        _inv.fill(0.0);
+        _inv(0, 0) = 1.0 / a;
+        _inv(0, 1) = -b / (a * d);
+        _inv(0, 2) = (b * e - c * d) / (a * d * f);
+        _inv(1, 1) = 1.0 / d;
+        _inv(1, 2) = -e / (d * f);
+        _inv(2, 2) = 1.0 / f;
+        _lengths = calc_lengths_from_matrix(_matrix);
+        _angles = calc_angles_from_matrix(_matrix);
+        _volume = a * d * f;
+
+        auto va = xt::view(_matrix, xt::all(), 0);
+        auto vb = xt::view(_matrix, xt::all(), 1);
+        auto vc = xt::view(_matrix, xt::all(), 2);
+
+        auto na = xt::linalg::cross(vb, vc);
+        auto nb = xt::linalg::cross(vc, va);
+        auto nc = xt::linalg::cross(va, vb);
+
+        na /= xt::linalg::norm(na);
+        nb /= xt::linalg::norm(nb);
+        nc /= xt::linalg::norm(nc);
+
+        _faces = {xt::linalg::dot(na, va)(0), xt::linalg::dot(nb, vb)(0), xt::linalg::dot(nc, vc)(0)};
+        break;
+    }
     default:
         throw std::runtime_error("Invalid Style");
     }
 }
 
-auto Box::get_angles() const -> Vec3
+auto Box::wrap(const xt::xarray<double> &xyz) const -> xt::xarray<double>
 {
-    switch (calc_style_from_matrix(_matrix))
+    switch (_style)
     {
     case FREE:
+        return wrap_free(xyz);
     case ORTHOGONAL:
-        return {90, 90, 90};
+        return wrap_orth(xyz);
     case TRICLINIC:
-        return Box::calc_angles_from_matrix(_matrix);
+        return wrap_tric(xyz);
     default:
         throw std::runtime_error("Invalid Style");
     }
 }
 
-auto Box::get_volume() const -> double
+auto Box::wrap_free(const xt::xarray<double> &xyz) const -> xt::xarray<double>
+{
+    return xt::xarray<double>(xyz);
+}
+
+auto Box::wrap_orth(const xt::xarray<double> &xyz) const -> xt::xarray<double>
+{
+    return xyz - xt::floor(xyz / _lengths + 0.5) * _lengths;
+}
+
+auto Box::wrap_tric(const xt::xarray<double> &xyz) const -> xt::xarray<double>
+{
+    auto fractional = xt::linalg::dot(_inv, xt::transpose(xyz));
+    return xt::transpose(xt::linalg::dot(_matrix, fractional - xt::floor(fractional + 0.5)));
+}
+
+static void check_span_size(size_t size)
 {
-    switch (calc_style_from_matrix(_matrix))
+    if (size % 3 != 0)
     {
-    case FREE:
-        return 0;
-    case ORTHOGONAL:
-    case TRICLINIC:
-        return xt::linalg::det(_matrix);
-    default:
-        throw std::runtime_error("Invalid Style");
+        throw std::runtime_error("Positions buffer size must be a multiple of 3");
     }
 }
 
-auto Box::get_distance_between_faces() const -> Vec3
+void Box::wrap_inplace(double *xyz, size_t n) const
 {
-    switch (calc_style_from_matrix(_matrix))
+    detail::wrap_positions(mic_cell(), xyz, n);
+}
+
+void Box::wrap_inplace(std::span<double> xyz) const
+{
+    check_span_size(xyz.size());
+    wrap_inplace(xyz.data(), xyz.size() / 3);
+}
+
+void Box::wrap_inplace(float *xyz, size_t n) const
+{
+    detail::wrap_positions(mic_cell(), xyz, n);
+}
+
+void Box::wrap_inplace(std::span<float> xyz) const
+{
+    check_span_size(xyz.size());
+    wrap_inplace(xyz.data(), xyz.size() / 3);
+}
+
+void Box::select(const double *xyz, size_t n, uint64_t *bits) const
+{
+    if (_style == FREE)
     {
-    case FREE:
-        return {0, 0, 0};
-    case ORTHOGONAL:
-        return {xt::linalg::norm(xt::view(_matrix, xt::all(), 0)),
-                xt::linalg::norm(xt::view(_matrix, xt::all(), 1)),
-                xt::linalg::norm(xt::view(_matrix, xt::all(), 2))};
-    case TRICLINIC:{
-        auto a = xt::view(_matrix, xt::all(), 0);
-        auto b = xt::view(_matrix, xt::all(), 1);
-        auto c = xt::view(_matrix, xt::all(), 2);
-
-        auto na = xt::linalg::cross(b, c);
-        auto nb = xt::linalg::cross(c, a);
-        auto nc = xt::linalg::cross(a, b);
+        const size_t n_words = (n + 63) / 64;
+        std::fill(bits, bits + n_words, ~uint64_t{0});
+        if (n % 64 != 0)
+        {
+            bits[n_words - 1] = (uint64_t{1} << (n % 64)) - 1;
+        }
+        return;
+    }
+    // the box is centered on the origin, as `wrap` maps positions to
+    // fractional coordinates in [-0.5, 0.5)
+    const auto cell = mic_cell();
+    detail::ParallelepipedShape shape;
+    std::copy(cell.inv, cell.inv + 6, shape.inv);
+    shape.lo = -0.5;
+    shape.hi = 0.5;
+    detail::select_parallelepiped(shape, xyz, n, bits);
+}
 
-        na /= xt::linalg::norm(na);
-        nb /= xt::linalg::norm(nb);
-        nc /= xt::linalg::norm(nc);
+void Box::isin(std::span<const double> xyz, std::span<bool> mask) const
+{
+    check_span_size(xyz.size());
+    if (mask.size() != xyz.size() / 3)
+    {
+        throw std::runtime_error("Mask size must match the number of positions");
+    }
+    isin(xyz.data(), mask.size(), mask.data());
+}
 
-        return xt::concatenate(xt::xtuple(xt::linalg::dot(na, a),
-                                          xt::linalg::dot(nb, b),
-                                          xt::linalg::dot(nc, c)));}
-    default:
-        throw std::runtime_error("Invalid Style");
+void Box::unwrap_inplace(double *xyz, const int *images, size_t n) const
+{
+    if (_style == FREE)
+    {
+        return;
     }
+    const double h00 = _matrix(0, 0), h01 = _matrix(0, 1), h02 = _matrix(0, 2);
+    const double h11 = _matrix(1, 1), h12 = _matrix(1, 2), h22 = _matrix(2, 2);
+    for (size_t i = 0; i < n; i++)
+    {
+        double *r = xyz + 3 * i;
+        const int *img = images + 3 * i;
+        r[0] += h00 * img[0] + h01 * img[1] + h02 * img[2];
+        r[1] += h11 * img[1] + h12 * img[2];
+        r[2] += h22 * img[2];
+    }
+}
 
+void Box::unwrap_inplace(std::span<double> xyz, std::span<const int> images) const
+{
+    check_span_size(xyz.size());
+    if (images.size() != xyz.size())
+    {
+        throw std::runtime_error("Images size must match the positions size");
+    }
+    unwrap_inplace(xyz.data(), images.data(), xyz.size() / 3);
 }
 
-auto Box::isin(const xt::xarray<double> &xyz) const -> xt::xarray<bool>
+void Box::unwrap_inplace(double *xyz, const double *reference, size_t n) const
 {
-    return true;
+    if (_style == FREE)
+    {
+        return;
+    }
+    for (size_t i = 0; i < 3 * n; i++)
+    {
+        xyz[i] -= reference[i];
+    }
+    wrap_inplace(xyz, n);
+    for (size_t i = 0; i < 3 * n; i++)
+    {
+        xyz[i] += reference[i];
+    }
 }
 
-auto Box::wrap(const xt::xarray<double> &xyz) const -> xt::xarray<double>
+void Box::unwrap_inplace(std::span<double> xyz, std::span<const double> reference) const
+{
+    check_span_size(xyz.size());
+    if (reference.size() != xyz.size())
+    {
+        throw std::runtime_error("Reference size must match the positions size");
+    }
+    unwrap_inplace(xyz.data(), reference.data(), xyz.size() / 3);
+}
+
+void Box::update_images(const double *xyz, const double *previous, int *images, size_t n,
+                        ExecutionPolicy policy) const
+{
+    if (_style == FREE)
+    {
+        return;
+    }
+    const double i00 = _inv(0, 0), i01 = _inv(0, 1), i02 = _inv(0, 2);
+    const double i11 = _inv(1, 1), i12 = _inv(1, 2), i22 = _inv(2, 2);
+    parallel_ranges(n, 16 * resolve_n_threads(policy.n_threads), policy.n_threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const double dx = xyz[3 * i] - previous[3 * i];
+            const double dy = xyz[3 * i + 1] - previous[3 * i + 1];
+            const double dz = xyz[3 * i + 2] - previous[3 * i + 2];
+            // a jump of about one cell vector means a boundary was crossed
+            int *img = images + 3 * i;
+            img[0] -= static_cast<int>(std::lround(i00 * dx + i01 * dy + i02 * dz));
+            img[1] -= static_cast<int>(std::lround(i11 * dy + i12 * dz));
+            img[2] -= static_cast<int>(std::lround(i22 * dz));
+        }
+    });
+}
+
+void Box::make_whole(double *xyz, size_t n, const MoleculeTrees &trees, ExecutionPolicy policy) const
+{
+    if (_style == FREE || trees.edges.empty())
+    {
+        return;
+    }
+    for (const auto &edge : trees.edges)
+    {
+        if (edge[0] >= n || edge[1] >= n)
+        {
+            throw std::runtime_error("Molecule trees do not match the number of atoms");
+        }
+    }
+
+    const auto cell = mic_cell();
+    const size_t n_threads = resolve_n_threads(policy.n_threads);
+    // parent and child positions, then bond vectors, of the edges of a task
+    std::vector<std::vector<double>> scratch(n_threads);
+    const size_t n_molecules = trees.n_molecules();
+    const size_t n_tasks = std::max<size_t>(1, std::min(n_molecules, 16 * n_threads));
+    parallel_for(n_tasks, n_threads, [&](size_t task, size_t thread) {
+        const size_t first = trees.offsets[n_molecules * task / n_tasks];
+        const size_t last = trees.offsets[n_molecules * (task + 1) / n_tasks];
+        const size_t m = last - first;
+        auto &buffer = scratch[thread];
+        buffer.resize(9 * m);
+        double *parent[3] = {buffer.data(), buffer.data() + m, buffer.data() + 2 * m};
+        double *child[3] = {buffer.data() + 3 * m, buffer.data() + 4 * m, buffer.data() + 5 * m};
+        double *bond[3] = {buffer.data() + 6 * m, buffer.data() + 7 * m, buffer.data() + 8 * m};
+        for (size_t e = 0; e < m; e++)
+        {
+            const auto &edge = trees.edges[first + e];
+            for (size_t d = 0; d < 3; d++)
+            {
+                parent[d][e] = xyz[3 * edge[0] + d];
+                child[d][e] = xyz[3 * edge[1] + d];
+            }
+        }
+        // bond vectors do not depend on the image of either atom, so they are
+        // all computed from the input positions at once
+        detail::mic_batch(cell, parent[0], parent[1], parent[2], child[0], child[1], child[2], m, bond[0], bond[1],
+                          bond[2], nullptr);
+        // then placed from the root outwards, parents before children
+        for (size_t e = 0; e < m; e++)
+        {
+            const auto &edge = trees.edges[first + e];
+            for (size_t d = 0; d < 3; d++)
+            {
+                xyz[3 * edge[1] + d] = xyz[3 * edge[0] + d] + bond[d][e];
+            }
+        }
+    });
+}
+
+void Box::make_whole(double *xyz, size_t n, const Topology &topology, ExecutionPolicy policy) const
+{
+    if (topology.n_atoms() != n)
+    {
+        throw std::runtime_error("Topology does not match the number of atoms");
+    }
+    make_whole(xyz, n, topology.molecule_trees(), policy);
+}
+
+auto Box::mic_cell() const -> detail::MicCell
 {
-    switch (calc_style_from_matrix(_matrix))
+    detail::MicCell cell;
+    switch (_style)
     {
     case FREE:
-        return wrap_free(xyz);
+        cell.kind = detail::MicCell::FREE;
+        break;
     case ORTHOGONAL:
-        return wrap_orth(xyz);
+        cell.kind = detail::MicCell::ORTHOGONAL;
+        break;
     case TRICLINIC:
-        return wrap_tric(xyz);
-    default:
-        throw std::runtime_error("Invalid Style");
+        cell.kind = detail::MicCell::TRICLINIC;
+        break;
+    }
+    const std::pair<size_t, size_t> upper[6] = {{0, 0}, {0, 1}, {0, 2}, {1, 1}, {1, 2}, {2, 2}};
+    for (size_t k = 0; k < 6; k++)
+    {
+        cell.h[k] = _matrix(upper[k].first, upper[k].second);
+        cell.inv[k] = _inv(upper[k].first, upper[k].second);
     }
+    return cell;
 }
 
-auto Box::wrap_free(const xt::xarray<double> &xyz) const -> xt::xarray<double>
+void Box::mic_displacements(SoA3<const double> ri, SoA3<const double> rj, size_t n, SoA3<double> d) const
 {
-    return xt::xarray<double>(xyz);
+    detail::mic_batch(mic_cell(), ri.x, ri.y, ri.z, rj.x, rj.y, rj.z, n, d.x, d.y, d.z, nullptr);
 }
 
-auto Box::wrap_orth(const xt::xarray<double> &xyz) const -> xt::xarray<double>
+void Box::mic_distances2(SoA3<const double> ri, SoA3<const double> rj, size_t n, double *r2) const
 {
-    auto lengths = this->get_lengths();
-    return xyz - xt::round(xyz / lengths) * lengths;
+    detail::mic_batch(mic_cell(), ri.x, ri.y, ri.z, rj.x, rj.y, rj.z, n, nullptr, nullptr, nullptr, r2);
 }
 
-auto Box::wrap_tric(const xt::xarray<double> &xyz) const -> xt::xarray<double>
+void Box::mic_displacements(SoA3<const float> ri, SoA3<const float> rj, size_t n, SoA3<float> d) const
+{
+    detail::mic_batch(mic_cell(), ri.x, ri.y, ri.z, rj.x, rj.y, rj.z, n, d.x, d.y, d.z, nullptr);
+}
+
+void Box::mic_distances2(SoA3<const float> ri, SoA3<const float> rj, size_t n, float *r2) const
 {
-    auto fractional = xt::linalg::dot(this->get_inv(), xt::transpose(xyz));
-    return xt::transpose(xt::linalg::dot(get_matrix(), fractional - xt::round(fractional)));
+    detail::mic_batch(mic_cell(), ri.x, ri.y, ri.z, rj.x, rj.y, rj.z, n, nullptr, nullptr, nullptr, r2);
 }
 
 bool operator==(const Box &rhs, const Box &lhs)
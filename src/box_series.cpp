@@ -0,0 +1,284 @@
+#include "molcpp/box_series.hpp"
+#include "mic.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace molcpp
+{
+
+/// Number of atoms wrapped by one task
+static constexpr size_t WRAP_BLOCK = 4096;
+
+BoxSeries::BoxSeries(const double *matrices, size_t n_frames)
+{
+    reserve(n_frames);
+    for (size_t frame = 0; frame < n_frames; frame++)
+    {
+        push_back(matrices + 9 * frame);
+    }
+}
+
+BoxSeries::BoxSeries(const xt::xarray<double> &matrices)
+{
+    if (matrices.size() == 0)
+    {
+        return;
+    }
+    if (matrices.dimension() != 3 || matrices.shape(1) != 3 || matrices.shape(2) != 3)
+    {
+        throw std::runtime_error("Matrices must have shape (n_frames, 3, 3)");
+    }
+    // the array may not be contiguous row-major, as with a transposed view
+    xt::xarray<double> contiguous = matrices;
+    *this = BoxSeries(contiguous.data(), contiguous.shape(0));
+}
+
+BoxSeries::BoxSeries(std::span<const Box> boxes)
+{
+    reserve(boxes.size());
+    for (const auto &box : boxes)
+    {
+        push_back(box);
+    }
+}
+
+void BoxSeries::push_back(const double *matrix)
+{
+    auto at = [&](size_t i, size_t j) { return matrix[3 * i + j]; };
+    if (!is_close_zero(at(1, 0)) || !is_close_zero(at(2, 0)) || !is_close_zero(at(2, 1)))
+    {
+        throw std::runtime_error("Matrix is not upper triangular");
+    }
+
+    const double a = at(0, 0), b = at(0, 1), c = at(0, 2);
+    const double d = at(1, 1), e = at(1, 2);
+    const double f = at(2, 2);
+    const double h[6] = {a, b, c, d, e, f};
+    double inv[6] = {0, 0, 0, 0, 0, 0};
+    Box::Style style;
+    if (is_close_zero(a) && is_close_zero(b) && is_close_zero(c) && is_close_zero(d) && is_close_zero(e) &&
+        is_close_zero(f))
+    {
+        style = Box::FREE;
+    }
+    else if (!(a * d * f > 0))
+    {
+        throw std::runtime_error("Matrix must be invertible");
+    }
+    else if (is_close_zero(b) && is_close_zero(c) && is_close_zero(e))
+    {
+        style = Box::ORTHOGONAL;
+        inv[0] = 1.0 / a;
+        inv[3] = 1.0 / d;
+        inv[5] = 1.0 / f;
+    }
+    else
+    {
+        style = Box::TRICLINIC;
+        inv[0] = 1.0 / a;
+        inv[1] = -b / (a * d);
+        inv[2] = (b * e - c * d) / (a * d * f);
+        inv[3] = 1.0 / d;
+        inv[4] = -e / (d * f);
+        inv[5] = 1.0 / f;
+    }
+
+    _styles.push_back(style);
+    _h.insert(_h.end(), h, h + 6);
+    _inv.insert(_inv.end(), inv, inv + 6);
+}
+
+void BoxSeries::push_back(const Box &box)
+{
+    if (box.get_style() == Box::FREE)
+    {
+        const double zeros[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+        return push_back(zeros);
+    }
+    const Mat3 matrix = box.get_matrix();
+    push_back(matrix.data());
+}
+
+void BoxSeries::reserve(size_t n_frames)
+{
+    _styles.reserve(n_frames);
+    _h.reserve(6 * n_frames);
+    _inv.reserve(6 * n_frames);
+}
+
+auto BoxSeries::get_box(size_t frame) const -> Box
+{
+    if (frame >= n_frames())
+    {
+        throw std::runtime_error("Frame index out of range");
+    }
+    if (_styles[frame] == Box::FREE)
+    {
+        return Box();
+    }
+    const double *h = _h.data() + 6 * frame;
+    Mat3 matrix;
+    matrix.fill(0.0);
+    matrix(0, 0) = h[0];
+    matrix(0, 1) = h[1];
+    matrix(0, 2) = h[2];
+    matrix(1, 1) = h[3];
+    matrix(1, 2) = h[4];
+    matrix(2, 2) = h[5];
+    return Box(matrix);
+}
+
+auto BoxSeries::get_matrices() const -> xt::xarray<double>
+{
+    xt::xarray<double> matrices = xt::zeros<double>({n_frames(), size_t{3}, size_t{3}});
+    for (size_t frame = 0; frame < n_frames(); frame++)
+    {
+        const double *h = _h.data() + 6 * frame;
+        double *out = matrices.data() + 9 * frame;
+        out[0] = h[0];
+        out[1] = h[1];
+        out[2] = h[2];
+        out[4] = h[3];
+        out[5] = h[4];
+        out[8] = h[5];
+    }
+    return matrices;
+}
+
+void BoxSeries::volumes(double *out) const
+{
+    for (size_t frame = 0; frame < n_frames(); frame++)
+    {
+        const double *h = _h.data() + 6 * frame;
+        out[frame] = _styles[frame] == Box::FREE ? 0.0 : h[0] * h[3] * h[5];
+    }
+}
+
+void BoxSeries::lengths(double *out) const
+{
+    for (size_t frame = 0; frame < n_frames(); frame++)
+    {
+        const double *h = _h.data() + 6 * frame;
+        double *l = out + 3 * frame;
+        switch (_styles[frame])
+        {
+        case Box::FREE:
+            l[0] = l[1] = l[2] = 0.0;
+            break;
+        case Box::ORTHOGONAL:
+            l[0] = h[0];
+            l[1] = h[3];
+            l[2] = h[5];
+            break;
+        case Box::TRICLINIC:
+            // box vectors a = (xx, 0, 0), b = (xy, yy, 0), c = (xz, yz, zz)
+            l[0] = std::abs(h[0]);
+            l[1] = std::sqrt(h[1] * h[1] + h[3] * h[3]);
+            l[2] = std::sqrt(h[2] * h[2] + h[4] * h[4] + h[5] * h[5]);
+            break;
+        }
+    }
+}
+
+void BoxSeries::angles(double *out) const
+{
+    for (size_t frame = 0; frame < n_frames(); frame++)
+    {
+        const double *h = _h.data() + 6 * frame;
+        double *angle = out + 3 * frame;
+        if (_styles[frame] != Box::TRICLINIC)
+        {
+            angle[0] = angle[1] = angle[2] = 90.0;
+            continue;
+        }
+        const double la = std::abs(h[0]);
+        const double lb = std::sqrt(h[1] * h[1] + h[3] * h[3]);
+        const double lc = std::sqrt(h[2] * h[2] + h[4] * h[4] + h[5] * h[5]);
+        const double bc = h[1] * h[2] + h[3] * h[4];
+        const double ac = h[0] * h[2];
+        const double ab = h[0] * h[1];
+        angle[0] = std::acos(bc / (lb * lc)) * 180.0 / pi;
+        angle[1] = std::acos(ac / (la * lc)) * 180.0 / pi;
+        angle[2] = std::acos(ab / (la * lb)) * 180.0 / pi;
+    }
+}
+
+auto BoxSeries::get_volumes() const -> xt::xarray<double>
+{
+    xt::xarray<double> result = xt::zeros<double>({n_frames()});
+    volumes(result.data());
+    return result;
+}
+
+auto BoxSeries::get_lengths() const -> xt::xarray<double>
+{
+    xt::xarray<double> result = xt::zeros<double>({n_frames(), size_t{3}});
+    lengths(result.data());
+    return result;
+}
+
+auto BoxSeries::get_angles() const -> xt::xarray<double>
+{
+    xt::xarray<double> result = xt::zeros<double>({n_frames(), size_t{3}});
+    angles(result.data());
+    return result;
+}
+
+template <typename T>
+void BoxSeries::wrap_frames(T *xyz, size_t first, size_t n_frames, size_t n_atoms, ExecutionPolicy policy) const
+{
+    if (first + n_frames > this->n_frames())
+    {
+        throw std::runtime_error("Frame index out of range");
+    }
+    const size_t n_blocks = std::max<size_t>(1, (n_atoms + WRAP_BLOCK - 1) / WRAP_BLOCK);
+    parallel_for(n_frames * n_blocks, policy.n_threads, [&](size_t task, size_t) {
+        const size_t frame = task / n_blocks;
+        const size_t begin = n_atoms * (task % n_blocks) / n_blocks;
+        const size_t end = n_atoms * (task % n_blocks + 1) / n_blocks;
+
+        detail::MicCell cell;
+        switch (_styles[first + frame])
+        {
+        case Box::FREE:
+            return;
+        case Box::ORTHOGONAL:
+            cell.kind = detail::MicCell::ORTHOGONAL;
+            break;
+        case Box::TRICLINIC:
+            cell.kind = detail::MicCell::TRICLINIC;
+            break;
+        }
+        std::copy_n(_h.data() + 6 * (first + frame), 6, cell.h);
+        std::copy_n(_inv.data() + 6 * (first + frame), 6, cell.inv);
+        detail::wrap_positions(cell, xyz + 3 * (frame * n_atoms + begin), end - begin);
+    });
+}
+
+void BoxSeries::wrap_inplace(double *xyz, size_t first, size_t n_frames, size_t n_atoms,
+                             ExecutionPolicy policy) const
+{
+    wrap_frames(xyz, first, n_frames, n_atoms, policy);
+}
+
+void BoxSeries::wrap_inplace(float *xyz, size_t first, size_t n_frames, size_t n_atoms,
+                             ExecutionPolicy policy) const
+{
+    wrap_frames(xyz, first, n_frames, n_atoms, policy);
+}
+
+auto BoxSeries::wrap(const xt::xarray<double> &xyz, size_t first, ExecutionPolicy policy) const
+    -> xt::xarray<double>
+{
+    if (xyz.dimension() != 3 || xyz.shape(2) != 3)
+    {
+        throw std::runtime_error("Positions must have shape (n_frames, n_atoms, 3)");
+    }
+    xt::xarray<double> result = xyz;
+    wrap_inplace(result.data(), first, result.shape(0), result.shape(1), policy);
+    return result;
+}
+
+} // namespace molcpp
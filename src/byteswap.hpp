@@ -0,0 +1,54 @@
+#ifndef MOLCPP_SRC_BYTESWAP_HPP
+#define MOLCPP_SRC_BYTESWAP_HPP
+
+#include <cstdint>
+#include <cstring>
+
+// Internal helpers to read values stored in a given byte order by the
+// trajectory readers. molcpp only runs on little-endian hosts.
+
+namespace molcpp::detail
+{
+
+inline auto byteswap32(uint32_t value) -> uint32_t
+{
+    return ((value & 0xff) << 24) | ((value & 0xff00) << 8) | ((value >> 8) & 0xff00) | (value >> 24);
+}
+
+inline auto byteswap64(uint64_t value) -> uint64_t
+{
+    return (static_cast<uint64_t>(byteswap32(static_cast<uint32_t>(value))) << 32) | byteswap32(value >> 32);
+}
+
+/// Load a 32-bit value at `data`, swapping its bytes if `swap`
+template <typename T> inline auto load32(const char *data, bool swap) -> T
+{
+    static_assert(sizeof(T) == 4);
+    uint32_t bits = 0;
+    std::memcpy(&bits, data, sizeof(bits));
+    if (swap)
+    {
+        bits = byteswap32(bits);
+    }
+    T value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/// Load a 64-bit value at `data`, swapping its bytes if `swap`
+template <typename T> inline auto load64(const char *data, bool swap) -> T
+{
+    static_assert(sizeof(T) == 8);
+    uint64_t bits = 0;
+    std::memcpy(&bits, data, sizeof(bits));
+    if (swap)
+    {
+        bits = byteswap64(bits);
+    }
+    T value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+} // namespace molcpp::detail
+#endif // MOLCPP_SRC_BYTESWAP_HPP
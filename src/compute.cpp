@@ -0,0 +1,346 @@
+#include "molcpp/compute.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <xtensor/xadapt.hpp>
+
+namespace molcpp
+{
+
+StreamingMSDCompute::StreamingMSDCompute(size_t points_per_level, size_t decimation, size_t n_levels)
+    : _points(points_per_level), _decimation(decimation), _n_levels(n_levels)
+{
+    if (decimation < 2 || points_per_level < decimation || points_per_level % decimation != 0)
+    {
+        throw std::runtime_error("Points per level must be a multiple of decimation, which must be >= 2");
+    }
+    if (n_levels == 0)
+    {
+        throw std::runtime_error("Number of levels must be > 0");
+    }
+}
+
+void StreamingMSDCompute::push_frame(const xt::xarray<double> &xyz, const Box &box)
+{
+    if (xyz.dimension() != 2 || xyz.shape(1) != 3)
+    {
+        throw std::runtime_error("Positions must have shape (n, 3)");
+    }
+    push_frame(xyz.data(), xyz.shape(0), box);
+}
+
+template <typename T> void StreamingMSDCompute::push(const T *xyz, size_t n_atoms, const Box &box)
+{
+    if (_n_frames == 0)
+    {
+        _n_atoms = n_atoms;
+        _unwrapped.assign(xyz, xyz + 3 * n_atoms);
+        _history.assign(_n_levels, {});
+        _head.assign(_n_levels, 0);
+        _filled.assign(_n_levels, 0);
+        _pushed.assign(_n_levels, 0);
+        _sums.assign(_n_levels * _points, 0.0);
+        _counts.assign(_n_levels * _points, 0);
+    }
+    else
+    {
+        if (n_atoms != _n_atoms)
+        {
+            throw std::runtime_error("Number of atoms changed between frames");
+        }
+        _scratch.assign(xyz, xyz + 3 * n_atoms);
+        box.unwrap_inplace(_scratch.data(), _unwrapped.data(), n_atoms);
+        std::swap(_scratch, _unwrapped);
+    }
+    _n_frames++;
+    add(0, _unwrapped.data());
+}
+
+void StreamingMSDCompute::push_frame(const double *xyz, size_t n_atoms, const Box &box)
+{
+    push(xyz, n_atoms, box);
+}
+
+void StreamingMSDCompute::push_frame(const float *xyz, size_t n_atoms, const Box &box)
+{
+    push(xyz, n_atoms, box);
+}
+
+void StreamingMSDCompute::begin(size_t)
+{
+    _n_frames = 0;
+}
+
+void StreamingMSDCompute::accumulate(const FrameContext &frame)
+{
+    push_frame(frame.positions(), frame.n_atoms(), frame.box());
+}
+
+void StreamingMSDCompute::add(size_t level, const double *xyz)
+{
+    const size_t size = 3 * _n_atoms;
+    auto &history = _history[level];
+    if (history.empty())
+    {
+        history.resize(_points * size);
+    }
+
+    _head[level] = (_head[level] + _points - 1) % _points;
+    std::copy_n(xyz, size, history.data() + _head[level] * size);
+    _filled[level] = std::min(_filled[level] + 1, _points);
+
+    // smaller lags are already sampled more often by the level below
+    size_t first = level == 0 ? 0 : _points / _decimation;
+    for (size_t j = first; j < _filled[level]; j++)
+    {
+        const double *old = history.data() + ((_head[level] + j) % _points) * size;
+        double sum = 0;
+        for (size_t k = 0; k < size; k++)
+        {
+            double d = xyz[k] - old[k];
+            sum += d * d;
+        }
+        _sums[level * _points + j] += sum;
+        _counts[level * _points + j]++;
+    }
+
+    if (level + 1 < _n_levels && _pushed[level]++ % _decimation == 0)
+    {
+        add(level + 1, xyz);
+    }
+}
+
+auto StreamingMSDCompute::get_lags() const -> xt::xarray<size_t>
+{
+    std::vector<size_t> lags;
+    size_t scale = 1;
+    for (size_t level = 0; level < _n_levels && _n_frames > 0; level++, scale *= _decimation)
+    {
+        for (size_t j = level == 0 ? 0 : _points / _decimation; j < _points; j++)
+        {
+            if (_counts[level * _points + j] > 0)
+            {
+                lags.push_back(j * scale);
+            }
+        }
+    }
+    return xt::adapt(lags);
+}
+
+auto StreamingMSDCompute::get_result() const -> Result1D<double>
+{
+    std::vector<double> msd;
+    for (size_t level = 0; level < _n_levels && _n_frames > 0; level++)
+    {
+        for (size_t j = level == 0 ? 0 : _points / _decimation; j < _points; j++)
+        {
+            size_t count = _counts[level * _points + j];
+            if (count > 0)
+            {
+                msd.push_back(_sums[level * _points + j] / static_cast<double>(count * _n_atoms));
+            }
+        }
+    }
+    return {"streaming_msd", xt::adapt(msd)};
+}
+
+auto StreamingMSDCompute::memory_usage() const -> size_t
+{
+    size_t bytes = (_unwrapped.capacity() + _scratch.capacity()) * sizeof(double);
+    for (const auto &history : _history)
+    {
+        bytes += history.capacity() * sizeof(double);
+    }
+    return bytes;
+}
+
+// atoms of a frame are split in this number of ranges, which threads take
+// from a shared queue
+static constexpr size_t RDF_TASKS = 64;
+
+RDFCompute::RDFCompute(double r_max, size_t n_bins, ExecutionPolicy policy)
+    : _r_max(r_max), _n_bins(n_bins), _policy(policy), _cells(r_max, false, true), _counts(n_bins, 0)
+{
+    if (n_bins == 0)
+    {
+        throw std::runtime_error("Number of bins must be > 0");
+    }
+    _cells.set_n_threads(policy.n_threads);
+}
+
+void RDFCompute::select_pair(int type_a, int type_b)
+{
+    _select_pair = true;
+    _type_a = type_a;
+    _type_b = type_b;
+    reset();
+}
+
+void RDFCompute::select_all()
+{
+    _select_pair = false;
+    reset();
+}
+
+void RDFCompute::reset()
+{
+    _n_frames = 0;
+    _counts.assign(_n_bins, 0);
+    _pair_density = 0;
+}
+
+void RDFCompute::push_frame(const xt::xarray<double> &xyz, const Box &box)
+{
+    if (xyz.dimension() != 2 || xyz.shape(1) != 3)
+    {
+        throw std::runtime_error("Positions must have shape (n, 3)");
+    }
+    push_frame(xyz.data(), xyz.shape(0), box);
+}
+
+void RDFCompute::push_frame(const xt::xarray<double> &xyz, const Box &box, const xt::xarray<int> &types)
+{
+    if (xyz.dimension() != 2 || xyz.shape(1) != 3)
+    {
+        throw std::runtime_error("Positions must have shape (n, 3)");
+    }
+    if (types.dimension() != 1 || types.shape(0) != xyz.shape(0))
+    {
+        throw std::runtime_error("Types must have shape (n)");
+    }
+    push_frame(xyz.data(), xyz.shape(0), box, types.data());
+}
+
+void RDFCompute::begin(size_t)
+{
+    reset();
+}
+
+void RDFCompute::accumulate(const FrameContext &frame)
+{
+    add_frame(frame.neighbors(), frame.n_atoms(), frame.box(), frame.types());
+}
+
+void RDFCompute::push_frame(const double *xyz, size_t n_atoms, const Box &box, const int *types)
+{
+    _cells.build(xyz, n_atoms, box, _list);
+    add_frame(_list, n_atoms, box, types);
+}
+
+void RDFCompute::push_frame(const float *xyz, size_t n_atoms, const Box &box, const int *types)
+{
+    _cells.build(xyz, n_atoms, box, _list);
+    add_frame(_list, n_atoms, box, types);
+}
+
+void RDFCompute::add_frame(const NeighborList &list, size_t n_atoms, const Box &box, const int *types)
+{
+    if (box.get_style() == Box::FREE)
+    {
+        throw std::runtime_error("RDF requires a periodic box");
+    }
+    if (_select_pair && types == nullptr)
+    {
+        throw std::runtime_error("Atom types are required to select pairs");
+    }
+
+    // number of distinct pairs matching the selection
+    double n_pairs = 0;
+    if (_select_pair)
+    {
+        auto n_a = static_cast<double>(std::count(types, types + n_atoms, _type_a));
+        auto n_b = static_cast<double>(std::count(types, types + n_atoms, _type_b));
+        n_pairs = _type_a == _type_b ? n_a * (n_a - 1) / 2 : n_a * n_b;
+    }
+    else
+    {
+        auto n = static_cast<double>(n_atoms);
+        n_pairs = n * (n - 1) / 2;
+    }
+
+    const size_t n_threads = resolve_n_threads(_policy.n_threads);
+    _thread_counts.resize(n_threads);
+    for (auto &counts : _thread_counts)
+    {
+        counts.assign(_n_bins, 0);
+    }
+    const double scale = static_cast<double>(_n_bins) / _r_max;
+    parallel_for(RDF_TASKS, n_threads, [&](size_t task, size_t thread) {
+        auto &counts = _thread_counts[thread];
+        const size_t end = n_atoms * (task + 1) / RDF_TASKS;
+        for (size_t i = n_atoms * task / RDF_TASKS; i < end; i++)
+        {
+            // the list is a half list, each pair is seen once
+            for (size_t k = list.offsets[i]; k < list.offsets[i + 1]; k++)
+            {
+                if (_select_pair)
+                {
+                    const int ti = types[i];
+                    const int tj = types[list.indices[k]];
+                    if (!((ti == _type_a && tj == _type_b) || (ti == _type_b && tj == _type_a)))
+                    {
+                        continue;
+                    }
+                }
+                // a shared list can go beyond `r_max`
+                auto bin = static_cast<size_t>(list.distances[k] * scale);
+                if (bin < _n_bins)
+                {
+                    counts[bin]++;
+                }
+            }
+        }
+    });
+    for (const auto &counts : _thread_counts)
+    {
+        for (size_t bin = 0; bin < _n_bins; bin++)
+        {
+            _counts[bin] += counts[bin];
+        }
+    }
+
+    _pair_density += n_pairs / box.get_volume();
+    _n_frames++;
+}
+
+auto RDFCompute::compute(const xt::xarray<double> &xyz, const Box &box) -> Result2D
+{
+    if (xyz.dimension() != 3 || xyz.shape(2) != 3)
+    {
+        throw std::runtime_error("Positions must have shape (frames, atoms, 3)");
+    }
+    reset();
+    const size_t n_atoms = xyz.shape(1);
+    for (size_t frame = 0; frame < xyz.shape(0); frame++)
+    {
+        push_frame(xyz.data() + frame * 3 * n_atoms, n_atoms, box);
+    }
+    return get_result();
+}
+
+auto RDFCompute::get_result() const -> Result2D
+{
+    xt::xarray<double> rdf = xt::zeros<double>({_n_bins});
+    const double width = _r_max / static_cast<double>(_n_bins);
+    for (size_t bin = 0; bin < _n_bins && _pair_density > 0; bin++)
+    {
+        const double r_in = width * static_cast<double>(bin);
+        const double r_out = r_in + width;
+        const double shell = 4.0 / 3.0 * pi * (r_out * r_out * r_out - r_in * r_in * r_in);
+        rdf(bin) = static_cast<double>(_counts[bin]) / (_pair_density * shell);
+    }
+    return {"rdf", get_bin_centers(), rdf};
+}
+
+auto RDFCompute::get_bin_centers() const -> xt::xarray<double>
+{
+    const double width = _r_max / static_cast<double>(_n_bins);
+    return (xt::arange<double>(static_cast<double>(_n_bins)) + 0.5) * width;
+}
+
+auto RDFCompute::get_pair_counts() const -> xt::xarray<uint64_t>
+{
+    return xt::adapt(_counts);
+}
+
+} // namespace molcpp
@@ -0,0 +1,145 @@
+#include "molcpp/trajectory.hpp"
+#include "byteswap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace molcpp
+{
+
+using detail::load32;
+using detail::load64;
+
+// The header is a Fortran record of 84 bytes: "CORD" and 20 control integers
+static constexpr uint32_t DCD_HEADER_BYTES = 84;
+// number of atoms which do not move
+static constexpr size_t DCD_N_FIXED = 8;
+// whether frames have a unit cell
+static constexpr size_t DCD_HAS_CELL = 10;
+// whether frames have a fourth dimension
+static constexpr size_t DCD_HAS_4D = 11;
+// version of CHARMM which wrote the file, 0 for X-PLOR files
+static constexpr size_t DCD_CHARMM_VERSION = 19;
+
+DCDTrajectory::DCDTrajectory(const std::string &path) : _file(path)
+{
+    const char *data = _file.data();
+    const size_t size = _file.size();
+    if (size < DCD_HEADER_BYTES + 8)
+    {
+        throw std::runtime_error(path + " is not a DCD file");
+    }
+    uint32_t marker = 0;
+    std::memcpy(&marker, data, sizeof(marker));
+    if (marker != DCD_HEADER_BYTES)
+    {
+        if (detail::byteswap32(marker) != DCD_HEADER_BYTES)
+        {
+            throw std::runtime_error(path + " is not a DCD file");
+        }
+        _swap = true;
+    }
+    if (std::memcmp(data + 4, "CORD", 4) != 0 || static_cast<uint32_t>(load_int(88)) != DCD_HEADER_BYTES)
+    {
+        throw std::runtime_error(path + " is not a DCD file");
+    }
+    int32_t control[20];
+    for (size_t i = 0; i < 20; i++)
+    {
+        control[i] = load_int(8 + 4 * i);
+    }
+    if (control[DCD_N_FIXED] != 0)
+    {
+        throw std::runtime_error("DCD files with fixed atoms are not supported");
+    }
+    const bool charmm = control[DCD_CHARMM_VERSION] != 0;
+    _has_cell = charmm && control[DCD_HAS_CELL] != 0;
+    const bool has_4d = charmm && control[DCD_HAS_4D] != 0;
+
+    // title record, then a record with the number of atoms
+    size_t offset = DCD_HEADER_BYTES + 8;
+    if (offset + 4 > size)
+    {
+        throw std::runtime_error(path + " is truncated");
+    }
+    const auto title = static_cast<uint32_t>(load_int(offset));
+    offset += title + 8;
+    if (offset + 12 > size || static_cast<uint32_t>(load_int(offset - 4)) != title || load_int(offset) != 4 ||
+        load_int(offset + 8) != 4)
+    {
+        throw std::runtime_error("Invalid DCD header in " + path);
+    }
+    const int32_t n_atoms = load_int(offset + 4);
+    if (n_atoms < 0)
+    {
+        throw std::runtime_error("Invalid number of atoms in " + path);
+    }
+    _n_atoms = static_cast<size_t>(n_atoms);
+    _first_frame = offset + 12;
+    _frame_bytes = (_has_cell ? 6 * sizeof(double) + 8 : 0) + (has_4d ? 4 : 3) * (4 * _n_atoms + 8);
+    // the frame count in the header is not updated if writing was
+    // interrupted, so trust the size of the file instead
+    _n_frames = (size - _first_frame) / _frame_bytes;
+}
+
+auto DCDTrajectory::load_int(size_t offset) const -> int32_t
+{
+    return load32<int32_t>(_file.data() + offset, _swap);
+}
+
+auto DCDTrajectory::read(size_t frame, double *xyz) const -> Box
+{
+    check_frame(frame);
+    size_t offset = _first_frame + frame * _frame_bytes;
+
+    Box box;
+    if (_has_cell)
+    {
+        if (load_int(offset) != static_cast<int32_t>(6 * sizeof(double)))
+        {
+            throw std::runtime_error("Invalid unit cell in DCD frame " + std::to_string(frame));
+        }
+        // A, cos(gamma), B, cos(beta), cos(alpha), C. Old files store the
+        // angles in degrees instead of cosines.
+        double cell[6];
+        for (size_t i = 0; i < 6; i++)
+        {
+            cell[i] = load64<double>(_file.data() + offset + 4 + 8 * i, _swap);
+        }
+        offset += 6 * sizeof(double) + 8;
+
+        if (cell[0] != 0 || cell[2] != 0 || cell[5] != 0)
+        {
+            Vec3 angles = {cell[4], cell[3], cell[1]};
+            if (std::all_of(angles.begin(), angles.end(), [](double x) { return std::abs(x) <= 1.0; }))
+            {
+                // 90 - asin(x) rather than acos(x) gives exactly 90 degrees
+                // for orthogonal boxes
+                for (auto &angle : angles)
+                {
+                    angle = 90.0 - std::asin(angle) * 180.0 / pi;
+                }
+            }
+            box = Box::from_lengths_angles({cell[0], cell[2], cell[5]}, angles);
+        }
+    }
+
+    const auto record = static_cast<int32_t>(4 * _n_atoms);
+    for (size_t d = 0; d < 3; d++)
+    {
+        if (load_int(offset) != record || load_int(offset + 4 + record) != record)
+        {
+            throw std::runtime_error("Invalid positions in DCD frame " + std::to_string(frame));
+        }
+        const char *values = _file.data() + offset + 4;
+        for (size_t i = 0; i < _n_atoms; i++)
+        {
+            xyz[3 * i + d] = load32<float>(values + 4 * i, _swap);
+        }
+        offset += record + 8;
+    }
+    return box;
+}
+
+} // namespace molcpp
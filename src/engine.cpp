@@ -0,0 +1,146 @@
+#include "molcpp/engine.hpp"
+#include "molcpp/pipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace molcpp
+{
+
+using Clock = std::chrono::steady_clock;
+
+static auto seconds_since(Clock::time_point start) -> double
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+auto FrameContext::wrapped_positions() const -> const double *
+{
+    if (!_has_wrapped)
+    {
+        throw std::runtime_error("Wrapped positions were not requested by any compute");
+    }
+    return _wrapped.data();
+}
+
+auto FrameContext::neighbors() const -> const NeighborList &
+{
+    if (!_has_neighbors)
+    {
+        throw std::runtime_error("Neighbor list was not requested by any compute");
+    }
+    return _list;
+}
+
+ComputeEngine::ComputeEngine(ExecutionPolicy policy) : _policy(policy)
+{
+}
+
+void ComputeEngine::run(const TrajectoryReader &reader)
+{
+    run(reader, 0, reader.n_frames());
+}
+
+void ComputeEngine::run(const TrajectoryReader &reader, size_t begin_frame, size_t end, size_t stride)
+{
+    FramePipeline pipeline(reader);
+    pipeline.add_consumer([&](const FrameBuffer &frame) {
+        accumulate(frame.frame, frame.xyz.data(), reader.n_atoms(), frame.box);
+    });
+    begin(reader.n_atoms());
+    pipeline.run(begin_frame, end, stride);
+    finalize();
+}
+
+void ComputeEngine::run(const xt::xarray<double> &xyz, const Box &box)
+{
+    if (xyz.dimension() != 3 || xyz.shape(2) != 3)
+    {
+        throw std::runtime_error("Positions must have shape (frames, atoms, 3)");
+    }
+    const size_t n_atoms = xyz.shape(1);
+    begin(n_atoms);
+    for (size_t frame = 0; frame < xyz.shape(0); frame++)
+    {
+        accumulate(frame, xyz.data() + frame * 3 * n_atoms, n_atoms, box);
+    }
+    finalize();
+}
+
+void ComputeEngine::begin(size_t n_atoms)
+{
+    if (!_types.empty() && _types.size() != n_atoms)
+    {
+        throw std::runtime_error("Number of types does not match the number of atoms");
+    }
+    _requirements = FrameRequirements();
+    for (const auto &hooks : _hooks)
+    {
+        auto requirements = hooks.requirements();
+        _requirements.neighbor_cutoff = std::max(_requirements.neighbor_cutoff, requirements.neighbor_cutoff);
+        _requirements.wrapped = _requirements.wrapped || requirements.wrapped;
+    }
+    if (_requirements.neighbor_cutoff > 0 &&
+        (!_cells || _cells->get_cutoff() != _requirements.neighbor_cutoff))
+    {
+        _cells = std::make_unique<CellList>(_requirements.neighbor_cutoff, false, true);
+    }
+    if (_cells)
+    {
+        _cells->set_n_threads(_policy.n_threads);
+    }
+
+    _compute_times.assign(_hooks.size(), 0.0);
+    _shared_time = 0;
+    for (const auto &hooks : _hooks)
+    {
+        hooks.begin(n_atoms);
+    }
+}
+
+void ComputeEngine::accumulate(size_t frame, const double *xyz, size_t n_atoms, const Box &box)
+{
+    if (!_types.empty() && _types.size() != n_atoms)
+    {
+        throw std::runtime_error("Number of types does not match the number of atoms");
+    }
+    auto start = Clock::now();
+    _frame._index = frame;
+    _frame._n_atoms = n_atoms;
+    _frame._xyz = xyz;
+    _frame._box = &box;
+    _frame._types = _types.empty() ? nullptr : _types.data();
+
+    _frame._has_wrapped = _requirements.wrapped;
+    if (_requirements.wrapped)
+    {
+        _frame._wrapped.assign(xyz, xyz + 3 * n_atoms);
+        parallel_ranges(n_atoms, 64, _policy.n_threads, [&](size_t begin, size_t end) {
+            box.wrap_inplace(_frame._wrapped.data() + 3 * begin, end - begin);
+        });
+    }
+    _frame._has_neighbors = _requirements.neighbor_cutoff > 0;
+    if (_frame._has_neighbors)
+    {
+        _cells->build(xyz, n_atoms, box, _frame._list);
+    }
+    _shared_time += seconds_since(start);
+
+    for (size_t i = 0; i < _hooks.size(); i++)
+    {
+        start = Clock::now();
+        _hooks[i].accumulate(_frame);
+        _compute_times[i] += seconds_since(start);
+    }
+}
+
+void ComputeEngine::finalize()
+{
+    for (const auto &hooks : _hooks)
+    {
+        hooks.finalize();
+    }
+}
+
+} // namespace molcpp
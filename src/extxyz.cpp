@@ -0,0 +1,226 @@
+#include "molcpp/trajectory.hpp"
+#include "text.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace molcpp
+{
+
+using detail::LineReader;
+using detail::next_token;
+using detail::parse;
+
+/// Number of atoms announced by the first line of a frame
+static auto parse_count(std::string_view line) -> size_t
+{
+    auto token = next_token(line);
+    size_t count = 0;
+    auto result = std::from_chars(token.data(), token.data() + token.size(), count);
+    if (token.empty() || result.ec != std::errc() || result.ptr != token.data() + token.size())
+    {
+        throw std::runtime_error("Invalid XYZ file: expected a number of atoms");
+    }
+    return count;
+}
+
+static auto scan_xyz(const MappedFile &file, ExecutionPolicy policy) -> std::vector<uint64_t>
+{
+    const char *data = file.data();
+    const size_t size = file.size();
+    std::vector<uint64_t> offsets;
+    if (size == 0)
+    {
+        return offsets;
+    }
+    LineReader first(data, data + size);
+    const size_t frame_lines = parse_count(first.next()) + 2;
+
+    // count the lines of each chunk, then find where the lines starting a
+    // frame are, knowing the index of the first line of each chunk
+    const size_t n_chunks = (size + detail::SCAN_CHUNK_BYTES - 1) / detail::SCAN_CHUNK_BYTES;
+    auto chunk_begin = [&](size_t chunk) { return data + std::min(size, chunk * detail::SCAN_CHUNK_BYTES); };
+    std::vector<size_t> first_line(n_chunks + 1, 0);
+    parallel_for(n_chunks, policy.n_threads, [&](size_t chunk, size_t) {
+        first_line[chunk + 1] = static_cast<size_t>(std::count(chunk_begin(chunk), chunk_begin(chunk + 1), '\n'));
+    });
+    for (size_t chunk = 0; chunk < n_chunks; chunk++)
+    {
+        first_line[chunk + 1] += first_line[chunk];
+    }
+
+    std::vector<std::vector<uint64_t>> found(n_chunks);
+    parallel_for(n_chunks, policy.n_threads, [&](size_t chunk, size_t) {
+        const char *end = chunk_begin(chunk + 1);
+        size_t line = first_line[chunk];
+        for (const char *c = chunk_begin(chunk); c < end; c++)
+        {
+            c = static_cast<const char *>(std::memchr(c, '\n', static_cast<size_t>(end - c)));
+            if (c == nullptr)
+            {
+                break;
+            }
+            line++;
+            if (line % frame_lines == 0)
+            {
+                found[chunk].push_back(static_cast<uint64_t>(c + 1 - data));
+            }
+        }
+    });
+
+    offsets.push_back(0);
+    for (const auto &chunk : found)
+    {
+        offsets.insert(offsets.end(), chunk.begin(), chunk.end());
+    }
+    const size_t n_lines = first_line[n_chunks] + (data[size - 1] == '\n' ? 0 : 1);
+    const size_t n_frames = n_lines / frame_lines;
+    const size_t end = n_frames < offsets.size() ? offsets[n_frames] : size;
+    if (!std::all_of(data + end, data + size, [](char c) { return std::isspace(static_cast<unsigned char>(c)); }))
+    {
+        throw std::runtime_error("Invalid XYZ file: the last frame is incomplete");
+    }
+    offsets.resize(n_frames);
+    offsets.push_back(end);
+    return offsets;
+}
+
+ExtendedXYZTrajectory::ExtendedXYZTrajectory(const std::string &path, ExecutionPolicy policy)
+    : _file(path), _index(path, _file, [policy](const MappedFile &file) { return scan_xyz(file, policy); })
+{
+    if (_index.n_frames() != 0)
+    {
+        _n_atoms = parse_count(LineReader(_file.data(), _file.data() + _index.end(0)).next());
+    }
+}
+
+static auto iequals(std::string_view a, std::string_view b) -> bool
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+/// Call `fn(key, value)` for every `key=value` or `key="some value"` of an
+/// extended XYZ comment line, ignoring anything else
+template <typename F> static void for_each_pair(std::string_view line, F &&fn)
+{
+    size_t i = 0;
+    while (i < line.size())
+    {
+        while (i < line.size() && detail::is_space(line[i]))
+        {
+            i++;
+        }
+        const size_t key_begin = i;
+        while (i < line.size() && !detail::is_space(line[i]) && line[i] != '=')
+        {
+            i++;
+        }
+        auto key = line.substr(key_begin, i - key_begin);
+        if (i == line.size() || line[i] != '=')
+        {
+            continue;
+        }
+        i++;
+
+        std::string_view value;
+        if (i < line.size() && line[i] == '"')
+        {
+            const size_t end = line.find('"', i + 1);
+            if (end == std::string_view::npos)
+            {
+                throw std::runtime_error("Invalid extended XYZ comment line: missing closing quote");
+            }
+            value = line.substr(i + 1, end - i - 1);
+            i = end + 1;
+        }
+        else
+        {
+            const size_t value_begin = i;
+            while (i < line.size() && !detail::is_space(line[i]))
+            {
+                i++;
+            }
+            value = line.substr(value_begin, i - value_begin);
+        }
+        fn(key, value);
+    }
+}
+
+/// First column of the positions in `Properties=name:type:count:...`
+static auto find_positions(std::string_view properties) -> size_t
+{
+    auto field = [&]() {
+        const size_t end = std::min(properties.find(':'), properties.size());
+        auto value = properties.substr(0, end);
+        properties.remove_prefix(std::min(end + 1, properties.size()));
+        return value;
+    };
+    size_t column = 0;
+    while (!properties.empty())
+    {
+        auto name = field();
+        field();
+        auto count = parse<size_t>(field());
+        if (name == "pos")
+        {
+            if (count != 3)
+            {
+                throw std::runtime_error("Invalid extended XYZ file: 'pos' must have 3 columns");
+            }
+            return column;
+        }
+        column += count;
+    }
+    throw std::runtime_error("Invalid extended XYZ file: no 'pos' property");
+}
+
+auto ExtendedXYZTrajectory::read(size_t frame, double *xyz) const -> Box
+{
+    check_frame(frame);
+    LineReader lines(_file.data() + _index.begin(frame), _file.data() + _index.end(frame));
+    if (parse_count(lines.next()) != _n_atoms)
+    {
+        throw std::runtime_error("Number of atoms changed in XYZ frame " + std::to_string(frame));
+    }
+
+    Box box;
+    size_t column = 1;
+    for_each_pair(lines.next(), [&](std::string_view key, std::string_view value) {
+        if (iequals(key, "Lattice"))
+        {
+            // the lattice vectors are the rows, and the columns of the matrix
+            Mat3 matrix;
+            for (size_t i = 0; i < 9; i++)
+            {
+                matrix(i % 3, i / 3) = parse<double>(next_token(value));
+            }
+            if (!next_token(value).empty())
+            {
+                throw std::runtime_error("Invalid extended XYZ file: Lattice must have 9 values");
+            }
+            box = Box(matrix);
+        }
+        else if (iequals(key, "Properties"))
+        {
+            column = find_positions(value);
+        }
+    });
+
+    for (size_t i = 0; i < _n_atoms; i++)
+    {
+        auto line = lines.next();
+        for (size_t skip = 0; skip < column; skip++)
+        {
+            next_token(line);
+        }
+        for (size_t d = 0; d < 3; d++)
+        {
+            xyz[3 * i + d] = parse<double>(next_token(line));
+        }
+    }
+    return box;
+}
+
+} // namespace molcpp
@@ -0,0 +1,176 @@
+#include "molcpp/fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+#include <utility>
+
+namespace molcpp
+{
+
+FFT::FFT(size_t size) : _size(size)
+{
+    if (size == 0 || (size & (size - 1)) != 0)
+    {
+        throw std::runtime_error("FFT size must be a power of 2");
+    }
+
+    _twiddles.resize(size / 2);
+    for (size_t k = 0; k < size / 2; k++)
+    {
+        double angle = -2.0 * std::numbers::pi * static_cast<double>(k) / static_cast<double>(size);
+        _twiddles[k] = {std::cos(angle), std::sin(angle)};
+    }
+
+    size_t bits = 0;
+    while ((size_t{1} << bits) < size)
+    {
+        bits++;
+    }
+    _bit_reversed.resize(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        size_t reversed = 0;
+        for (size_t b = 0; b < bits; b++)
+        {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        _bit_reversed[i] = reversed;
+    }
+}
+
+auto FFT::next_size(size_t n) -> size_t
+{
+    size_t size = 1;
+    while (size < n)
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+void FFT::forward(std::complex<double> *data) const
+{
+    transform(data, false);
+}
+
+void FFT::inverse(std::complex<double> *data) const
+{
+    transform(data, true);
+}
+
+void FFT::transform(std::complex<double> *data, bool inverse) const
+{
+    for (size_t i = 0; i < _size; i++)
+    {
+        if (i < _bit_reversed[i])
+        {
+            std::swap(data[i], data[_bit_reversed[i]]);
+        }
+    }
+
+    // complex products are written out: `std::complex::operator*` has to
+    // handle infinities and NaN, which prevents vectorization
+    const double sign = inverse ? -1.0 : 1.0;
+    for (size_t half = 1; half < _size; half <<= 1)
+    {
+        const size_t step = _size / (2 * half);
+        for (size_t start = 0; start < _size; start += 2 * half)
+        {
+            for (size_t j = 0; j < half; j++)
+            {
+                const double wr = _twiddles[j * step].real();
+                const double wi = sign * _twiddles[j * step].imag();
+                auto &a = data[start + j];
+                auto &b = data[start + j + half];
+                const double br = b.real() * wr - b.imag() * wi;
+                const double bi = b.real() * wi + b.imag() * wr;
+                b = {a.real() - br, a.imag() - bi};
+                a = {a.real() + br, a.imag() + bi};
+            }
+        }
+    }
+
+    if (inverse)
+    {
+        const double scale = 1.0 / static_cast<double>(_size);
+        for (size_t i = 0; i < _size; i++)
+        {
+            data[i] *= scale;
+        }
+    }
+}
+
+WindowMSDKernel::WindowMSDKernel(size_t n_frames)
+    : _n_frames(n_frames), _fft(FFT::next_size(2 * std::max<size_t>(n_frames, 1))), _xy(_fft.size()),
+      _z(_fft.size()), _squares(n_frames + 1)
+{
+}
+
+template <typename T> void WindowMSDKernel::compute_impl(const T *xyz, size_t stride, double *msd)
+{
+    const size_t n = _n_frames;
+    const size_t size = _fft.size();
+    if (n == 0)
+    {
+        return;
+    }
+
+    // positions are taken relative to the first frame: the MSD does not
+    // depend on the origin, and the squared and cross terms below cancel
+    // catastrophically for atoms far from it. x and y are packed in a single
+    // complex signal, zero padded to at least 2n so that the circular
+    // correlation does not wrap around
+    const double x0 = xyz[0], y0 = xyz[1], z0 = xyz[2];
+    for (size_t t = 0; t < n; t++)
+    {
+        const T *r = xyz + t * stride;
+        const double x = r[0] - x0, y = r[1] - y0, z = r[2] - z0;
+        _xy[t] = {x, y};
+        _z[t] = {z, 0.0};
+        _squares[t] = x * x + y * y + z * z;
+    }
+    std::fill(_xy.begin() + static_cast<long>(n), _xy.end(), std::complex<double>());
+    std::fill(_z.begin() + static_cast<long>(n), _z.end(), std::complex<double>());
+    _squares[n] = 0;
+
+    _fft.forward(_xy.data());
+    _fft.forward(_z.data());
+    // power spectrum of x + power spectrum of y, separated from the packed
+    // transform using the hermitian symmetry of real signals
+    for (size_t k = 0; k < size; k++)
+    {
+        const double xy = 0.5 * (std::norm(_xy[k]) + std::norm(_xy[(size - k) % size]));
+        _z[k] = {xy + std::norm(_z[k]), 0.0};
+    }
+    _fft.inverse(_z.data());
+
+    double sum = 0;
+    for (size_t t = 0; t < n; t++)
+    {
+        sum += _squares[t];
+    }
+    double q = 2 * sum;
+    for (size_t m = 0; m < n; m++)
+    {
+        if (m > 0)
+        {
+            q -= _squares[m - 1] + _squares[n - m];
+        }
+        const double count = static_cast<double>(n - m);
+        msd[m] = q / count - 2.0 * _z[m].real() / count;
+    }
+}
+
+void WindowMSDKernel::compute(const double *xyz, size_t stride, double *msd)
+{
+    compute_impl(xyz, stride, msd);
+}
+
+void WindowMSDKernel::compute(const float *xyz, size_t stride, double *msd)
+{
+    compute_impl(xyz, stride, msd);
+}
+
+} // namespace molcpp
@@ -0,0 +1,243 @@
+#include "molcpp/frame.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace molcpp
+{
+
+auto dtype_size(DType dtype) -> size_t
+{
+    switch (dtype)
+    {
+    case DType::FLOAT64:
+    case DType::INT64:
+        return 8;
+    case DType::FLOAT32:
+    case DType::INT32:
+        return 4;
+    default:
+        throw std::runtime_error("Invalid DType");
+    }
+}
+
+namespace detail
+{
+
+static auto allocate(size_t capacity) -> std::byte *
+{
+    if (capacity == 0)
+    {
+        return nullptr;
+    }
+    auto *data = static_cast<std::byte *>(::operator new(capacity, std::align_val_t{AlignedBuffer::ALIGNMENT}));
+    std::memset(data, 0, capacity);
+    return data;
+}
+
+static void deallocate(std::byte *data)
+{
+    if (data != nullptr)
+    {
+        ::operator delete(data, std::align_val_t{AlignedBuffer::ALIGNMENT});
+    }
+}
+
+/// Smallest multiple of the alignment holding `size` bytes
+static auto padded(size_t size) -> size_t
+{
+    return (size + AlignedBuffer::ALIGNMENT - 1) / AlignedBuffer::ALIGNMENT * AlignedBuffer::ALIGNMENT;
+}
+
+AlignedBuffer::AlignedBuffer(size_t size) : _data(allocate(padded(size))), _size(size), _capacity(padded(size))
+{
+}
+
+AlignedBuffer::~AlignedBuffer()
+{
+    deallocate(_data);
+}
+
+AlignedBuffer::AlignedBuffer(const AlignedBuffer &other) : AlignedBuffer(other._size)
+{
+    if (_size != 0)
+    {
+        std::memcpy(_data, other._data, _size);
+    }
+}
+
+auto AlignedBuffer::operator=(const AlignedBuffer &other) -> AlignedBuffer &
+{
+    if (this != &other)
+    {
+        AlignedBuffer copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+AlignedBuffer::AlignedBuffer(AlignedBuffer &&other) noexcept
+    : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)),
+      _capacity(std::exchange(other._capacity, 0))
+{
+}
+
+auto AlignedBuffer::operator=(AlignedBuffer &&other) noexcept -> AlignedBuffer &
+{
+    if (this != &other)
+    {
+        deallocate(_data);
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+        _capacity = std::exchange(other._capacity, 0);
+    }
+    return *this;
+}
+
+void AlignedBuffer::resize(size_t size)
+{
+    if (size > _capacity)
+    {
+        // grow geometrically, so that adding atoms one by one stays linear
+        const size_t capacity = padded(std::max(size, 2 * _capacity));
+        std::byte *data = allocate(capacity);
+        if (_size != 0)
+        {
+            std::memcpy(data, _data, _size);
+        }
+        deallocate(_data);
+        _data = data;
+        _capacity = capacity;
+    }
+    else if (size < _size)
+    {
+        // bytes past the size are kept at zero for later growth
+        std::memset(_data + size, 0, _size - size);
+    }
+    _size = size;
+}
+
+} // namespace detail
+
+Frame::Frame(size_t n_atoms) : _n_atoms(n_atoms)
+{
+    add_column(keys::X, DType::FLOAT64);
+    add_column(keys::Y, DType::FLOAT64);
+    add_column(keys::Z, DType::FLOAT64);
+}
+
+void Frame::resize(size_t n_atoms)
+{
+    for (auto &column : _columns)
+    {
+        column.data.resize(n_atoms * dtype_size(column.dtype));
+    }
+    _n_atoms = n_atoms;
+}
+
+auto Frame::add_column(Key key, DType dtype) -> void *
+{
+    if (!key.is_valid())
+    {
+        throw std::runtime_error("Invalid key");
+    }
+    if (has_column(key))
+    {
+        auto &column = get(key);
+        if (column.dtype != dtype)
+        {
+            throw std::runtime_error("Column '" + key.name() + "' already exists with another type");
+        }
+        return column.data.data();
+    }
+    if (key.id() >= _slots.size())
+    {
+        _slots.resize(key.id() + 1, NONE);
+    }
+    _slots[key.id()] = static_cast<uint32_t>(_columns.size());
+    _columns.push_back({key, dtype, detail::AlignedBuffer(_n_atoms * dtype_size(dtype))});
+    return _columns.back().data.data();
+}
+
+void Frame::remove_column(Key key)
+{
+    if (key == keys::X || key == keys::Y || key == keys::Z)
+    {
+        throw std::runtime_error("Positions can not be removed");
+    }
+    const uint32_t index = slot(key);
+    if (index == NONE)
+    {
+        return;
+    }
+    _columns.erase(_columns.begin() + index);
+    _slots[key.id()] = NONE;
+    for (uint32_t i = index; i < _columns.size(); i++)
+    {
+        _slots[_columns[i].key.id()] = i;
+    }
+}
+
+auto Frame::column_keys() const -> std::vector<Key>
+{
+    std::vector<Key> keys;
+    keys.reserve(_columns.size());
+    for (const auto &column : _columns)
+    {
+        keys.push_back(column.key);
+    }
+    return keys;
+}
+
+auto Frame::get(Key key) const -> const Column &
+{
+    const uint32_t index = slot(key);
+    if (index == NONE)
+    {
+        throw std::runtime_error(key.is_valid() ? "No column '" + key.name() + "' in frame" : "Invalid key");
+    }
+    return _columns[index];
+}
+
+auto Frame::get(Key key) -> Column &
+{
+    return const_cast<Column &>(std::as_const(*this).get(key));
+}
+
+auto Frame::typed_data(Key key, DType dtype) -> void *
+{
+    auto &column = get(key);
+    if (column.dtype != dtype)
+    {
+        throw std::runtime_error("Column '" + key.name() + "' holds another type");
+    }
+    return column.data.data();
+}
+
+void Frame::set_positions(const double *xyz)
+{
+    auto [x, y, z] = positions();
+    for (size_t i = 0; i < _n_atoms; i++)
+    {
+        x[i] = xyz[3 * i];
+        y[i] = xyz[3 * i + 1];
+        z[i] = xyz[3 * i + 2];
+    }
+}
+
+void Frame::get_positions(double *xyz) const
+{
+    auto x = column<double>(keys::X);
+    auto y = column<double>(keys::Y);
+    auto z = column<double>(keys::Z);
+    for (size_t i = 0; i < _n_atoms; i++)
+    {
+        xyz[3 * i] = x[i];
+        xyz[3 * i + 1] = y[i];
+        xyz[3 * i + 2] = z[i];
+    }
+}
+
+} // namespace molcpp
@@ -0,0 +1,85 @@
+#include "molcpp/key.hpp"
+
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace molcpp
+{
+
+/// Names and ids of every key. Names live in a deque, which never moves
+/// them, so that `Key::name` can return references without holding the lock.
+class InternTable
+{
+  public:
+    InternTable()
+    {
+        // same order as the ids in `keys`
+        for (const char *name : {"x", "y", "z", "id", "type", "mass", "charge"})
+        {
+            intern(name);
+        }
+    }
+
+    auto intern(std::string_view name) -> uint32_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _ids.find(name);
+        if (it != _ids.end())
+        {
+            return it->second;
+        }
+        if (_names.size() >= UINT32_MAX)
+        {
+            throw std::runtime_error("Too many interned keys");
+        }
+        auto id = static_cast<uint32_t>(_names.size());
+        const auto &stored = _names.emplace_back(name);
+        _ids.emplace(stored, id);
+        return id;
+    }
+
+    auto name(uint32_t id) -> const std::string &
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (id >= _names.size())
+        {
+            throw std::runtime_error("Invalid key");
+        }
+        return _names[id];
+    }
+
+    auto size() -> size_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _names.size();
+    }
+
+  private:
+    std::mutex _mutex;
+    std::deque<std::string> _names;
+    std::unordered_map<std::string_view, uint32_t> _ids;
+};
+
+static auto table() -> InternTable &
+{
+    static InternTable table;
+    return table;
+}
+
+Key::Key(std::string_view name) : _id(table().intern(name))
+{
+}
+
+auto Key::name() const -> const std::string &
+{
+    return table().name(_id);
+}
+
+auto Key::n_interned() -> size_t
+{
+    return table().size();
+}
+
+} // namespace molcpp
@@ -0,0 +1,277 @@
+#include "molcpp/trajectory.hpp"
+#include "text.hpp"
+
+#include <algorithm>
+
+namespace molcpp
+{
+
+using detail::LineReader;
+using detail::next_token;
+using detail::parse;
+
+static constexpr std::string_view ITEM = "ITEM: ";
+// every frame starts with this line
+static constexpr std::string_view FRAME_START = "\nITEM: TIMESTEP";
+// lines of a frame before the atoms: timestep, number of atoms and box
+static constexpr size_t FRAME_HEADER_LINES = 9;
+
+/// Check that `line` is `ITEM: <name>`, and return the rest of the line
+static auto item(std::string_view line, std::string_view name) -> std::string_view
+{
+    if (!detail::starts_with(line, ITEM) || !detail::starts_with(line.substr(ITEM.size()), name))
+    {
+        throw std::runtime_error("Invalid LAMMPS dump file: expected 'ITEM: " + std::string(name) + "'");
+    }
+    return line.substr(ITEM.size() + name.size());
+}
+
+/// Number of atoms of the frame starting at `begin`
+static auto frame_atoms(const char *begin, const char *end) -> size_t
+{
+    LineReader lines(begin, end);
+    item(lines.next(), "TIMESTEP");
+    lines.next();
+    item(lines.next(), "NUMBER OF ATOMS");
+    auto line = lines.next();
+    return parse<size_t>(next_token(line));
+}
+
+/// Whether the frame starting at `begin` has all its lines before `end`
+static auto is_complete(const char *begin, const char *end) -> bool
+{
+    size_t n_atoms = 0;
+    try
+    {
+        n_atoms = frame_atoms(begin, end);
+    }
+    catch (const std::runtime_error &)
+    {
+        return false;
+    }
+    // a last line without newline may still be being written
+    auto n_lines = static_cast<size_t>(std::count(begin, end, '\n'));
+    return n_lines >= FRAME_HEADER_LINES + n_atoms;
+}
+
+static auto scan_dump(const MappedFile &file, ExecutionPolicy policy) -> std::vector<uint64_t>
+{
+    const std::string_view text(file.data(), file.size());
+    std::vector<uint64_t> offsets;
+    if (text.empty())
+    {
+        return offsets;
+    }
+    item(text.substr(0, text.find('\n')), "TIMESTEP");
+
+    // each task looks for frames whose newline before `ITEM: TIMESTEP` is in
+    // its chunk, reading past the chunk for the rest of the line
+    const size_t n_chunks = (text.size() + detail::SCAN_CHUNK_BYTES - 1) / detail::SCAN_CHUNK_BYTES;
+    std::vector<std::vector<uint64_t>> found(n_chunks);
+    parallel_for(n_chunks, policy.n_threads, [&](size_t chunk, size_t) {
+        const size_t begin = chunk * detail::SCAN_CHUNK_BYTES;
+        auto window = text.substr(begin, detail::SCAN_CHUNK_BYTES + FRAME_START.size() - 1);
+        for (size_t i = window.find(FRAME_START); i != std::string_view::npos; i = window.find(FRAME_START, i + 1))
+        {
+            found[chunk].push_back(begin + i + 1);
+        }
+    });
+
+    offsets.push_back(0);
+    for (const auto &chunk : found)
+    {
+        offsets.insert(offsets.end(), chunk.begin(), chunk.end());
+    }
+    // ignore a last frame which was not completely written, its start then
+    // being the end of the previous frame
+    if (is_complete(file.data() + offsets.back(), file.data() + file.size()))
+    {
+        offsets.push_back(file.size());
+    }
+    return offsets;
+}
+
+LAMMPSDumpTrajectory::LAMMPSDumpTrajectory(const std::string &path, ExecutionPolicy policy)
+    : _file(path), _index(path, _file, [policy](const MappedFile &file) { return scan_dump(file, policy); })
+{
+    if (_index.n_frames() != 0)
+    {
+        _n_atoms = frame_atoms(_file.data() + _index.begin(0), _file.data() + _index.end(0));
+    }
+}
+
+auto LAMMPSDumpTrajectory::get_step(size_t frame) const -> int64_t
+{
+    check_frame(frame);
+    LineReader lines(_file.data() + _index.begin(frame), _file.data() + _index.end(frame));
+    item(lines.next(), "TIMESTEP");
+    auto line = lines.next();
+    return parse<int64_t>(next_token(line));
+}
+
+/// What each column of the atoms is used for
+enum Column : int
+{
+    UNUSED = -1,
+    X = 0,
+    Y = 1,
+    Z = 2,
+    ID = 3
+};
+
+/// Find the position and id columns from the `ITEM: ATOMS` line. Returns
+/// whether positions are scaled.
+static auto find_columns(std::string_view names, std::vector<Column> &columns) -> bool
+{
+    std::vector<std::string_view> tokens;
+    for (auto name = next_token(names); !name.empty(); name = next_token(names))
+    {
+        tokens.push_back(name);
+    }
+    columns.assign(tokens.size(), UNUSED);
+    auto find = [&](std::string_view name) -> size_t {
+        return static_cast<size_t>(std::find(tokens.begin(), tokens.end(), name) - tokens.begin());
+    };
+    if (auto id = find("id"); id < tokens.size())
+    {
+        columns[id] = ID;
+    }
+
+    // unwrapped positions first, which is what time correlations need
+    static constexpr std::array<std::array<std::string_view, 3>, 4> candidates = {{
+        {"xu", "yu", "zu"},
+        {"x", "y", "z"},
+        {"xsu", "ysu", "zsu"},
+        {"xs", "ys", "zs"},
+    }};
+    for (size_t candidate = 0; candidate < candidates.size(); candidate++)
+    {
+        std::array<size_t, 3> found = {};
+        for (size_t d = 0; d < 3; d++)
+        {
+            found[d] = find(candidates[candidate][d]);
+        }
+        if (std::all_of(found.begin(), found.end(), [&](size_t column) { return column < tokens.size(); }))
+        {
+            for (size_t d = 0; d < 3; d++)
+            {
+                columns[found[d]] = static_cast<Column>(d);
+            }
+            return candidate >= 2;
+        }
+    }
+    throw std::runtime_error("Invalid LAMMPS dump file: no position columns");
+}
+
+auto LAMMPSDumpTrajectory::read(size_t frame, double *xyz) const -> Box
+{
+    check_frame(frame);
+    LineReader lines(_file.data() + _index.begin(frame), _file.data() + _index.end(frame));
+    item(lines.next(), "TIMESTEP");
+    lines.next();
+    item(lines.next(), "NUMBER OF ATOMS");
+    auto count = lines.next();
+    if (parse<size_t>(next_token(count)) != _n_atoms)
+    {
+        throw std::runtime_error("Number of atoms changed in LAMMPS dump frame " + std::to_string(frame));
+    }
+
+    auto flags = item(lines.next(), "BOX BOUNDS");
+    bool triclinic = false;
+    for (auto flag = next_token(flags); !flag.empty(); flag = next_token(flags))
+    {
+        if (flag == "abc")
+        {
+            throw std::runtime_error("LAMMPS dump files with general triclinic boxes are not supported");
+        }
+        triclinic = triclinic || flag == "xy";
+    }
+    // bounds are lo, hi and the xy, xz and yz tilts for triclinic boxes
+    std::array<double, 3> lo = {};
+    std::array<double, 3> hi = {};
+    std::array<double, 3> tilts = {};
+    for (size_t d = 0; d < 3; d++)
+    {
+        auto line = lines.next();
+        lo[d] = parse<double>(next_token(line));
+        hi[d] = parse<double>(next_token(line));
+        if (triclinic)
+        {
+            tilts[d] = parse<double>(next_token(line));
+        }
+    }
+    const double xy = tilts[0];
+    const double xz = tilts[1];
+    const double yz = tilts[2];
+    // triclinic bounds enclose the whole tilted box
+    lo[0] -= std::min({0.0, xy, xz, xy + xz});
+    hi[0] -= std::max({0.0, xy, xz, xy + xz});
+    lo[1] -= std::min(0.0, yz);
+    hi[1] -= std::max(0.0, yz);
+    Box box;
+    box.set_lengths_tilts({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]}, {xy, xz, yz});
+
+    std::vector<Column> columns;
+    const bool scaled = find_columns(item(lines.next(), "ATOMS"), columns);
+    const bool has_id = std::find(columns.begin(), columns.end(), ID) != columns.end();
+    // only read up to the last column we need
+    while (columns.back() == UNUSED)
+    {
+        columns.pop_back();
+    }
+
+    // put atom `id` in row `id - 1`, returning false if ids are not a
+    // permutation of 1..n_atoms
+    std::vector<char> seen;
+    auto parse_atoms = [&](LineReader atoms, bool by_id) -> bool {
+        seen.assign(by_id ? _n_atoms : 0, 0);
+        for (size_t i = 0; i < _n_atoms; i++)
+        {
+            auto line = atoms.next();
+            std::array<double, 3> values = {};
+            int64_t id = 0;
+            for (auto column : columns)
+            {
+                auto token = next_token(line);
+                if (column == ID)
+                {
+                    id = parse<int64_t>(token);
+                }
+                else if (column != UNUSED)
+                {
+                    values[static_cast<size_t>(column)] = parse<double>(token);
+                }
+            }
+
+            size_t row = i;
+            if (by_id)
+            {
+                if (id < 1 || static_cast<uint64_t>(id) > _n_atoms || seen[static_cast<size_t>(id - 1)])
+                {
+                    return false;
+                }
+                row = static_cast<size_t>(id - 1);
+                seen[row] = 1;
+            }
+            double *position = xyz + 3 * row;
+            if (scaled)
+            {
+                position[0] = lo[0] + (hi[0] - lo[0]) * values[0] + xy * values[1] + xz * values[2];
+                position[1] = lo[1] + (hi[1] - lo[1]) * values[1] + yz * values[2];
+                position[2] = lo[2] + (hi[2] - lo[2]) * values[2];
+            }
+            else
+            {
+                std::copy(values.begin(), values.end(), position);
+            }
+        }
+        return true;
+    };
+    if (!parse_atoms(lines, has_id))
+    {
+        parse_atoms(lines, false);
+    }
+    return box;
+}
+
+} // namespace molcpp
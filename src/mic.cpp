@@ -0,0 +1,328 @@
+#include "mic.hpp"
+#include "molcpp/simd.hpp"
+
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define MOLCPP_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace molcpp::detail
+{
+
+// All paths round half to even (the default rounding mode), so the scalar and
+// vector kernels pick the same image and only differ by FMA contraction.
+
+template <typename T, MicCell::Kind K, bool D, bool R2>
+static void mic_scalar(const MicCell &cell, const T *xi, const T *yi, const T *zi, const T *xj, const T *yj,
+                       const T *zj, size_t begin, size_t end, T *dx, T *dy, T *dz, T *r2)
+{
+    const double *h = cell.h;
+    const double *inv = cell.inv;
+    for (size_t k = begin; k < end; k++)
+    {
+        double x = static_cast<double>(xj[k]) - static_cast<double>(xi[k]);
+        double y = static_cast<double>(yj[k]) - static_cast<double>(yi[k]);
+        double z = static_cast<double>(zj[k]) - static_cast<double>(zi[k]);
+        if constexpr (K == MicCell::ORTHOGONAL)
+        {
+            x -= h[0] * std::nearbyint(x * inv[0]);
+            y -= h[3] * std::nearbyint(y * inv[3]);
+            z -= h[5] * std::nearbyint(z * inv[5]);
+        }
+        else if constexpr (K == MicCell::TRICLINIC)
+        {
+            double s0 = inv[0] * x + inv[1] * y + inv[2] * z;
+            double s1 = inv[3] * y + inv[4] * z;
+            double s2 = inv[5] * z;
+            s0 -= std::nearbyint(s0);
+            s1 -= std::nearbyint(s1);
+            s2 -= std::nearbyint(s2);
+            x = h[0] * s0 + h[1] * s1 + h[2] * s2;
+            y = h[3] * s1 + h[4] * s2;
+            z = h[5] * s2;
+        }
+        if constexpr (D)
+        {
+            dx[k] = static_cast<T>(x);
+            dy[k] = static_cast<T>(y);
+            dz[k] = static_cast<T>(z);
+        }
+        if constexpr (R2)
+        {
+            r2[k] = static_cast<T>(x * x + y * y + z * z);
+        }
+    }
+}
+
+#ifdef MOLCPP_X86_SIMD
+
+#define MOLCPP_MIC_ROUND (_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+
+// Loads and stores of 4 or 8 values, computed in double precision whatever
+// the storage type: float positions are widened in registers, so that they
+// take half the memory bandwidth without losing precision on the images.
+__attribute__((target("avx2,fma"))) static inline __m256d load4(const double *p)
+{
+    return _mm256_loadu_pd(p);
+}
+
+__attribute__((target("avx2,fma"))) static inline __m256d load4(const float *p)
+{
+    return _mm256_cvtps_pd(_mm_loadu_ps(p));
+}
+
+__attribute__((target("avx2,fma"))) static inline void store4(double *p, __m256d v)
+{
+    _mm256_storeu_pd(p, v);
+}
+
+__attribute__((target("avx2,fma"))) static inline void store4(float *p, __m256d v)
+{
+    _mm_storeu_ps(p, _mm256_cvtpd_ps(v));
+}
+
+template <typename T, MicCell::Kind K, bool D, bool R2>
+__attribute__((target("avx2,fma"))) static void mic_avx2(const MicCell &cell, const T *xi, const T *yi,
+                                                         const T *zi, const T *xj, const T *yj, const T *zj,
+                                                         size_t n, T *dx, T *dy, T *dz, T *r2)
+{
+    const __m256d h0 = _mm256_set1_pd(cell.h[0]), h1 = _mm256_set1_pd(cell.h[1]), h2 = _mm256_set1_pd(cell.h[2]);
+    const __m256d h3 = _mm256_set1_pd(cell.h[3]), h4 = _mm256_set1_pd(cell.h[4]), h5 = _mm256_set1_pd(cell.h[5]);
+    const __m256d i0 = _mm256_set1_pd(cell.inv[0]), i1 = _mm256_set1_pd(cell.inv[1]);
+    const __m256d i2 = _mm256_set1_pd(cell.inv[2]), i3 = _mm256_set1_pd(cell.inv[3]);
+    const __m256d i4 = _mm256_set1_pd(cell.inv[4]), i5 = _mm256_set1_pd(cell.inv[5]);
+
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        __m256d x = _mm256_sub_pd(load4(xj + k), load4(xi + k));
+        __m256d y = _mm256_sub_pd(load4(yj + k), load4(yi + k));
+        __m256d z = _mm256_sub_pd(load4(zj + k), load4(zi + k));
+        if constexpr (K == MicCell::ORTHOGONAL)
+        {
+            x = _mm256_fnmadd_pd(h0, _mm256_round_pd(_mm256_mul_pd(x, i0), MOLCPP_MIC_ROUND), x);
+            y = _mm256_fnmadd_pd(h3, _mm256_round_pd(_mm256_mul_pd(y, i3), MOLCPP_MIC_ROUND), y);
+            z = _mm256_fnmadd_pd(h5, _mm256_round_pd(_mm256_mul_pd(z, i5), MOLCPP_MIC_ROUND), z);
+        }
+        else if constexpr (K == MicCell::TRICLINIC)
+        {
+            __m256d s0 = _mm256_fmadd_pd(i0, x, _mm256_fmadd_pd(i1, y, _mm256_mul_pd(i2, z)));
+            __m256d s1 = _mm256_fmadd_pd(i3, y, _mm256_mul_pd(i4, z));
+            __m256d s2 = _mm256_mul_pd(i5, z);
+            s0 = _mm256_sub_pd(s0, _mm256_round_pd(s0, MOLCPP_MIC_ROUND));
+            s1 = _mm256_sub_pd(s1, _mm256_round_pd(s1, MOLCPP_MIC_ROUND));
+            s2 = _mm256_sub_pd(s2, _mm256_round_pd(s2, MOLCPP_MIC_ROUND));
+            x = _mm256_fmadd_pd(h0, s0, _mm256_fmadd_pd(h1, s1, _mm256_mul_pd(h2, s2)));
+            y = _mm256_fmadd_pd(h3, s1, _mm256_mul_pd(h4, s2));
+            z = _mm256_mul_pd(h5, s2);
+        }
+        if constexpr (D)
+        {
+            store4(dx + k, x);
+            store4(dy + k, y);
+            store4(dz + k, z);
+        }
+        if constexpr (R2)
+        {
+            store4(r2 + k, _mm256_fmadd_pd(x, x, _mm256_fmadd_pd(y, y, _mm256_mul_pd(z, z))));
+        }
+    }
+    mic_scalar<T, K, D, R2>(cell, xi, yi, zi, xj, yj, zj, k, n, dx, dy, dz, r2);
+}
+
+// the masked form avoids reading an undefined source register
+__attribute__((target("avx512f"))) static inline __m512d round512(__m512d a)
+{
+    return _mm512_mask_roundscale_pd(a, 0xFF, a, MOLCPP_MIC_ROUND);
+}
+
+__attribute__((target("avx512f"))) static inline __m512d load8(const double *p)
+{
+    return _mm512_loadu_pd(p);
+}
+
+__attribute__((target("avx512f"))) static inline __m512d load8(const float *p)
+{
+    return _mm512_cvtps_pd(_mm256_loadu_ps(p));
+}
+
+__attribute__((target("avx512f"))) static inline void store8(double *p, __m512d v)
+{
+    _mm512_storeu_pd(p, v);
+}
+
+__attribute__((target("avx512f"))) static inline void store8(float *p, __m512d v)
+{
+    _mm256_storeu_ps(p, _mm512_cvtpd_ps(v));
+}
+
+template <typename T, MicCell::Kind K, bool D, bool R2>
+__attribute__((target("avx512f"))) static void mic_avx512(const MicCell &cell, const T *xi, const T *yi,
+                                                          const T *zi, const T *xj, const T *yj, const T *zj,
+                                                          size_t n, T *dx, T *dy, T *dz, T *r2)
+{
+    const __m512d h0 = _mm512_set1_pd(cell.h[0]), h1 = _mm512_set1_pd(cell.h[1]), h2 = _mm512_set1_pd(cell.h[2]);
+    const __m512d h3 = _mm512_set1_pd(cell.h[3]), h4 = _mm512_set1_pd(cell.h[4]), h5 = _mm512_set1_pd(cell.h[5]);
+    const __m512d i0 = _mm512_set1_pd(cell.inv[0]), i1 = _mm512_set1_pd(cell.inv[1]);
+    const __m512d i2 = _mm512_set1_pd(cell.inv[2]), i3 = _mm512_set1_pd(cell.inv[3]);
+    const __m512d i4 = _mm512_set1_pd(cell.inv[4]), i5 = _mm512_set1_pd(cell.inv[5]);
+
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        __m512d x = _mm512_sub_pd(load8(xj + k), load8(xi + k));
+        __m512d y = _mm512_sub_pd(load8(yj + k), load8(yi + k));
+        __m512d z = _mm512_sub_pd(load8(zj + k), load8(zi + k));
+        if constexpr (K == MicCell::ORTHOGONAL)
+        {
+            x = _mm512_fnmadd_pd(h0, round512(_mm512_mul_pd(x, i0)), x);
+            y = _mm512_fnmadd_pd(h3, round512(_mm512_mul_pd(y, i3)), y);
+            z = _mm512_fnmadd_pd(h5, round512(_mm512_mul_pd(z, i5)), z);
+        }
+        else if constexpr (K == MicCell::TRICLINIC)
+        {
+            __m512d s0 = _mm512_fmadd_pd(i0, x, _mm512_fmadd_pd(i1, y, _mm512_mul_pd(i2, z)));
+            __m512d s1 = _mm512_fmadd_pd(i3, y, _mm512_mul_pd(i4, z));
+            __m512d s2 = _mm512_mul_pd(i5, z);
+            s0 = _mm512_sub_pd(s0, round512(s0));
+            s1 = _mm512_sub_pd(s1, round512(s1));
+            s2 = _mm512_sub_pd(s2, round512(s2));
+            x = _mm512_fmadd_pd(h0, s0, _mm512_fmadd_pd(h1, s1, _mm512_mul_pd(h2, s2)));
+            y = _mm512_fmadd_pd(h3, s1, _mm512_mul_pd(h4, s2));
+            z = _mm512_mul_pd(h5, s2);
+        }
+        if constexpr (D)
+        {
+            store8(dx + k, x);
+            store8(dy + k, y);
+            store8(dz + k, z);
+        }
+        if constexpr (R2)
+        {
+            store8(r2 + k, _mm512_fmadd_pd(x, x, _mm512_fmadd_pd(y, y, _mm512_mul_pd(z, z))));
+        }
+    }
+    mic_scalar<T, K, D, R2>(cell, xi, yi, zi, xj, yj, zj, k, n, dx, dy, dz, r2);
+}
+
+#endif // MOLCPP_X86_SIMD
+
+template <typename T, MicCell::Kind K, bool D, bool R2>
+static void mic_dispatch_isa(const MicCell &cell, const T *xi, const T *yi, const T *zi, const T *xj,
+                             const T *yj, const T *zj, size_t n, T *dx, T *dy, T *dz, T *r2)
+{
+#ifdef MOLCPP_X86_SIMD
+    switch (get_simd_level())
+    {
+    case SimdLevel::AVX512:
+        return mic_avx512<T, K, D, R2>(cell, xi, yi, zi, xj, yj, zj, n, dx, dy, dz, r2);
+    case SimdLevel::AVX2:
+        return mic_avx2<T, K, D, R2>(cell, xi, yi, zi, xj, yj, zj, n, dx, dy, dz, r2);
+    default:
+        break;
+    }
+#endif
+    mic_scalar<T, K, D, R2>(cell, xi, yi, zi, xj, yj, zj, 0, n, dx, dy, dz, r2);
+}
+
+template <typename T, MicCell::Kind K>
+static void mic_dispatch_outputs(const MicCell &cell, const T *xi, const T *yi, const T *zi, const T *xj,
+                                 const T *yj, const T *zj, size_t n, T *dx, T *dy, T *dz, T *r2)
+{
+    bool d = dx != nullptr;
+    bool r = r2 != nullptr;
+    if (d && r)
+    {
+        mic_dispatch_isa<T, K, true, true>(cell, xi, yi, zi, xj, yj, zj, n, dx, dy, dz, r2);
+    }
+    else if (d)
+    {
+        mic_dispatch_isa<T, K, true, false>(cell, xi, yi, zi, xj, yj, zj, n, dx, dy, dz, r2);
+    }
+    else if (r)
+    {
+        mic_dispatch_isa<T, K, false, true>(cell, xi, yi, zi, xj, yj, zj, n, dx, dy, dz, r2);
+    }
+}
+
+template <typename T>
+static void mic_batch_impl(const MicCell &cell, const T *xi, const T *yi, const T *zi, const T *xj, const T *yj,
+                           const T *zj, size_t n, T *dx, T *dy, T *dz, T *r2)
+{
+    switch (cell.kind)
+    {
+    case MicCell::FREE:
+        return mic_dispatch_outputs<T, MicCell::FREE>(cell, xi, yi, zi, xj, yj, zj, n, dx, dy, dz, r2);
+    case MicCell::ORTHOGONAL:
+        return mic_dispatch_outputs<T, MicCell::ORTHOGONAL>(cell, xi, yi, zi, xj, yj, zj, n, dx, dy, dz, r2);
+    case MicCell::TRICLINIC:
+        return mic_dispatch_outputs<T, MicCell::TRICLINIC>(cell, xi, yi, zi, xj, yj, zj, n, dx, dy, dz, r2);
+    }
+}
+
+void mic_batch(const MicCell &cell, const double *xi, const double *yi, const double *zi, const double *xj,
+               const double *yj, const double *zj, size_t n, double *dx, double *dy, double *dz, double *r2)
+{
+    mic_batch_impl(cell, xi, yi, zi, xj, yj, zj, n, dx, dy, dz, r2);
+}
+
+void mic_batch(const MicCell &cell, const float *xi, const float *yi, const float *zi, const float *xj,
+               const float *yj, const float *zj, size_t n, float *dx, float *dy, float *dz, float *r2)
+{
+    mic_batch_impl(cell, xi, yi, zi, xj, yj, zj, n, dx, dy, dz, r2);
+}
+
+// Positions are wrapped to fractional coordinates in [-0.5, 0.5) by
+// subtracting floor(s + 0.5): unlike the round half to even of the minimum
+// image kernels, a point on a face always goes to the same face, whatever
+// the parity of its image.
+template <typename T> static void wrap_positions_impl(const MicCell &cell, T *xyz, size_t n)
+{
+    const double *h = cell.h;
+    const double *inv = cell.inv;
+    switch (cell.kind)
+    {
+    case MicCell::FREE:
+        return;
+    case MicCell::ORTHOGONAL:
+        for (size_t i = 0; i < n; i++)
+        {
+            T *r = xyz + 3 * i;
+            const double x = r[0], y = r[1], z = r[2];
+            r[0] = static_cast<T>(x - h[0] * std::floor(x * inv[0] + 0.5));
+            r[1] = static_cast<T>(y - h[3] * std::floor(y * inv[3] + 0.5));
+            r[2] = static_cast<T>(z - h[5] * std::floor(z * inv[5] + 0.5));
+        }
+        return;
+    case MicCell::TRICLINIC:
+        for (size_t i = 0; i < n; i++)
+        {
+            T *r = xyz + 3 * i;
+            const double x = r[0], y = r[1], z = r[2];
+            double s0 = inv[0] * x + inv[1] * y + inv[2] * z;
+            double s1 = inv[3] * y + inv[4] * z;
+            double s2 = inv[5] * z;
+            s0 -= std::floor(s0 + 0.5);
+            s1 -= std::floor(s1 + 0.5);
+            s2 -= std::floor(s2 + 0.5);
+            r[0] = static_cast<T>(h[0] * s0 + h[1] * s1 + h[2] * s2);
+            r[1] = static_cast<T>(h[3] * s1 + h[4] * s2);
+            r[2] = static_cast<T>(h[5] * s2);
+        }
+        return;
+    }
+}
+
+void wrap_positions(const MicCell &cell, double *xyz, size_t n)
+{
+    wrap_positions_impl(cell, xyz, n);
+}
+
+void wrap_positions(const MicCell &cell, float *xyz, size_t n)
+{
+    wrap_positions_impl(cell, xyz, n);
+}
+
+} // namespace molcpp::detail
@@ -0,0 +1,44 @@
+#ifndef MOLCPP_SRC_MIC_HPP
+#define MOLCPP_SRC_MIC_HPP
+
+#include <cstddef>
+
+// Internal minimum-image kernels shared by `Box` and the neighbor search.
+// Kept free of xtensor so that they only deal with raw SoA buffers.
+
+namespace molcpp::detail
+{
+
+/// Upper-triangular cell matrix `h` and its inverse, stored as
+/// `{xx, xy, xz, yy, yz, zz}`
+struct MicCell
+{
+    enum Kind
+    {
+        FREE,
+        ORTHOGONAL,
+        TRICLINIC
+    };
+    Kind kind = FREE;
+    double h[6] = {0, 0, 0, 0, 0, 0};
+    double inv[6] = {0, 0, 0, 0, 0, 0};
+};
+
+/// Compute `d = mic(r_j - r_i)` for `n` pairs of SoA positions. Any of
+/// `dx, dy, dz` (all or none) and `r2` may be null to skip that output.
+void mic_batch(const MicCell &cell, const double *xi, const double *yi, const double *zi, const double *xj,
+               const double *yj, const double *zj, size_t n, double *dx, double *dy, double *dz, double *r2);
+
+/// Same with float storage. Images are still found in double precision, and
+/// only the outputs are rounded to float.
+void mic_batch(const MicCell &cell, const float *xi, const float *yi, const float *zi, const float *xj,
+               const float *yj, const float *zj, size_t n, float *dx, float *dy, float *dz, float *r2);
+
+/// Wrap `n` positions of a contiguous (n, 3) buffer in place, to fractional
+/// coordinates in [-0.5, 0.5). Positions are left untouched in a free cell.
+void wrap_positions(const MicCell &cell, double *xyz, size_t n);
+
+void wrap_positions(const MicCell &cell, float *xyz, size_t n);
+
+} // namespace molcpp::detail
+#endif // MOLCPP_SRC_MIC_HPP
@@ -0,0 +1,541 @@
+#include "molcpp/neighbor.hpp"
+#include "molcpp/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace molcpp
+{
+
+CellList::CellList(double cutoff, bool full, bool with_distances)
+    : _cutoff(cutoff), _full(full), _with_distances(with_distances)
+{
+    if (!(cutoff > 0))
+    {
+        throw std::runtime_error("Cutoff must be > 0");
+    }
+}
+
+template <typename T> void CellList::bin(const T *xyz, size_t n, const Box &box)
+{
+    if (n > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("Too many atoms for a neighbor list");
+    }
+
+    // extent of the binned coordinates along each axis
+    std::array<double, 3> extent = {1, 1, 1};
+    _coords.resize(3 * n);
+    if (box.get_style() == Box::FREE)
+    {
+        std::array<double, 3> lo = {0, 0, 0}, hi = {0, 0, 0};
+        if (n > 0)
+        {
+            for (size_t d = 0; d < 3; d++)
+            {
+                lo[d] = hi[d] = xyz[d];
+            }
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t d = 0; d < 3; d++)
+            {
+                lo[d] = std::min(lo[d], static_cast<double>(xyz[3 * i + d]));
+                hi[d] = std::max(hi[d], static_cast<double>(xyz[3 * i + d]));
+            }
+        }
+        for (size_t d = 0; d < 3; d++)
+        {
+            extent[d] = hi[d] - lo[d];
+            _grid[d] = std::max<size_t>(1, static_cast<size_t>(extent[d] / _cutoff));
+        }
+        parallel_ranges(n, n_tasks(), _n_threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                for (size_t d = 0; d < 3; d++)
+                {
+                    _coords[3 * i + d] = static_cast<double>(xyz[3 * i + d]) - lo[d];
+                }
+            }
+        });
+        _periodic = {false, false, false};
+    }
+    else
+    {
+        auto faces = box.get_distance_between_faces();
+        if (2 * _cutoff > std::min({faces(0), faces(1), faces(2)}))
+        {
+            throw std::runtime_error("Cutoff must be at most half the distance between box faces");
+        }
+        for (size_t d = 0; d < 3; d++)
+        {
+            _grid[d] = std::max<size_t>(1, static_cast<size_t>(faces(d) / _cutoff));
+        }
+
+        // fractional coordinates in [0, 1)
+        auto inv = box.get_inv();
+        const double i00 = inv(0, 0), i01 = inv(0, 1), i02 = inv(0, 2);
+        const double i11 = inv(1, 1), i12 = inv(1, 2), i22 = inv(2, 2);
+        parallel_ranges(n, n_tasks(), _n_threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                const double r[3] = {static_cast<double>(xyz[3 * i]), static_cast<double>(xyz[3 * i + 1]),
+                                     static_cast<double>(xyz[3 * i + 2])};
+                double s[3] = {i00 * r[0] + i01 * r[1] + i02 * r[2], i11 * r[1] + i12 * r[2], i22 * r[2]};
+                for (size_t d = 0; d < 3; d++)
+                {
+                    s[d] -= std::floor(s[d]);
+                    // `s - floor(s)` can round up to exactly 1 for tiny negative s
+                    _coords[3 * i + d] = s[d] < 1.0 ? s[d] : 0.0;
+                }
+            }
+        });
+        _periodic = {true, true, true};
+    }
+
+    // sparse systems (or a FREE box around scattered atoms) would create
+    // many more cells than atoms: merge cells, they only need to be at
+    // least `cutoff` wide.
+    double n_cells = static_cast<double>(_grid[0]) * static_cast<double>(_grid[1]) * static_cast<double>(_grid[2]);
+    double max_cells = 2.0 * static_cast<double>(n) + 27.0;
+    if (n_cells > max_cells)
+    {
+        double shrink = std::cbrt(n_cells / max_cells);
+        for (size_t d = 0; d < 3; d++)
+        {
+            _grid[d] = std::max<size_t>(1, static_cast<size_t>(static_cast<double>(_grid[d]) / shrink));
+        }
+    }
+    // cell index along an axis is `floor(coord * scale)`
+    std::array<double, 3> scale = {0, 0, 0};
+    for (size_t d = 0; d < 3; d++)
+    {
+        scale[d] = extent[d] > 0 ? static_cast<double>(_grid[d]) / extent[d] : 0;
+    }
+
+    // counting sort of atoms by cell. With several threads, cells are
+    // counted and filled with atomic increments, and the atoms of each cell
+    // are sorted afterwards, to get the order of the serial sort.
+    const bool serial = n_tasks() == 1;
+    size_t total = _grid[0] * _grid[1] * _grid[2];
+    _cell_of.resize(n);
+    _cell_start.assign(total + 1, 0);
+    parallel_ranges(n, n_tasks(), _n_threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            size_t c[3];
+            for (size_t d = 0; d < 3; d++)
+            {
+                c[d] = std::min(_grid[d] - 1, static_cast<size_t>(_coords[3 * i + d] * scale[d]));
+            }
+            const size_t cell = (c[0] * _grid[1] + c[1]) * _grid[2] + c[2];
+            _cell_of[i] = static_cast<uint32_t>(cell);
+            if (serial)
+            {
+                _cell_start[cell + 1]++;
+            }
+            else
+            {
+                std::atomic_ref<size_t>(_cell_start[cell + 1]).fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+    prefix_sum(_cell_start.data() + 1, total);
+
+    _sorted.resize(n);
+    _sorted_coords.resize(3 * n);
+    std::vector<size_t> cursor(_cell_start.begin(), _cell_start.end() - 1);
+    if (serial)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            _sorted[cursor[_cell_of[i]]++] = static_cast<uint32_t>(i);
+        }
+    }
+    else
+    {
+        parallel_ranges(n, n_tasks(), _n_threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto k = std::atomic_ref<size_t>(cursor[_cell_of[i]]).fetch_add(1, std::memory_order_relaxed);
+                _sorted[k] = static_cast<uint32_t>(i);
+            }
+        });
+        parallel_ranges(total, n_tasks(), _n_threads, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++)
+            {
+                std::sort(_sorted.begin() + static_cast<long>(_cell_start[c]),
+                          _sorted.begin() + static_cast<long>(_cell_start[c + 1]));
+            }
+        });
+    }
+    parallel_ranges(n, n_tasks(), _n_threads, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++)
+        {
+            std::copy_n(&_coords[3 * size_t{_sorted[k]}], 3, &_sorted_coords[3 * k]);
+        }
+    });
+}
+
+void CellList::prefix_sum(size_t *values, size_t n) const
+{
+    // inclusive scan of contiguous blocks, each shifted by the sum of the
+    // blocks before it
+    const size_t n_blocks = std::max<size_t>(1, std::min(n, n_tasks()));
+    std::vector<size_t> block_sums(n_blocks + 1, 0);
+    parallel_for(n_blocks, _n_threads, [&](size_t block, size_t) {
+        size_t sum = 0;
+        for (size_t i = n * block / n_blocks; i < n * (block + 1) / n_blocks; i++)
+        {
+            sum += values[i];
+            values[i] = sum;
+        }
+        block_sums[block + 1] = sum;
+    });
+    if (n_blocks == 1)
+    {
+        return;
+    }
+    for (size_t block = 0; block < n_blocks; block++)
+    {
+        block_sums[block + 1] += block_sums[block];
+    }
+    parallel_for(n_blocks, _n_threads, [&](size_t block, size_t) {
+        for (size_t i = n * block / n_blocks; i < n * (block + 1) / n_blocks; i++)
+        {
+            values[i] += block_sums[block];
+        }
+    });
+}
+
+auto CellList::build(const double *xyz, size_t n, const Box &box) -> NeighborList
+{
+    NeighborList list;
+    build(xyz, n, box, list);
+    return list;
+}
+
+auto CellList::build(const xt::xarray<double> &xyz, const Box &box) -> NeighborList
+{
+    if (xyz.dimension() != 2 || xyz.shape(1) != 3)
+    {
+        throw std::runtime_error("Positions must have shape (n, 3)");
+    }
+    return build(xyz.data(), xyz.shape(0), box);
+}
+
+void CellList::build(const double *xyz, size_t n, const Box &box, NeighborList &list)
+{
+    bin(xyz, n, box);
+    search_binned(box, list);
+}
+
+auto CellList::build(const float *xyz, size_t n, const Box &box) -> NeighborList
+{
+    NeighborList list;
+    build(xyz, n, box, list);
+    return list;
+}
+
+void CellList::build(const float *xyz, size_t n, const Box &box, NeighborList &list)
+{
+    bin(xyz, n, box);
+    search_binned(box, list);
+}
+
+void CellList::search_binned(const Box &box, NeighborList &list)
+{
+    switch (box.get_style())
+    {
+    case Box::FREE:
+        return search<Box::FREE>(box, list);
+    case Box::ORTHOGONAL:
+        return search<Box::ORTHOGONAL>(box, list);
+    case Box::TRICLINIC:
+        return search<Box::TRICLINIC>(box, list);
+    default:
+        throw std::runtime_error("Invalid Style");
+    }
+}
+
+template <Box::Style S> void CellList::search(const Box &box, NeighborList &list)
+{
+    // Atoms are visited in cell order, which keeps the 27 searched cells hot
+    // in cache, and the pairs are then moved to atom order. Threads take
+    // chunks of whole cells from a shared queue, and each chunk has its own
+    // output buffer, so no locking is needed.
+    const size_t n = _sorted.size();
+    const size_t n_chunks = std::max<size_t>(1, std::min(n, n_tasks()));
+    _chunk_start.resize(n_chunks + 1);
+    for (size_t c = 0; c < n_chunks; c++)
+    {
+        size_t target = n * c / n_chunks;
+        _chunk_start[c] = target < n ? _cell_start[_cell_of[_sorted[target]]] : n;
+    }
+    _chunk_start[n_chunks] = n;
+
+    _chunks.resize(n_chunks);
+    parallel_for(n_chunks, _n_threads, [&](size_t c, size_t) {
+        _chunks[c].counts.resize(_chunk_start[c + 1] - _chunk_start[c]);
+        search_range<S>(box, _chunk_start[c], _chunk_start[c + 1], _chunks[c]);
+    });
+    merge(list);
+}
+
+template <Box::Style S> void CellList::search_range(const Box &box, size_t begin, size_t end, Chunk &chunk) const
+{
+    const double cutoff2 = _cutoff * _cutoff;
+    auto h = box.get_matrix();
+    const double h00 = h(0, 0), h01 = h(0, 1), h02 = h(0, 2);
+    const double h11 = h(1, 1), h12 = h(1, 2), h22 = h(2, 2);
+
+    // With at least 3 cells along every periodic axis, each neighbor cell is
+    // reached through a single periodic image, known from the stencil, and no
+    // rounding is needed. Otherwise several offsets map to the same cell, it
+    // is visited once and the image is found by rounding.
+    const bool use_shifts = _grid[0] >= 3 && _grid[1] >= 3 && _grid[2] >= 3;
+
+    // candidates are written unconditionally and kept by advancing `count`,
+    // which avoids a hard to predict branch in the inner loop
+    size_t count = 0;
+    auto reserve = [&](size_t extra) {
+        if (count + extra > chunk.indices.size())
+        {
+            size_t size = std::max(2 * chunk.indices.size(), count + extra);
+            chunk.indices.resize(size);
+            if (_with_distances)
+            {
+                chunk.distances.resize(size);
+            }
+        }
+    };
+
+    std::array<uint32_t, 27> stencil;
+    std::array<std::array<double, 3>, 27> shifts;
+    size_t n_stencil = 0;
+    size_t stencil_cell = std::numeric_limits<size_t>::max();
+    for (size_t ki = begin; ki < end; ki++)
+    {
+        const uint32_t i = _sorted[ki];
+        const size_t cell = _cell_of[i];
+        if (cell != stencil_cell)
+        {
+            stencil_cell = cell;
+            n_stencil = 0;
+            long c[3] = {static_cast<long>(cell / (_grid[1] * _grid[2])),
+                         static_cast<long>((cell / _grid[2]) % _grid[1]), static_cast<long>(cell % _grid[2])};
+            for (long dx = -1; dx <= 1; dx++)
+            {
+                for (long dy = -1; dy <= 1; dy++)
+                {
+                    for (long dz = -1; dz <= 1; dz++)
+                    {
+                        long o[3] = {c[0] + dx, c[1] + dy, c[2] + dz};
+                        std::array<double, 3> shift = {0, 0, 0};
+                        bool valid = true;
+                        for (size_t d = 0; d < 3; d++)
+                        {
+                            auto g = static_cast<long>(_grid[d]);
+                            if (o[d] < 0 || o[d] >= g)
+                            {
+                                valid = valid && _periodic[d];
+                                shift[d] = o[d] < 0 ? -1.0 : 1.0;
+                                o[d] = (o[d] + g) % g;
+                            }
+                        }
+                        if (!valid)
+                        {
+                            continue;
+                        }
+                        auto other = static_cast<uint32_t>((o[0] * _grid[1] + o[1]) * _grid[2] + o[2]);
+                        if (use_shifts || std::find(stencil.begin(), stencil.begin() + n_stencil, other) ==
+                                              stencil.begin() + n_stencil)
+                        {
+                            shifts[n_stencil] = shift;
+                            stencil[n_stencil++] = other;
+                        }
+                    }
+                }
+            }
+        }
+
+        const size_t first = count;
+        const double *ui = &_sorted_coords[3 * ki];
+        for (size_t s = 0; s < n_stencil; s++)
+        {
+            const double sx = shifts[s][0] - ui[0];
+            const double sy = shifts[s][1] - ui[1];
+            const double sz = shifts[s][2] - ui[2];
+            const size_t kbegin = _cell_start[stencil[s]];
+            const size_t kend = _cell_start[stencil[s] + 1];
+            reserve(kend - kbegin);
+            uint32_t *indices = chunk.indices.data();
+            double *distances = chunk.distances.data();
+            for (size_t k = kbegin; k < kend; k++)
+            {
+                uint32_t j = _sorted[k];
+                const double *uj = &_sorted_coords[3 * k];
+                double x = uj[0] + sx;
+                double y = uj[1] + sy;
+                double z = uj[2] + sz;
+                if constexpr (S != Box::FREE)
+                {
+                    if (!use_shifts)
+                    {
+                        x -= std::nearbyint(x);
+                        y -= std::nearbyint(y);
+                        z -= std::nearbyint(z);
+                    }
+                }
+                if constexpr (S == Box::ORTHOGONAL)
+                {
+                    x *= h00;
+                    y *= h11;
+                    z *= h22;
+                }
+                else if constexpr (S == Box::TRICLINIC)
+                {
+                    x = h00 * x + h01 * y + h02 * z;
+                    y = h11 * y + h12 * z;
+                    z = h22 * z;
+                }
+                double r2 = x * x + y * y + z * z;
+                bool keep = (r2 <= cutoff2) & (_full ? j != i : j > i);
+                indices[count] = j;
+                if (_with_distances)
+                {
+                    distances[count] = std::sqrt(r2);
+                }
+                count += keep;
+            }
+        }
+        chunk.counts[ki - begin] = static_cast<uint32_t>(count - first);
+    }
+    chunk.indices.resize(count);
+    chunk.distances.resize(_with_distances ? count : 0);
+}
+
+void CellList::merge(NeighborList &list) const
+{
+    const size_t n = _sorted.size();
+    list.offsets.assign(n + 1, 0);
+    size_t k = 0;
+    for (const auto &chunk : _chunks)
+    {
+        for (auto count : chunk.counts)
+        {
+            list.offsets[_sorted[k++] + 1] = count;
+        }
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        list.offsets[i + 1] += list.offsets[i];
+    }
+
+    list.indices.resize(list.offsets[n]);
+    list.distances.resize(_with_distances ? list.offsets[n] : 0);
+    parallel_for(_chunks.size(), _n_threads, [&](size_t c, size_t) {
+        const auto &chunk = _chunks[c];
+        size_t k = _chunk_start[c];
+        size_t from = 0;
+        for (auto count : chunk.counts)
+        {
+            size_t to = list.offsets[_sorted[k++]];
+            std::copy_n(chunk.indices.data() + from, count, list.indices.data() + to);
+            if (_with_distances)
+            {
+                std::copy_n(chunk.distances.data() + from, count, list.distances.data() + to);
+            }
+            from += count;
+        }
+    });
+}
+
+VerletList::VerletList(double cutoff, double skin, bool full)
+    : _cutoff(cutoff), _skin(skin), _cells(cutoff + skin, full, true)
+{
+    if (!(cutoff > 0))
+    {
+        throw std::runtime_error("Cutoff must be > 0");
+    }
+    if (!(skin >= 0))
+    {
+        throw std::runtime_error("Skin must be >= 0");
+    }
+}
+
+auto VerletList::update(const xt::xarray<double> &xyz, const Box &box) -> bool
+{
+    if (xyz.dimension() != 2 || xyz.shape(1) != 3)
+    {
+        throw std::runtime_error("Positions must have shape (n, 3)");
+    }
+    return update(xyz.data(), xyz.shape(0), box);
+}
+
+auto VerletList::update(const double *xyz, size_t n, const Box &box) -> bool
+{
+    using clock = std::chrono::steady_clock;
+    _stats.n_updates++;
+
+    auto start = clock::now();
+    bool rebuild = needs_rebuild(xyz, n, box);
+    auto checked = clock::now();
+    _stats.check_time += std::chrono::duration<double>(checked - start).count();
+    if (!rebuild)
+    {
+        return false;
+    }
+
+    _cells.build(xyz, n, box, _list);
+    _reference.assign(xyz, xyz + 3 * n);
+    _reference_box = box;
+    _built = true;
+    _stats.n_rebuilds++;
+    _stats.max_displacement = 0;
+    _stats.rebuild_time += std::chrono::duration<double>(clock::now() - checked).count();
+    return true;
+}
+
+auto VerletList::needs_rebuild(const double *xyz, size_t n, const Box &box) -> bool
+{
+    if (!_built || n != _reference.size() / 3 || box.get_style() != _reference_box.get_style())
+    {
+        return true;
+    }
+
+    auto matrix = box.get_matrix();
+    auto reference = _reference_box.get_matrix();
+    double deformation = 0;
+    for (size_t d = 0; d < 3; d++)
+    {
+        double norm2 = 0;
+        for (size_t r = 0; r < 3; r++)
+        {
+            norm2 += (matrix(r, d) - reference(r, d)) * (matrix(r, d) - reference(r, d));
+        }
+        deformation += std::sqrt(norm2);
+    }
+
+    _displacements.resize(3 * n);
+    for (size_t k = 0; k < 3 * n; k++)
+    {
+        _displacements[k] = xyz[k] - _reference[k];
+    }
+    box.wrap_inplace(_displacements.data(), n);
+    double max2 = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        const double *d = &_displacements[3 * i];
+        max2 = std::max(max2, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+    _stats.max_displacement = std::sqrt(max2);
+
+    return 2 * _stats.max_displacement + deformation > _skin;
+}
+
+} // namespace molcpp
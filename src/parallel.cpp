@@ -0,0 +1,92 @@
+#include "molcpp/parallel.hpp"
+
+namespace molcpp::detail
+{
+
+auto ThreadPool::global() -> ThreadPool &
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto &worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+auto ThreadPool::try_run(size_t n_threads, void (*job)(void *, size_t), void *context) -> bool
+{
+    // a flag rather than a mutex, as a nested call comes from the thread
+    // which already runs the pool
+    bool busy = false;
+    if (!_busy.compare_exchange_strong(busy, true, std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    try
+    {
+        while (_workers.size() + 1 < n_threads)
+        {
+            _workers.emplace_back(&ThreadPool::work, this, _workers.size() + 1, _generation);
+        }
+    }
+    catch (...)
+    {
+        _busy.store(false, std::memory_order_release);
+        throw;
+    }
+    _job = job;
+    _context = context;
+    _n_threads = n_threads;
+    _pending = n_threads - 1;
+    _generation++;
+    lock.unlock();
+    _wake.notify_all();
+
+    job(context, 0);
+
+    lock.lock();
+    _done.wait(lock, [&] { return _pending == 0; });
+    lock.unlock();
+    _busy.store(false, std::memory_order_release);
+    return true;
+}
+
+void ThreadPool::work(size_t thread, uint64_t generation)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _wake.wait(lock, [&] { return _stop || _generation != generation; });
+        if (_stop)
+        {
+            return;
+        }
+        generation = _generation;
+        // workers above the number of threads of this job sit it out
+        if (thread < _n_threads)
+        {
+            auto *job = _job;
+            auto *context = _context;
+            lock.unlock();
+            job(context, thread);
+            lock.lock();
+            if (--_pending == 0)
+            {
+                _done.notify_one();
+            }
+        }
+    }
+}
+
+} // namespace molcpp::detail
@@ -0,0 +1,179 @@
+#include "molcpp/pipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <utility>
+
+namespace molcpp
+{
+
+using Clock = std::chrono::steady_clock;
+
+static auto seconds_since(Clock::time_point start) -> double
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+FramePipeline::FramePipeline(const TrajectoryReader &reader, size_t depth, size_t n_readers)
+    : _reader(reader), _n_readers(n_readers), _buffers(depth), _ready(depth, EMPTY)
+{
+    if (depth == 0)
+    {
+        throw std::runtime_error("Pipeline depth must be > 0");
+    }
+    if (n_readers == 0)
+    {
+        throw std::runtime_error("Number of reader threads must be > 0");
+    }
+    for (auto &buffer : _buffers)
+    {
+        buffer.xyz.resize(3 * reader.n_atoms());
+    }
+}
+
+void FramePipeline::add_consumer(Consumer consumer)
+{
+    _consumers.push_back(std::move(consumer));
+}
+
+void FramePipeline::run()
+{
+    run(0, _reader.n_frames());
+}
+
+void FramePipeline::run(size_t begin, size_t end, size_t stride)
+{
+    if (begin > end || end > _reader.n_frames() || stride == 0)
+    {
+        throw std::runtime_error("Invalid range of frames");
+    }
+    const size_t n_frames = (end - begin + stride - 1) / stride;
+    const size_t depth = _buffers.size();
+
+    _stats = PipelineStats{};
+    _stats.compute_time.assign(_consumers.size(), 0.0);
+    std::fill(_ready.begin(), _ready.end(), EMPTY);
+    _next = 0;
+    _consumed = 0;
+    _stopped = false;
+    _error = nullptr;
+
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < std::min(_n_readers, n_frames); i++)
+    {
+        readers.emplace_back([this, begin, stride, n_frames]() { read_frames(begin, stride, n_frames); });
+    }
+
+    try
+    {
+        for (size_t k = 0; k < n_frames; k++)
+        {
+            const auto &buffer = _buffers[k % depth];
+            {
+                auto start = Clock::now();
+                std::unique_lock<std::mutex> lock(_mutex);
+                _frame_ready.wait(lock, [&]() { return _stopped || _ready[k % depth] == k; });
+                _stats.io_wait_time += seconds_since(start);
+                if (_stopped)
+                {
+                    break;
+                }
+            }
+
+            for (size_t c = 0; c < _consumers.size(); c++)
+            {
+                auto start = Clock::now();
+                _consumers[c](buffer);
+                _stats.compute_time[c] += seconds_since(start);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _ready[k % depth] = EMPTY;
+                _consumed++;
+            }
+            _buffer_free.notify_all();
+            _stats.n_frames++;
+        }
+    }
+    catch (...)
+    {
+        stop(std::current_exception());
+    }
+
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    if (_error)
+    {
+        std::rethrow_exception(_error);
+    }
+}
+
+void FramePipeline::read_frames(size_t begin, size_t stride, size_t n_frames)
+{
+    const size_t depth = _buffers.size();
+    double read_time = 0;
+    double wait_time = 0;
+    try
+    {
+        while (true)
+        {
+            size_t k = 0;
+            {
+                auto start = Clock::now();
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (_stopped || _next == n_frames)
+                {
+                    break;
+                }
+                k = _next++;
+                // wait for consumers to release frame `k - depth`
+                _buffer_free.wait(lock, [&]() { return _stopped || k < _consumed + depth; });
+                wait_time += seconds_since(start);
+                if (_stopped)
+                {
+                    break;
+                }
+            }
+
+            auto start = Clock::now();
+            auto &buffer = _buffers[k % depth];
+            buffer.frame = begin + k * stride;
+            buffer.box = _reader.read(buffer.frame, buffer.xyz.data());
+            read_time += seconds_since(start);
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _ready[k % depth] = k;
+            }
+            _frame_ready.notify_one();
+        }
+    }
+    catch (...)
+    {
+        stop(std::current_exception());
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.read_time += read_time;
+    _stats.read_wait_time += wait_time;
+}
+
+void FramePipeline::stop(std::exception_ptr error)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_error)
+        {
+            _error = error;
+        }
+        _stopped = true;
+    }
+    _frame_ready.notify_all();
+    _buffer_free.notify_all();
+}
+
+} // namespace molcpp
@@ -0,0 +1,461 @@
+#include "region.hpp"
+#include "molcpp/region.hpp"
+#include "molcpp/simd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define MOLCPP_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace molcpp
+{
+
+namespace detail
+{
+
+static auto contains(const AxialShape &shape, const double *r) -> bool
+{
+    const double x = r[0] - shape.center[0];
+    const double y = r[1] - shape.center[1];
+    const double z = r[2] - shape.center[2];
+    const double t = x * shape.axis[0] + y * shape.axis[1] + z * shape.axis[2];
+    const double q = x * x + y * y + z * z - shape.axial_weight * t * t;
+    return q < shape.radius2 && t >= shape.lo && t < shape.hi;
+}
+
+static auto contains(const ParallelepipedShape &shape, const double *r) -> bool
+{
+    const double *inv = shape.inv;
+    const double s0 = inv[0] * r[0] + inv[1] * r[1] + inv[2] * r[2];
+    const double s1 = inv[3] * r[1] + inv[4] * r[2];
+    const double s2 = inv[5] * r[2];
+    return s0 >= shape.lo && s0 < shape.hi && s1 >= shape.lo && s1 < shape.hi && s2 >= shape.lo && s2 < shape.hi;
+}
+
+/// Bits of the positions `begin` to `end` of the word starting at `xyz`
+template <typename Shape>
+static auto word_scalar(const Shape &shape, const double *xyz, size_t begin, size_t end) -> uint64_t
+{
+    uint64_t word = 0;
+    for (size_t k = begin; k < end; k++)
+    {
+        word |= static_cast<uint64_t>(contains(shape, xyz + 3 * k)) << k;
+    }
+    return word;
+}
+
+template <typename Shape> static void select_scalar(const Shape &shape, const double *xyz, size_t n, uint64_t *bits)
+{
+    for (size_t w = 0; 64 * w < n; w++)
+    {
+        bits[w] = word_scalar(shape, xyz + 3 * 64 * w, 0, std::min<size_t>(64, n - 64 * w));
+    }
+}
+
+#ifdef MOLCPP_X86_SIMD
+
+/// Load 4 consecutive positions and split them in x, y and z vectors
+__attribute__((target("avx2,fma"))) static inline void load_avx2(const double *xyz, __m256d &x, __m256d &y,
+                                                                 __m256d &z)
+{
+    // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+    const __m256d a = _mm256_loadu_pd(xyz);
+    const __m256d b = _mm256_loadu_pd(xyz + 4);
+    const __m256d c = _mm256_loadu_pd(xyz + 8);
+    // x0 x3 x2 x1, y1 y0 y3 y2 and z2 z1 z0 z3, then put in order
+    x = _mm256_permute4x64_pd(_mm256_blend_pd(_mm256_blend_pd(a, b, 0b0100), c, 0b0010), 0x6C);
+    y = _mm256_permute4x64_pd(_mm256_blend_pd(_mm256_blend_pd(a, b, 0b1001), c, 0b0100), 0xB1);
+    z = _mm256_permute4x64_pd(_mm256_blend_pd(_mm256_blend_pd(a, b, 0b0010), c, 0b1001), 0xC6);
+}
+
+__attribute__((target("avx2,fma"))) static inline __m256d in_range_avx2(__m256d s, __m256d lo, __m256d hi)
+{
+    return _mm256_and_pd(_mm256_cmp_pd(s, lo, _CMP_GE_OQ), _mm256_cmp_pd(s, hi, _CMP_LT_OQ));
+}
+
+/// Inside test of 4 positions, as a mask of all-ones lanes
+struct AxialAvx2
+{
+    __m256d cx, cy, cz, ax, ay, az, w, r2, lo, hi;
+
+    __attribute__((target("avx2,fma"))) explicit AxialAvx2(const AxialShape &shape)
+        : cx(_mm256_set1_pd(shape.center[0])), cy(_mm256_set1_pd(shape.center[1])),
+          cz(_mm256_set1_pd(shape.center[2])), ax(_mm256_set1_pd(shape.axis[0])), ay(_mm256_set1_pd(shape.axis[1])),
+          az(_mm256_set1_pd(shape.axis[2])), w(_mm256_set1_pd(shape.axial_weight)),
+          r2(_mm256_set1_pd(shape.radius2)), lo(_mm256_set1_pd(shape.lo)), hi(_mm256_set1_pd(shape.hi))
+    {
+    }
+
+    __attribute__((target("avx2,fma"))) auto operator()(__m256d x, __m256d y, __m256d z) const -> __m256d
+    {
+        x = _mm256_sub_pd(x, cx);
+        y = _mm256_sub_pd(y, cy);
+        z = _mm256_sub_pd(z, cz);
+        const __m256d t = _mm256_fmadd_pd(x, ax, _mm256_fmadd_pd(y, ay, _mm256_mul_pd(z, az)));
+        const __m256d d2 = _mm256_fmadd_pd(x, x, _mm256_fmadd_pd(y, y, _mm256_mul_pd(z, z)));
+        const __m256d q = _mm256_fnmadd_pd(_mm256_mul_pd(w, t), t, d2);
+        return _mm256_and_pd(_mm256_cmp_pd(q, r2, _CMP_LT_OQ), in_range_avx2(t, lo, hi));
+    }
+};
+
+struct ParallelepipedAvx2
+{
+    __m256d i0, i1, i2, i3, i4, i5, lo, hi;
+
+    __attribute__((target("avx2,fma"))) explicit ParallelepipedAvx2(const ParallelepipedShape &shape)
+        : i0(_mm256_set1_pd(shape.inv[0])), i1(_mm256_set1_pd(shape.inv[1])), i2(_mm256_set1_pd(shape.inv[2])),
+          i3(_mm256_set1_pd(shape.inv[3])), i4(_mm256_set1_pd(shape.inv[4])), i5(_mm256_set1_pd(shape.inv[5])),
+          lo(_mm256_set1_pd(shape.lo)), hi(_mm256_set1_pd(shape.hi))
+    {
+    }
+
+    __attribute__((target("avx2,fma"))) auto operator()(__m256d x, __m256d y, __m256d z) const -> __m256d
+    {
+        const __m256d s0 = _mm256_fmadd_pd(i0, x, _mm256_fmadd_pd(i1, y, _mm256_mul_pd(i2, z)));
+        const __m256d s1 = _mm256_fmadd_pd(i3, y, _mm256_mul_pd(i4, z));
+        const __m256d s2 = _mm256_mul_pd(i5, z);
+        return _mm256_and_pd(in_range_avx2(s0, lo, hi),
+                             _mm256_and_pd(in_range_avx2(s1, lo, hi), in_range_avx2(s2, lo, hi)));
+    }
+};
+
+template <typename Kernel, typename Shape>
+__attribute__((target("avx2,fma"))) static void select_avx2(const Shape &shape, const double *xyz, size_t n,
+                                                            uint64_t *bits)
+{
+    const Kernel kernel(shape);
+    for (size_t w = 0; 64 * w < n; w++)
+    {
+        const double *block = xyz + 3 * 64 * w;
+        const size_t m = std::min<size_t>(64, n - 64 * w);
+        uint64_t word = 0;
+        size_t k = 0;
+        for (; k + 4 <= m; k += 4)
+        {
+            __m256d x, y, z;
+            load_avx2(block + 3 * k, x, y, z);
+            word |= static_cast<uint64_t>(_mm256_movemask_pd(kernel(x, y, z))) << k;
+        }
+        bits[w] = word | word_scalar(shape, block, k, m);
+    }
+}
+
+/// Load 8 consecutive positions and split them in x, y and z vectors
+__attribute__((target("avx512f"))) static inline void load_avx512(const double *xyz, __m512d &x, __m512d &y,
+                                                                  __m512d &z)
+{
+    // indices in the 24 doubles of (a, b), then of (first pass, c)
+    alignas(64) static const int64_t x_ab[8] = {0, 3, 6, 9, 12, 15, 0, 0};
+    alignas(64) static const int64_t x_c[8] = {0, 1, 2, 3, 4, 5, 10, 13};
+    alignas(64) static const int64_t y_ab[8] = {1, 4, 7, 10, 13, 0, 0, 0};
+    alignas(64) static const int64_t y_c[8] = {0, 1, 2, 3, 4, 8, 11, 14};
+    alignas(64) static const int64_t z_ab[8] = {2, 5, 8, 11, 14, 0, 0, 0};
+    alignas(64) static const int64_t z_c[8] = {0, 1, 2, 3, 4, 9, 12, 15};
+    const __m512d a = _mm512_loadu_pd(xyz);
+    const __m512d b = _mm512_loadu_pd(xyz + 8);
+    const __m512d c = _mm512_loadu_pd(xyz + 16);
+    x = _mm512_permutex2var_pd(_mm512_permutex2var_pd(a, _mm512_load_si512(x_ab), b), _mm512_load_si512(x_c), c);
+    y = _mm512_permutex2var_pd(_mm512_permutex2var_pd(a, _mm512_load_si512(y_ab), b), _mm512_load_si512(y_c), c);
+    z = _mm512_permutex2var_pd(_mm512_permutex2var_pd(a, _mm512_load_si512(z_ab), b), _mm512_load_si512(z_c), c);
+}
+
+__attribute__((target("avx512f"))) static inline __mmask8 in_range_avx512(__m512d s, __m512d lo, __m512d hi)
+{
+    return _mm512_cmp_pd_mask(s, lo, _CMP_GE_OQ) & _mm512_cmp_pd_mask(s, hi, _CMP_LT_OQ);
+}
+
+struct AxialAvx512
+{
+    __m512d cx, cy, cz, ax, ay, az, w, r2, lo, hi;
+
+    __attribute__((target("avx512f"))) explicit AxialAvx512(const AxialShape &shape)
+        : cx(_mm512_set1_pd(shape.center[0])), cy(_mm512_set1_pd(shape.center[1])),
+          cz(_mm512_set1_pd(shape.center[2])), ax(_mm512_set1_pd(shape.axis[0])), ay(_mm512_set1_pd(shape.axis[1])),
+          az(_mm512_set1_pd(shape.axis[2])), w(_mm512_set1_pd(shape.axial_weight)),
+          r2(_mm512_set1_pd(shape.radius2)), lo(_mm512_set1_pd(shape.lo)), hi(_mm512_set1_pd(shape.hi))
+    {
+    }
+
+    __attribute__((target("avx512f"))) auto operator()(__m512d x, __m512d y, __m512d z) const -> __mmask8
+    {
+        x = _mm512_sub_pd(x, cx);
+        y = _mm512_sub_pd(y, cy);
+        z = _mm512_sub_pd(z, cz);
+        const __m512d t = _mm512_fmadd_pd(x, ax, _mm512_fmadd_pd(y, ay, _mm512_mul_pd(z, az)));
+        const __m512d d2 = _mm512_fmadd_pd(x, x, _mm512_fmadd_pd(y, y, _mm512_mul_pd(z, z)));
+        const __m512d q = _mm512_fnmadd_pd(_mm512_mul_pd(w, t), t, d2);
+        return _mm512_cmp_pd_mask(q, r2, _CMP_LT_OQ) & in_range_avx512(t, lo, hi);
+    }
+};
+
+struct ParallelepipedAvx512
+{
+    __m512d i0, i1, i2, i3, i4, i5, lo, hi;
+
+    __attribute__((target("avx512f"))) explicit ParallelepipedAvx512(const ParallelepipedShape &shape)
+        : i0(_mm512_set1_pd(shape.inv[0])), i1(_mm512_set1_pd(shape.inv[1])), i2(_mm512_set1_pd(shape.inv[2])),
+          i3(_mm512_set1_pd(shape.inv[3])), i4(_mm512_set1_pd(shape.inv[4])), i5(_mm512_set1_pd(shape.inv[5])),
+          lo(_mm512_set1_pd(shape.lo)), hi(_mm512_set1_pd(shape.hi))
+    {
+    }
+
+    __attribute__((target("avx512f"))) auto operator()(__m512d x, __m512d y, __m512d z) const -> __mmask8
+    {
+        const __m512d s0 = _mm512_fmadd_pd(i0, x, _mm512_fmadd_pd(i1, y, _mm512_mul_pd(i2, z)));
+        const __m512d s1 = _mm512_fmadd_pd(i3, y, _mm512_mul_pd(i4, z));
+        const __m512d s2 = _mm512_mul_pd(i5, z);
+        return in_range_avx512(s0, lo, hi) & in_range_avx512(s1, lo, hi) & in_range_avx512(s2, lo, hi);
+    }
+};
+
+template <typename Kernel, typename Shape>
+__attribute__((target("avx512f"))) static void select_avx512(const Shape &shape, const double *xyz, size_t n,
+                                                             uint64_t *bits)
+{
+    const Kernel kernel(shape);
+    for (size_t w = 0; 64 * w < n; w++)
+    {
+        const double *block = xyz + 3 * 64 * w;
+        const size_t m = std::min<size_t>(64, n - 64 * w);
+        uint64_t word = 0;
+        size_t k = 0;
+        for (; k + 8 <= m; k += 8)
+        {
+            __m512d x, y, z;
+            load_avx512(block + 3 * k, x, y, z);
+            word |= static_cast<uint64_t>(kernel(x, y, z)) << k;
+        }
+        bits[w] = word | word_scalar(shape, block, k, m);
+    }
+}
+
+#endif // MOLCPP_X86_SIMD
+
+void select_axial(const AxialShape &shape, const double *xyz, size_t n, uint64_t *bits)
+{
+#ifdef MOLCPP_X86_SIMD
+    switch (get_simd_level())
+    {
+    case SimdLevel::AVX512:
+        return select_avx512<AxialAvx512>(shape, xyz, n, bits);
+    case SimdLevel::AVX2:
+        return select_avx2<AxialAvx2>(shape, xyz, n, bits);
+    default:
+        break;
+    }
+#endif
+    select_scalar(shape, xyz, n, bits);
+}
+
+void select_parallelepiped(const ParallelepipedShape &shape, const double *xyz, size_t n, uint64_t *bits)
+{
+#ifdef MOLCPP_X86_SIMD
+    switch (get_simd_level())
+    {
+    case SimdLevel::AVX512:
+        return select_avx512<ParallelepipedAvx512>(shape, xyz, n, bits);
+    case SimdLevel::AVX2:
+        return select_avx2<ParallelepipedAvx2>(shape, xyz, n, bits);
+    default:
+        break;
+    }
+#endif
+    select_scalar(shape, xyz, n, bits);
+}
+
+} // namespace detail
+
+/// Positions handled per call to `select` by the helpers below, so that
+/// their bitmask fits on the stack
+static constexpr size_t CHUNK_WORDS = 64;
+static constexpr size_t CHUNK = 64 * CHUNK_WORDS;
+
+auto Region::isin(const xt::xarray<double> &xyz) const -> xt::xarray<bool>
+{
+    if (xyz.dimension() != 2 || xyz.shape(1) != 3)
+    {
+        throw std::runtime_error("Positions must have shape (n, 3)");
+    }
+    xt::xarray<bool> mask = xt::zeros<bool>({xyz.shape(0)});
+    isin(xyz.data(), xyz.shape(0), mask.data());
+    return mask;
+}
+
+void Region::isin(const double *xyz, size_t n, bool *mask) const
+{
+    uint64_t bits[CHUNK_WORDS];
+    for (size_t begin = 0; begin < n; begin += CHUNK)
+    {
+        const size_t m = std::min(CHUNK, n - begin);
+        select(xyz + 3 * begin, m, bits);
+        for (size_t k = 0; k < m; k++)
+        {
+            mask[begin + k] = (bits[k / 64] >> (k % 64)) & 1;
+        }
+    }
+}
+
+void Region::select_indices(const double *xyz, size_t n, std::vector<uint32_t> &indices) const
+{
+    if (n > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("Too many positions to select indices");
+    }
+    uint64_t bits[CHUNK_WORDS];
+    for (size_t begin = 0; begin < n; begin += CHUNK)
+    {
+        const size_t m = std::min(CHUNK, n - begin);
+        select(xyz + 3 * begin, m, bits);
+        for (size_t w = 0; 64 * w < m; w++)
+        {
+            for (uint64_t word = bits[w]; word != 0; word &= word - 1)
+            {
+                indices.push_back(static_cast<uint32_t>(begin + 64 * w + std::countr_zero(word)));
+            }
+        }
+    }
+}
+
+auto Region::count(const double *xyz, size_t n) const -> size_t
+{
+    uint64_t bits[CHUNK_WORDS];
+    size_t total = 0;
+    for (size_t begin = 0; begin < n; begin += CHUNK)
+    {
+        const size_t m = std::min(CHUNK, n - begin);
+        select(xyz + 3 * begin, m, bits);
+        for (size_t w = 0; 64 * w < m; w++)
+        {
+            total += static_cast<size_t>(std::popcount(bits[w]));
+        }
+    }
+    return total;
+}
+
+static auto normalized(const Vec3 &vector) -> Vec3
+{
+    const double norm = std::sqrt(vector(0) * vector(0) + vector(1) * vector(1) + vector(2) * vector(2));
+    if (!(norm > 0))
+    {
+        throw std::runtime_error("Region axis must not be zero");
+    }
+    return vector / norm;
+}
+
+Sphere::Sphere(const Vec3 &center, double radius) : _center(center), _radius(radius)
+{
+    if (!(radius >= 0))
+    {
+        throw std::runtime_error("Radius must be >= 0");
+    }
+}
+
+void Sphere::select(const double *xyz, size_t n, uint64_t *bits) const
+{
+    detail::AxialShape shape;
+    std::copy(_center.begin(), _center.end(), shape.center);
+    shape.radius2 = _radius * _radius;
+    shape.lo = -std::numeric_limits<double>::infinity();
+    shape.hi = std::numeric_limits<double>::infinity();
+    detail::select_axial(shape, xyz, n, bits);
+}
+
+Cylinder::Cylinder(const Vec3 &center, const Vec3 &axis, double radius, double length)
+    : _center(center), _axis(normalized(axis)), _radius(radius), _length(length)
+{
+    if (!(radius >= 0) || !(length >= 0))
+    {
+        throw std::runtime_error("Radius and length must be >= 0");
+    }
+}
+
+void Cylinder::select(const double *xyz, size_t n, uint64_t *bits) const
+{
+    detail::AxialShape shape;
+    std::copy(_center.begin(), _center.end(), shape.center);
+    std::copy(_axis.begin(), _axis.end(), shape.axis);
+    shape.axial_weight = 1;
+    shape.radius2 = _radius * _radius;
+    shape.lo = -_length / 2;
+    shape.hi = _length / 2;
+    detail::select_axial(shape, xyz, n, bits);
+}
+
+Slab::Slab(const Vec3 &normal, double lo, double hi) : _normal(normalized(normal)), _lo(lo), _hi(hi)
+{
+}
+
+void Slab::select(const double *xyz, size_t n, uint64_t *bits) const
+{
+    detail::AxialShape shape;
+    std::copy(_normal.begin(), _normal.end(), shape.axis);
+    shape.radius2 = std::numeric_limits<double>::infinity();
+    shape.lo = _lo;
+    shape.hi = _hi;
+    detail::select_axial(shape, xyz, n, bits);
+}
+
+static void check_regions(const std::vector<std::shared_ptr<const Region>> &regions)
+{
+    if (regions.empty())
+    {
+        throw std::runtime_error("At least one region is required");
+    }
+    for (const auto &region : regions)
+    {
+        if (!region)
+        {
+            throw std::runtime_error("Invalid null region");
+        }
+    }
+}
+
+/// Combine the bitmasks of `regions` with `op`, a chunk at a time
+template <typename Op>
+static void combine(const std::vector<std::shared_ptr<const Region>> &regions, const double *xyz, size_t n,
+                    uint64_t *bits, Op &&op)
+{
+    uint64_t other[CHUNK_WORDS];
+    for (size_t begin = 0; begin < n; begin += CHUNK)
+    {
+        const size_t m = std::min(CHUNK, n - begin);
+        uint64_t *chunk = bits + begin / 64;
+        regions.front()->select(xyz + 3 * begin, m, chunk);
+        for (size_t r = 1; r < regions.size(); r++)
+        {
+            regions[r]->select(xyz + 3 * begin, m, other);
+            for (size_t w = 0; 64 * w < m; w++)
+            {
+                chunk[w] = op(chunk[w], other[w]);
+            }
+        }
+    }
+}
+
+Union::Union(std::vector<std::shared_ptr<const Region>> regions) : _regions(std::move(regions))
+{
+    check_regions(_regions);
+}
+
+void Union::select(const double *xyz, size_t n, uint64_t *bits) const
+{
+    combine(_regions, xyz, n, bits, [](uint64_t a, uint64_t b) { return a | b; });
+}
+
+Intersection::Intersection(std::vector<std::shared_ptr<const Region>> regions) : _regions(std::move(regions))
+{
+    check_regions(_regions);
+}
+
+void Intersection::select(const double *xyz, size_t n, uint64_t *bits) const
+{
+    combine(_regions, xyz, n, bits, [](uint64_t a, uint64_t b) { return a & b; });
+}
+
+} // namespace molcpp
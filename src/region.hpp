@@ -0,0 +1,43 @@
+#ifndef MOLCPP_SRC_REGION_HPP
+#define MOLCPP_SRC_REGION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Internal batch kernels of the regions. Positions are read as contiguous
+// (n, 3) buffers and results written as bitmasks, 64 positions per word.
+
+namespace molcpp::detail
+{
+
+/// Points `r` with `|d|^2 - axial_weight * t^2 < radius2` and
+/// `lo <= t < hi`, where `d = r - center` and `t = d . axis`. Spheres,
+/// cylinders and slabs are all of this form.
+struct AxialShape
+{
+    double center[3] = {0, 0, 0};
+    double axis[3] = {0, 0, 1};
+    double axial_weight = 0;
+    double radius2 = 0;
+    double lo = 0;
+    double hi = 0;
+};
+
+/// Points whose fractional coordinates `s = inv . r` are all in `[lo, hi)`,
+/// for an upper-triangular `inv` stored as `{xx, xy, xz, yy, yz, zz}`
+struct ParallelepipedShape
+{
+    double inv[6] = {0, 0, 0, 0, 0, 0};
+    double lo = 0;
+    double hi = 0;
+};
+
+/// Set bit `i % 64` of `bits[i / 64]` for each of the `n` positions inside
+/// `shape`, and clear the others, including bits past `n`. Uses AVX2/AVX-512
+/// when the CPU supports it.
+void select_axial(const AxialShape &shape, const double *xyz, size_t n, uint64_t *bits);
+
+void select_parallelepiped(const ParallelepipedShape &shape, const double *xyz, size_t n, uint64_t *bits);
+
+} // namespace molcpp::detail
+#endif // MOLCPP_SRC_REGION_HPP
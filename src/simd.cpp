@@ -0,0 +1,41 @@
+#include "molcpp/simd.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace molcpp
+{
+
+auto detect_simd_level() -> SimdLevel
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return SimdLevel::AVX2;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+static std::atomic<SimdLevel> &active_simd_level()
+{
+    static std::atomic<SimdLevel> level{detect_simd_level()};
+    return level;
+}
+
+auto get_simd_level() -> SimdLevel
+{
+    return active_simd_level().load(std::memory_order_relaxed);
+}
+
+void set_simd_level(SimdLevel level)
+{
+    active_simd_level().store(std::min(level, detect_simd_level()), std::memory_order_relaxed);
+}
+
+} // namespace molcpp
@@ -0,0 +1,101 @@
+#ifndef MOLCPP_SRC_TEXT_HPP
+#define MOLCPP_SRC_TEXT_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Internal helpers shared by the readers of text trajectories, which parse
+// memory-mapped files in place with `std::from_chars`.
+
+namespace molcpp::detail
+{
+
+/// Bytes of a text file handled by each task when scanning it in parallel
+inline constexpr size_t SCAN_CHUNK_BYTES = size_t{1} << 22;
+
+inline auto is_space(char c) -> bool
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/// Sequential access to the lines of `[begin, end)`, without their newline
+class LineReader
+{
+  public:
+    LineReader(const char *begin, const char *end) : _current(begin), _end(end)
+    {
+    }
+
+    auto done() const -> bool
+    {
+        return _current >= _end;
+    }
+
+    auto next() -> std::string_view
+    {
+        if (done())
+        {
+            throw std::runtime_error("Unexpected end of file");
+        }
+        const char *begin = _current;
+        const auto *newline = static_cast<const char *>(std::memchr(begin, '\n', static_cast<size_t>(_end - begin)));
+        const char *end = newline == nullptr ? _end : newline;
+        _current = end + 1;
+        return {begin, static_cast<size_t>(end - begin)};
+    }
+
+  private:
+    const char *_current;
+    const char *_end;
+};
+
+/// Remove and return the first whitespace-separated token of `line`, or an
+/// empty view if there is none
+inline auto next_token(std::string_view &line) -> std::string_view
+{
+    size_t begin = 0;
+    while (begin < line.size() && is_space(line[begin]))
+    {
+        begin++;
+    }
+    size_t end = begin;
+    while (end < line.size() && !is_space(line[end]))
+    {
+        end++;
+    }
+    auto token = line.substr(begin, end - begin);
+    line.remove_prefix(end);
+    return token;
+}
+
+/// Parse the whole of `token` as a number
+template <typename T> inline auto parse(std::string_view token) -> T
+{
+    T value{};
+    const char *begin = token.data();
+    const char *end = begin + token.size();
+    // from_chars does not accept the leading plus of "+1.5e3"
+    if (begin != end && *begin == '+')
+    {
+        begin++;
+    }
+    auto result = std::from_chars(begin, end, value);
+    if (result.ec != std::errc() || result.ptr != end || token.empty())
+    {
+        throw std::runtime_error("Invalid number '" + std::string(token) + "'");
+    }
+    return value;
+}
+
+/// Whether `line` starts with `prefix`
+inline auto starts_with(std::string_view line, std::string_view prefix) -> bool
+{
+    return line.substr(0, prefix.size()) == prefix;
+}
+
+} // namespace molcpp::detail
+#endif // MOLCPP_SRC_TEXT_HPP
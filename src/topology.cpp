@@ -0,0 +1,392 @@
+#include "molcpp/topology.hpp"
+#include "molcpp/neighbor.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace molcpp
+{
+
+/// Number of atom ranges the enumerations are split in
+static constexpr size_t ENUMERATE_TASKS = 64;
+
+/// Tuples of `N` atoms, made by `fill(i, out)` for each atom `i` in order.
+/// `count(i)` gives the number of tuples written by `fill(i, out)`, which
+/// returns the end of what it wrote. Atoms are split in ranges counted, then
+/// filled, in parallel.
+template <size_t N, typename Count, typename Fill>
+static auto enumerate(size_t n, size_t n_threads, Count &&count, Fill &&fill) -> std::vector<std::array<uint32_t, N>>
+{
+    const size_t n_ranges = std::max<size_t>(1, std::min(n, ENUMERATE_TASKS));
+    std::vector<size_t> starts(n_ranges + 1, 0);
+    parallel_for(n_ranges, n_threads, [&](size_t range, size_t) {
+        size_t total = 0;
+        for (size_t i = n * range / n_ranges; i < n * (range + 1) / n_ranges; i++)
+        {
+            total += count(i);
+        }
+        starts[range + 1] = total;
+    });
+    std::partial_sum(starts.begin(), starts.end(), starts.begin());
+
+    std::vector<std::array<uint32_t, N>> tuples(starts.back());
+    parallel_for(n_ranges, n_threads, [&](size_t range, size_t) {
+        auto *out = tuples.data() + starts[range];
+        for (size_t i = n * range / n_ranges; i < n * (range + 1) / n_ranges; i++)
+        {
+            out = fill(i, out);
+        }
+    });
+    return tuples;
+}
+
+Topology::Topology(size_t n_atoms, ExecutionPolicy policy) : _policy(policy), _offsets(n_atoms + 1, 0)
+{
+    if (n_atoms >= std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("Too many atoms for a topology");
+    }
+}
+
+template <typename ForEachBond> void Topology::build(ForEachBond &&for_each_bond)
+{
+    const size_t n = n_atoms();
+    std::vector<size_t> counts(n + 1, 0);
+    for_each_bond([&](size_t a, size_t b) {
+        if (a >= n || b >= n)
+        {
+            throw std::runtime_error("Bond atom index out of range");
+        }
+        if (a == b)
+        {
+            throw std::runtime_error("Invalid bond between an atom and itself");
+        }
+        counts[a + 1]++;
+        counts[b + 1]++;
+    });
+    std::partial_sum(counts.begin(), counts.end(), counts.begin());
+    if (counts.back() > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("Too many bonds for a topology");
+    }
+
+    // counting sort of both directions of each bond
+    std::vector<uint32_t> adjacency(counts.back());
+    std::vector<size_t> cursor(counts.begin(), counts.end() - 1);
+    for_each_bond([&](size_t a, size_t b) {
+        adjacency[cursor[a]++] = static_cast<uint32_t>(b);
+        adjacency[cursor[b]++] = static_cast<uint32_t>(a);
+    });
+
+    // sort the neighbors of each atom and drop duplicated bonds, counting
+    // the remaining neighbors in `cursor`
+    parallel_ranges(n, ENUMERATE_TASKS, _policy.n_threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            auto first = adjacency.begin() + static_cast<ptrdiff_t>(counts[i]);
+            auto last = adjacency.begin() + static_cast<ptrdiff_t>(counts[i + 1]);
+            std::sort(first, last);
+            cursor[i] = static_cast<size_t>(std::unique(first, last) - first);
+        }
+    });
+
+    _offsets.assign(n + 1, 0);
+    size_t size = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        std::copy_n(adjacency.begin() + static_cast<ptrdiff_t>(counts[i]), cursor[i],
+                    adjacency.begin() + static_cast<ptrdiff_t>(size));
+        size += cursor[i];
+        _offsets[i + 1] = static_cast<uint32_t>(size);
+    }
+    adjacency.resize(size);
+    adjacency.shrink_to_fit();
+    _adjacency = std::move(adjacency);
+}
+
+void Topology::set_bonds(const uint32_t *pairs, size_t n_bonds)
+{
+    build([&](auto &&fn) {
+        for (size_t bond = 0; bond < n_bonds; bond++)
+        {
+            fn(pairs[2 * bond], pairs[2 * bond + 1]);
+        }
+    });
+}
+
+void Topology::set_bonds(std::span<const Bond> bonds)
+{
+    set_bonds(bonds.empty() ? nullptr : bonds.front().data(), bonds.size());
+}
+
+void Topology::set_bonds(const xt::xarray<uint32_t> &bonds)
+{
+    if (bonds.size() == 0)
+    {
+        return set_bonds(nullptr, 0);
+    }
+    if (bonds.dimension() != 2 || bonds.shape(1) != 2)
+    {
+        throw std::runtime_error("Bonds must have shape (n_bonds, 2)");
+    }
+    set_bonds(bonds.data(), bonds.shape(0));
+}
+
+void Topology::guess_bonds(const double *xyz, size_t n, const Box &box, double cutoff)
+{
+    if (n != n_atoms())
+    {
+        throw std::runtime_error("Number of positions does not match the number of atoms");
+    }
+    CellList cells(cutoff);
+    cells.set_n_threads(_policy.n_threads);
+    NeighborList list;
+    cells.build(xyz, n, box, list);
+    build([&](auto &&fn) {
+        for (size_t i = 0; i < n; i++)
+        {
+            for (uint32_t j : list.neighbors(i))
+            {
+                fn(i, j);
+            }
+        }
+    });
+}
+
+void Topology::guess_bonds(const double *xyz, size_t n, const Box &box, std::span<const double> radii,
+                           double tolerance)
+{
+    if (n != n_atoms())
+    {
+        throw std::runtime_error("Number of positions does not match the number of atoms");
+    }
+    if (radii.size() != n)
+    {
+        throw std::runtime_error("Number of radii does not match the number of atoms");
+    }
+    if (n == 0)
+    {
+        return set_bonds(nullptr, 0);
+    }
+    const double max_radius = *std::max_element(radii.begin(), radii.end());
+    CellList cells(2 * max_radius + tolerance, false, true);
+    cells.set_n_threads(_policy.n_threads);
+    NeighborList list;
+    cells.build(xyz, n, box, list);
+    build([&](auto &&fn) {
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t p = list.offsets[i]; p < list.offsets[i + 1]; p++)
+            {
+                const uint32_t j = list.indices[p];
+                if (list.distances[p] < radii[i] + radii[j] + tolerance)
+                {
+                    fn(i, j);
+                }
+            }
+        }
+    });
+}
+
+auto Topology::bonds() const -> std::vector<Bond>
+{
+    auto count = [&](size_t i) {
+        auto neighbors = this->neighbors(i);
+        return static_cast<size_t>(neighbors.end() - std::upper_bound(neighbors.begin(), neighbors.end(), i));
+    };
+    auto fill = [&](size_t i, Bond *out) {
+        for (uint32_t j : neighbors(i))
+        {
+            if (j > i)
+            {
+                *out++ = {static_cast<uint32_t>(i), j};
+            }
+        }
+        return out;
+    };
+    return enumerate<2>(n_atoms(), _policy.n_threads, count, fill);
+}
+
+auto Topology::angles() const -> std::vector<Angle>
+{
+    auto count = [&](size_t j) {
+        const size_t d = degree(j);
+        return d < 2 ? 0 : d * (d - 1) / 2;
+    };
+    auto fill = [&](size_t j, Angle *out) {
+        auto neighbors = this->neighbors(j);
+        for (size_t a = 0; a < neighbors.size(); a++)
+        {
+            for (size_t b = a + 1; b < neighbors.size(); b++)
+            {
+                *out++ = {neighbors[a], static_cast<uint32_t>(j), neighbors[b]};
+            }
+        }
+        return out;
+    };
+    return enumerate<3>(n_atoms(), _policy.n_threads, count, fill);
+}
+
+auto Topology::dihedrals() const -> std::vector<Dihedral>
+{
+    // dihedrals around the bonds (j, k) with j < k, calling `emit` on each;
+    // i == l happens in 3-membered rings, which have no dihedral
+    auto around = [&](size_t j, auto &&emit) {
+        for (uint32_t k : neighbors(j))
+        {
+            if (k <= j)
+            {
+                continue;
+            }
+            for (uint32_t i : neighbors(j))
+            {
+                if (i == k)
+                {
+                    continue;
+                }
+                for (uint32_t l : neighbors(k))
+                {
+                    if (l != j && l != i)
+                    {
+                        emit(i, k, l);
+                    }
+                }
+            }
+        }
+    };
+    auto count = [&](size_t j) {
+        size_t total = 0;
+        around(j, [&](uint32_t, uint32_t, uint32_t) { total++; });
+        return total;
+    };
+    auto fill = [&](size_t j, Dihedral *out) {
+        around(j, [&](uint32_t i, uint32_t k, uint32_t l) { *out++ = {i, static_cast<uint32_t>(j), k, l}; });
+        return out;
+    };
+    return enumerate<4>(n_atoms(), _policy.n_threads, count, fill);
+}
+
+auto Topology::impropers() const -> std::vector<Improper>
+{
+    auto count = [&](size_t i) {
+        const size_t d = degree(i);
+        return d < 3 ? 0 : d * (d - 1) * (d - 2) / 6;
+    };
+    auto fill = [&](size_t i, Improper *out) {
+        auto neighbors = this->neighbors(i);
+        for (size_t a = 0; a < neighbors.size(); a++)
+        {
+            for (size_t b = a + 1; b < neighbors.size(); b++)
+            {
+                for (size_t c = b + 1; c < neighbors.size(); c++)
+                {
+                    *out++ = {static_cast<uint32_t>(i), neighbors[a], neighbors[b], neighbors[c]};
+                }
+            }
+        }
+        return out;
+    };
+    return enumerate<4>(n_atoms(), _policy.n_threads, count, fill);
+}
+
+auto Topology::n_angles() const -> size_t
+{
+    size_t total = 0;
+    for (size_t j = 0; j < n_atoms(); j++)
+    {
+        const size_t d = degree(j);
+        total += d < 2 ? 0 : d * (d - 1) / 2;
+    }
+    return total;
+}
+
+auto Topology::n_impropers() const -> size_t
+{
+    size_t total = 0;
+    for (size_t i = 0; i < n_atoms(); i++)
+    {
+        const size_t d = degree(i);
+        total += d < 3 ? 0 : d * (d - 1) * (d - 2) / 6;
+    }
+    return total;
+}
+
+auto Topology::molecules() const -> std::vector<uint32_t>
+{
+    constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    const size_t n = n_atoms();
+    std::vector<uint32_t> molecule(n, NONE);
+    std::vector<uint32_t> stack;
+    uint32_t n_molecules = 0;
+    for (size_t first = 0; first < n; first++)
+    {
+        if (molecule[first] != NONE)
+        {
+            continue;
+        }
+        // depth-first search from the first atom of a new molecule
+        molecule[first] = n_molecules;
+        stack.push_back(static_cast<uint32_t>(first));
+        while (!stack.empty())
+        {
+            const uint32_t i = stack.back();
+            stack.pop_back();
+            for (uint32_t j : neighbors(i))
+            {
+                if (molecule[j] == NONE)
+                {
+                    molecule[j] = n_molecules;
+                    stack.push_back(j);
+                }
+            }
+        }
+        n_molecules++;
+    }
+    return molecule;
+}
+
+auto Topology::n_molecules() const -> size_t
+{
+    auto molecule = molecules();
+    return molecule.empty() ? 0 : static_cast<size_t>(*std::max_element(molecule.begin(), molecule.end())) + 1;
+}
+
+auto Topology::molecule_trees() const -> MoleculeTrees
+{
+    const size_t n = n_atoms();
+    MoleculeTrees trees;
+    trees.offsets.push_back(0);
+    trees.edges.reserve(n);
+    std::vector<bool> visited(n, false);
+    for (size_t first = 0; first < n; first++)
+    {
+        if (visited[first])
+        {
+            continue;
+        }
+        // the edges found so far are the queue of the breadth-first search
+        visited[first] = true;
+        size_t head = trees.edges.size();
+        auto visit = [&](size_t i) {
+            for (uint32_t j : neighbors(i))
+            {
+                if (!visited[j])
+                {
+                    visited[j] = true;
+                    trees.edges.push_back({static_cast<uint32_t>(i), j});
+                }
+            }
+        };
+        visit(first);
+        for (; head < trees.edges.size(); head++)
+        {
+            visit(trees.edges[head][1]);
+        }
+        trees.offsets.push_back(trees.edges.size());
+    }
+    return trees;
+}
+
+} // namespace molcpp
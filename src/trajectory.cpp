@@ -0,0 +1,471 @@
+#include "molcpp/trajectory.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::endian::native == std::endian::little, "The binary trajectory format is little-endian");
+
+namespace molcpp
+{
+
+static constexpr char MAGIC[8] = {'M', 'O', 'L', 'T', 'R', 'A', 'J', '\0'};
+static constexpr uint32_t VERSION = 1;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Could not open " + path);
+    }
+    _file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        unmap();
+        throw std::runtime_error("Could not get the size of " + path);
+    }
+    _size = static_cast<size_t>(size.QuadPart);
+    if (_size == 0)
+    {
+        return;
+    }
+    _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping == nullptr)
+    {
+        unmap();
+        throw std::runtime_error("Could not map " + path);
+    }
+    _data = static_cast<const char *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (_data == nullptr)
+    {
+        unmap();
+        throw std::runtime_error("Could not map " + path);
+    }
+}
+
+void MappedFile::unmap()
+{
+    if (_data != nullptr)
+    {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping != nullptr)
+    {
+        CloseHandle(_mapping);
+    }
+    if (_file != nullptr)
+    {
+        CloseHandle(_file);
+    }
+    _data = nullptr;
+    _mapping = nullptr;
+    _file = nullptr;
+    _size = 0;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)),
+      _file(std::exchange(other._file, nullptr)), _mapping(std::exchange(other._mapping, nullptr))
+{
+}
+
+auto MappedFile::operator=(MappedFile &&other) noexcept -> MappedFile &
+{
+    if (this != &other)
+    {
+        unmap();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+        _file = std::exchange(other._file, nullptr);
+        _mapping = std::exchange(other._mapping, nullptr);
+    }
+    return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not open " + path);
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Could not get the size of " + path);
+    }
+    _size = static_cast<size_t>(status.st_size);
+    if (_size != 0)
+    {
+        void *data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("Could not map " + path);
+        }
+        _data = static_cast<const char *>(data);
+    }
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+}
+
+void MappedFile::unmap()
+{
+    if (_data != nullptr)
+    {
+        ::munmap(const_cast<char *>(_data), _size);
+    }
+    _data = nullptr;
+    _size = 0;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0))
+{
+}
+
+auto MappedFile::operator=(MappedFile &&other) noexcept -> MappedFile &
+{
+    if (this != &other)
+    {
+        unmap();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+void TrajectoryReader::check_frame(size_t frame) const
+{
+    if (frame >= n_frames())
+    {
+        throw std::runtime_error("Frame " + std::to_string(frame) + " is out of range for a trajectory of " +
+                                 std::to_string(n_frames()) + " frames");
+    }
+}
+
+auto TrajectoryReader::read_positions(size_t begin, size_t end, ExecutionPolicy policy) const
+    -> xt::xarray<double>
+{
+    if (begin > end || end > n_frames())
+    {
+        throw std::runtime_error("Invalid range of frames");
+    }
+    const size_t n = n_atoms();
+    xt::xarray<double> xyz = xt::zeros<double>({end - begin, n, size_t{3}});
+    parallel_for(end - begin, resolve_n_threads(policy.n_threads), [&](size_t frame, size_t) {
+        read(begin + frame, xyz.data() + frame * 3 * n);
+    });
+    return xyz;
+}
+
+static constexpr char INDEX_MAGIC[8] = {'M', 'O', 'L', 'I', 'D', 'X', '1', '\0'};
+
+/// Modification time of `path`, used to detect stale sidecar files
+static auto modification_time(const std::string &path) -> int64_t
+{
+    return static_cast<int64_t>(std::filesystem::last_write_time(path).time_since_epoch().count());
+}
+
+FrameIndex::FrameIndex(const std::string &path, const MappedFile &file, const Scanner &scan)
+{
+    if (load(path, file.size()))
+    {
+        _from_sidecar = true;
+        return;
+    }
+    _offsets = scan(file);
+    save(path, file.size());
+}
+
+auto FrameIndex::sidecar_path(const std::string &path) -> std::string
+{
+    return path + ".molidx";
+}
+
+// The sidecar file holds the magic, the size and modification time of the
+// trajectory, the number of offsets and the offsets, all as 64-bit values.
+auto FrameIndex::load(const std::string &path, size_t file_size) -> bool
+{
+    std::ifstream file(sidecar_path(path), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    char magic[sizeof(INDEX_MAGIC)];
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char *>(&size), sizeof(size));
+    file.read(reinterpret_cast<char *>(&mtime), sizeof(mtime));
+    file.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if (!file || std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 || size != file_size || count == 0 ||
+        count > file_size + 1 || mtime != modification_time(path))
+    {
+        return false;
+    }
+    _offsets.resize(count);
+    file.read(reinterpret_cast<char *>(_offsets.data()), static_cast<std::streamsize>(count * sizeof(uint64_t)));
+    if (!file || !std::is_sorted(_offsets.begin(), _offsets.end()) || _offsets.back() > file_size)
+    {
+        _offsets.clear();
+        return false;
+    }
+    return true;
+}
+
+void FrameIndex::save(const std::string &path, size_t file_size) const
+{
+    // the index is only a cache: failing to write it, for example in a
+    // read-only directory, is not an error
+    try
+    {
+        auto sidecar = sidecar_path(path);
+        auto temporary = sidecar + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            uint64_t size = file_size;
+            int64_t mtime = modification_time(path);
+            uint64_t count = _offsets.size();
+            file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+            file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+            file.write(reinterpret_cast<const char *>(&mtime), sizeof(mtime));
+            file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+            file.write(reinterpret_cast<const char *>(_offsets.data()),
+                       static_cast<std::streamsize>(count * sizeof(uint64_t)));
+            if (!file)
+            {
+                return;
+            }
+        }
+        // readers opening the trajectory concurrently never see a partial index
+        std::error_code error;
+        std::filesystem::rename(temporary, sidecar, error);
+        if (error)
+        {
+            std::filesystem::remove(temporary, error);
+        }
+    }
+    catch (const std::exception &)
+    {
+    }
+}
+
+/// Box stored as a row-major matrix, all zeros meaning an infinite box
+static auto box_from_row_major(const double *values) -> Box
+{
+    if (std::all_of(values, values + 9, [](double v) { return v == 0.0; }))
+    {
+        return Box();
+    }
+    Mat3 matrix;
+    std::copy_n(values, 9, matrix.data());
+    return Box(matrix);
+}
+
+template <typename T> static auto load(const char *data) -> T
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+auto BinaryTrajectory::frame_bytes(size_t n_atoms, Precision precision) -> size_t
+{
+    size_t bytes = FRAME_HEADER_BYTES + 3 * n_atoms * static_cast<size_t>(precision);
+    return (bytes + 63) / 64 * 64;
+}
+
+BinaryTrajectory::BinaryTrajectory(const std::string &path) : _file(path)
+{
+    const char *data = _file.data();
+    if (_file.size() < HEADER_BYTES || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw std::runtime_error(path + " is not a molcpp binary trajectory");
+    }
+    if (load<uint32_t>(data + 8) != VERSION)
+    {
+        throw std::runtime_error("Unsupported binary trajectory version in " + path);
+    }
+    uint32_t precision = load<uint32_t>(data + 12);
+    if (precision != 4 && precision != 8)
+    {
+        throw std::runtime_error("Invalid precision in " + path);
+    }
+    _precision = static_cast<Precision>(precision);
+    _n_atoms = load<uint64_t>(data + 16);
+    _n_frames = load<uint64_t>(data + 24);
+    _frame_bytes = load<uint64_t>(data + 32);
+    if (_frame_bytes % 64 != 0 || _frame_bytes < frame_bytes(_n_atoms, _precision))
+    {
+        throw std::runtime_error("Invalid frame size in " + path);
+    }
+    if ((_file.size() - HEADER_BYTES) / _frame_bytes < _n_frames)
+    {
+        throw std::runtime_error(path + " is truncated");
+    }
+}
+
+auto BinaryTrajectory::box(size_t frame) const -> Box
+{
+    check_frame(frame);
+    return box_from_row_major(reinterpret_cast<const double *>(frame_data(frame)));
+}
+
+auto BinaryTrajectory::read(size_t frame, double *xyz) const -> Box
+{
+    check_frame(frame);
+    const char *positions = frame_data(frame) + FRAME_HEADER_BYTES;
+    if (_precision == Precision::FLOAT64)
+    {
+        std::memcpy(xyz, positions, 3 * _n_atoms * sizeof(double));
+    }
+    else
+    {
+        std::copy_n(reinterpret_cast<const float *>(positions), 3 * _n_atoms, xyz);
+    }
+    return box(frame);
+}
+
+BinaryTrajectoryWriter::BinaryTrajectoryWriter(const std::string &path, size_t n_atoms, Precision precision)
+    : _file(path, std::ios::binary | std::ios::trunc), _precision(precision), _n_atoms(n_atoms),
+      _buffer(BinaryTrajectory::frame_bytes(n_atoms, precision))
+{
+    if (!_file)
+    {
+        throw std::runtime_error("Could not open " + path);
+    }
+    if (precision != Precision::FLOAT32 && precision != Precision::FLOAT64)
+    {
+        throw std::runtime_error("Invalid precision");
+    }
+    char header[BinaryTrajectory::HEADER_BYTES] = {};
+    uint32_t version = VERSION;
+    auto bytes = static_cast<uint32_t>(precision);
+    uint64_t atoms = n_atoms;
+    uint64_t frames = 0;
+    uint64_t frame_bytes = _buffer.size();
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    std::memcpy(header + 8, &version, sizeof(version));
+    std::memcpy(header + 12, &bytes, sizeof(bytes));
+    std::memcpy(header + 16, &atoms, sizeof(atoms));
+    std::memcpy(header + 24, &frames, sizeof(frames));
+    std::memcpy(header + 32, &frame_bytes, sizeof(frame_bytes));
+    _file.write(header, sizeof(header));
+}
+
+BinaryTrajectoryWriter::~BinaryTrajectoryWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+    }
+}
+
+void BinaryTrajectoryWriter::write(const double *xyz, const Box &box)
+{
+    if (!_file.is_open())
+    {
+        throw std::runtime_error("Writing to a closed trajectory");
+    }
+    std::fill(_buffer.begin(), _buffer.end(), 0);
+    Mat3 matrix = box.get_matrix();
+    std::memcpy(_buffer.data(), matrix.data(), 9 * sizeof(double));
+    char *positions = _buffer.data() + BinaryTrajectory::FRAME_HEADER_BYTES;
+    if (_precision == Precision::FLOAT64)
+    {
+        std::memcpy(positions, xyz, 3 * _n_atoms * sizeof(double));
+    }
+    else
+    {
+        for (size_t i = 0; i < 3 * _n_atoms; i++)
+        {
+            auto value = static_cast<float>(xyz[i]);
+            std::memcpy(positions + i * sizeof(float), &value, sizeof(float));
+        }
+    }
+    _file.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+    if (!_file)
+    {
+        throw std::runtime_error("Could not write frame");
+    }
+    _n_frames++;
+}
+
+void BinaryTrajectoryWriter::write(const xt::xarray<double> &xyz, const Box &box)
+{
+    if (xyz.dimension() != 2 || xyz.shape(0) != _n_atoms || xyz.shape(1) != 3)
+    {
+        throw std::runtime_error("Positions must have shape (n_atoms, 3)");
+    }
+    write(xyz.data(), box);
+}
+
+void BinaryTrajectoryWriter::close()
+{
+    if (!_file.is_open())
+    {
+        return;
+    }
+    uint64_t frames = _n_frames;
+    _file.seekp(24);
+    _file.write(reinterpret_cast<const char *>(&frames), sizeof(frames));
+    _file.close();
+    if (!_file)
+    {
+        throw std::runtime_error("Could not finish writing the trajectory");
+    }
+}
+
+auto xyz_to_binary(const std::string &xyz_path, const std::string &path, const Box &box,
+                   BinaryTrajectory::Precision precision) -> size_t
+{
+    ExtendedXYZTrajectory xyz(xyz_path);
+    if (xyz.n_frames() == 0)
+    {
+        throw std::runtime_error("Invalid XYZ file: no frame in " + xyz_path);
+    }
+
+    BinaryTrajectoryWriter writer(path, xyz.n_atoms(), precision);
+    std::vector<double> positions(3 * xyz.n_atoms());
+    for (size_t frame = 0; frame < xyz.n_frames(); frame++)
+    {
+        Box frame_box = xyz.read(frame, positions.data());
+        writer.write(positions.data(), frame_box.get_style() == Box::FREE ? box : frame_box);
+    }
+    writer.close();
+    return writer.n_frames();
+}
+
+} // namespace molcpp
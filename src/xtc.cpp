@@ -0,0 +1,425 @@
+#include "molcpp/trajectory.hpp"
+#include "byteswap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// XTC decompression follows the algorithm of the xdrfile library from
+// GROMACS: positions are rounded to integers at the precision of the file,
+// and consecutive atoms close to each other are stored as small differences
+// packed with a mixed radix.
+
+namespace molcpp
+{
+
+// XTC files are written with XDR, which is big-endian
+static constexpr bool XTC_SWAP = true;
+static constexpr int32_t XTC_MAGIC = 1995;
+// magic, atoms, step, time, box and atoms again
+static constexpr size_t XTC_HEADER_BYTES = 56;
+// precision, minimal and maximal integers, small index and byte count
+static constexpr size_t XTC_COMPRESSED_HEADER_BYTES = XTC_HEADER_BYTES + 36;
+// frames with at most this number of atoms are not compressed
+static constexpr size_t XTC_MAX_UNCOMPRESSED = 9;
+
+static constexpr int XTC_FIRST_INDEX = 9;
+static constexpr uint32_t XTC_MAGIC_INTS[] = {
+    0,        0,        0,       0,       0,       0,       0,       0,       0,       8,       10,      12,
+    16,       20,       25,      32,      40,      50,      64,      80,      101,     128,     161,     203,
+    256,      322,      406,     512,     645,     812,     1024,    1290,    1625,    2048,    2580,    3250,
+    4096,     5060,     6501,    8192,    10321,   13003,   16384,   20642,   26007,   32768,   41285,   52015,
+    65536,    82570,    104031,  131072,  165140,  208063,  262144,  330280,  416127,  524287,  660561,  832255,
+    1048576,  1321122,  1664510, 2097152, 2642245, 3329021, 4194304, 5284491, 6658042, 8388607, 10568983, 13316085,
+    16777216};
+static constexpr int XTC_LAST_INDEX = sizeof(XTC_MAGIC_INTS) / sizeof(XTC_MAGIC_INTS[0]);
+
+static auto load_int(const char *data) -> int32_t
+{
+    return detail::load32<int32_t>(data, XTC_SWAP);
+}
+
+static auto load_float(const char *data) -> float
+{
+    return detail::load32<float>(data, XTC_SWAP);
+}
+
+/// Reads bits most significant first, keeping up to 64 of them in a
+/// register to avoid going back to memory for every field
+class BitReader
+{
+  public:
+    BitReader(const unsigned char *data, size_t size) : _data(data), _end(data + size)
+    {
+    }
+
+    /// Read the next `n_bits` bits, with `n_bits <= 32`
+    auto read(int n_bits) -> uint32_t
+    {
+        if (_n_bits < n_bits)
+        {
+            refill();
+            if (_n_bits < n_bits)
+            {
+                throw std::runtime_error("Corrupted XTC frame");
+            }
+        }
+        _n_bits -= n_bits;
+        return static_cast<uint32_t>((_bits >> _n_bits) & ((uint64_t{1} << n_bits) - 1));
+    }
+
+  private:
+    void refill()
+    {
+        while (_n_bits <= 56 && _data < _end)
+        {
+            _bits = (_bits << 8) | *_data++;
+            _n_bits += 8;
+        }
+    }
+
+    const unsigned char *_data;
+    const unsigned char *_end;
+    uint64_t _bits = 0;
+    int _n_bits = 0;
+};
+
+/// Number of bits needed to store `size`
+static auto bits_for_int(uint32_t size) -> int
+{
+    int n_bits = 0;
+    while (n_bits < 32 && (uint64_t{1} << n_bits) <= size)
+    {
+        n_bits++;
+    }
+    return n_bits;
+}
+
+/// Number of bits needed to store the product of `sizes`
+static auto bits_for_ints(const uint32_t *sizes) -> int
+{
+    // little-endian base 256 multiplication, as the product can exceed 64 bits
+    uint32_t bytes[32] = {1};
+    int n_bytes = 1;
+    for (int i = 0; i < 3; i++)
+    {
+        uint64_t carry = 0;
+        int k = 0;
+        for (; k < n_bytes; k++)
+        {
+            carry += uint64_t{bytes[k]} * sizes[i];
+            bytes[k] = carry & 0xff;
+            carry >>= 8;
+        }
+        for (; carry != 0; k++)
+        {
+            bytes[k] = carry & 0xff;
+            carry >>= 8;
+        }
+        n_bytes = k;
+    }
+    int n_bits = 0;
+    while ((uint32_t{1} << n_bits) <= bytes[n_bytes - 1])
+    {
+        n_bits++;
+    }
+    return n_bits + 8 * (n_bytes - 1);
+}
+
+/// Decode three integers packed in `n_bits` bits with the mixed radix
+/// `sizes`
+static void decode_ints(BitReader &reader, int n_bits, const uint32_t *sizes, int32_t *values)
+{
+    // the packed number is stored as little-endian bytes
+    if (n_bits <= 64)
+    {
+        uint64_t packed = 0;
+        int shift = 0;
+        for (; n_bits > 8; n_bits -= 8, shift += 8)
+        {
+            packed |= uint64_t{reader.read(8)} << shift;
+        }
+        if (n_bits > 0)
+        {
+            packed |= uint64_t{reader.read(n_bits)} << shift;
+        }
+        values[2] = static_cast<int32_t>(packed % sizes[2]);
+        packed /= sizes[2];
+        values[1] = static_cast<int32_t>(packed % sizes[1]);
+        values[0] = static_cast<int32_t>(packed / sizes[1]);
+        return;
+    }
+
+    uint32_t bytes[32] = {};
+    int n_bytes = 0;
+    for (; n_bits > 8; n_bits -= 8)
+    {
+        bytes[n_bytes++] = reader.read(8);
+    }
+    bytes[n_bytes++] = reader.read(n_bits);
+    for (int i = 2; i > 0; i--)
+    {
+        uint64_t remainder = 0;
+        for (int k = n_bytes - 1; k >= 0; k--)
+        {
+            remainder = (remainder << 8) | bytes[k];
+            bytes[k] = static_cast<uint32_t>(remainder / sizes[i]);
+            remainder %= sizes[i];
+        }
+        values[i] = static_cast<int32_t>(remainder);
+    }
+    values[0] = static_cast<int32_t>(bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24));
+}
+
+/// Decompress the positions of `n_atoms` atoms from the compressed block
+/// starting at `data`, right after the number of atoms
+static void decompress(const char *data, size_t n_atoms, double *xyz)
+{
+    const float precision = load_float(data);
+    if (!(precision > 0))
+    {
+        throw std::runtime_error("Invalid precision in XTC frame");
+    }
+    const float inv_precision = 1.0f / precision;
+
+    int32_t min_int[3];
+    int32_t max_int[3];
+    uint32_t sizes[3];
+    int bits[3];
+    for (size_t d = 0; d < 3; d++)
+    {
+        min_int[d] = load_int(data + 4 + 4 * d);
+        max_int[d] = load_int(data + 16 + 4 * d);
+        sizes[d] = static_cast<uint32_t>(max_int[d]) - static_cast<uint32_t>(min_int[d]) + 1;
+    }
+    // sizes too large to be packed together are stored separately
+    const bool large = (sizes[0] | sizes[1] | sizes[2]) > 0xffffff;
+    int packed_bits = 0;
+    if (large)
+    {
+        for (size_t d = 0; d < 3; d++)
+        {
+            bits[d] = bits_for_int(sizes[d]);
+        }
+    }
+    else
+    {
+        packed_bits = bits_for_ints(sizes);
+    }
+
+    int small_index = load_int(data + 28);
+    if (small_index < XTC_FIRST_INDEX || small_index >= XTC_LAST_INDEX)
+    {
+        throw std::runtime_error("Corrupted XTC frame");
+    }
+    int32_t smaller = static_cast<int32_t>(XTC_MAGIC_INTS[std::max(XTC_FIRST_INDEX, small_index - 1)] / 2);
+    int32_t small_num = static_cast<int32_t>(XTC_MAGIC_INTS[small_index] / 2);
+    uint32_t small_sizes[3] = {XTC_MAGIC_INTS[small_index], XTC_MAGIC_INTS[small_index], XTC_MAGIC_INTS[small_index]};
+
+    const auto n_bytes = static_cast<uint32_t>(load_int(data + 32));
+    BitReader reader(reinterpret_cast<const unsigned char *>(data + 36), n_bytes);
+
+    auto store = [&](const int32_t *coords, size_t atom) {
+        if (atom >= n_atoms)
+        {
+            throw std::runtime_error("Corrupted XTC frame");
+        }
+        for (size_t d = 0; d < 3; d++)
+        {
+            xyz[3 * atom + d] = static_cast<float>(coords[d]) * inv_precision;
+        }
+    };
+
+    // the run length is only sent when it changes
+    int run = 0;
+    size_t atom = 0;
+    while (atom < n_atoms)
+    {
+        int32_t coords[3];
+        if (large)
+        {
+            for (size_t d = 0; d < 3; d++)
+            {
+                coords[d] = static_cast<int32_t>(reader.read(bits[d]));
+            }
+        }
+        else
+        {
+            decode_ints(reader, packed_bits, sizes, coords);
+        }
+        int32_t previous[3];
+        for (size_t d = 0; d < 3; d++)
+        {
+            coords[d] += min_int[d];
+            previous[d] = coords[d];
+        }
+
+        int is_smaller = 0;
+        if (reader.read(1) == 1)
+        {
+            run = static_cast<int>(reader.read(5));
+            is_smaller = run % 3;
+            run -= is_smaller;
+            is_smaller--;
+        }
+
+        if (run > 0)
+        {
+            for (int k = 0; k < run; k += 3)
+            {
+                decode_ints(reader, small_index, small_sizes, coords);
+                for (size_t d = 0; d < 3; d++)
+                {
+                    coords[d] += previous[d] - small_num;
+                }
+                if (k == 0)
+                {
+                    // the first two atoms of a run are swapped by the
+                    // compressor, for better compression of water
+                    std::swap(coords, previous);
+                    store(previous, atom++);
+                }
+                else
+                {
+                    std::copy_n(coords, 3, previous);
+                }
+                store(coords, atom++);
+            }
+        }
+        else
+        {
+            store(coords, atom++);
+        }
+
+        small_index += is_smaller;
+        if (small_index < XTC_FIRST_INDEX || small_index >= XTC_LAST_INDEX)
+        {
+            throw std::runtime_error("Corrupted XTC frame");
+        }
+        if (is_smaller < 0)
+        {
+            small_num = smaller;
+            smaller = small_index > XTC_FIRST_INDEX ? static_cast<int32_t>(XTC_MAGIC_INTS[small_index - 1] / 2) : 0;
+        }
+        else if (is_smaller > 0)
+        {
+            smaller = small_num;
+            small_num = static_cast<int32_t>(XTC_MAGIC_INTS[small_index] / 2);
+        }
+        std::fill_n(small_sizes, 3, XTC_MAGIC_INTS[small_index]);
+    }
+}
+
+/// Offsets of the frames of an XTC file, found by reading the size of each
+/// frame from its header
+static auto scan_xtc(const MappedFile &file) -> std::vector<uint64_t>
+{
+    const char *data = file.data();
+    const size_t size = file.size();
+    std::vector<uint64_t> offsets;
+    size_t offset = 0;
+    int32_t n_atoms = -1;
+    while (offset + XTC_HEADER_BYTES <= size)
+    {
+        if (load_int(data + offset) != XTC_MAGIC)
+        {
+            throw std::runtime_error("Invalid XTC frame at byte " + std::to_string(offset));
+        }
+        int32_t frame_atoms = load_int(data + offset + 4);
+        if (frame_atoms < 0 || (n_atoms >= 0 && frame_atoms != n_atoms))
+        {
+            throw std::runtime_error("Number of atoms changed in XTC frame at byte " + std::to_string(offset));
+        }
+        n_atoms = frame_atoms;
+
+        size_t frame_bytes = 0;
+        if (static_cast<size_t>(n_atoms) <= XTC_MAX_UNCOMPRESSED)
+        {
+            frame_bytes = XTC_HEADER_BYTES + 12 * static_cast<size_t>(n_atoms);
+        }
+        else
+        {
+            if (offset + XTC_COMPRESSED_HEADER_BYTES > size)
+            {
+                break;
+            }
+            // opaque XDR data is padded to 4 bytes
+            auto n_bytes = static_cast<uint32_t>(load_int(data + offset + XTC_COMPRESSED_HEADER_BYTES - 4));
+            frame_bytes = XTC_COMPRESSED_HEADER_BYTES + (size_t{n_bytes} + 3) / 4 * 4;
+        }
+        // ignore a last frame which was not completely written
+        if (offset + frame_bytes > size)
+        {
+            break;
+        }
+        offsets.push_back(offset);
+        offset += frame_bytes;
+    }
+    offsets.push_back(offset);
+    return offsets;
+}
+
+XTCTrajectory::XTCTrajectory(const std::string &path) : _file(path), _index(path, _file, scan_xtc)
+{
+    if (_index.n_frames() != 0)
+    {
+        _n_atoms = static_cast<size_t>(load_int(_file.data() + _index.begin(0) + 4));
+    }
+}
+
+auto XTCTrajectory::get_step(size_t frame) const -> int32_t
+{
+    check_frame(frame);
+    return load_int(_file.data() + _index.begin(frame) + 8);
+}
+
+auto XTCTrajectory::get_time(size_t frame) const -> float
+{
+    check_frame(frame);
+    return load_float(_file.data() + _index.begin(frame) + 12);
+}
+
+auto XTCTrajectory::read(size_t frame, double *xyz) const -> Box
+{
+    check_frame(frame);
+    const char *data = _file.data() + _index.begin(frame);
+    if (load_int(data) != XTC_MAGIC || static_cast<size_t>(load_int(data + 52)) != _n_atoms)
+    {
+        throw std::runtime_error("Invalid XTC frame " + std::to_string(frame));
+    }
+
+    if (_n_atoms <= XTC_MAX_UNCOMPRESSED)
+    {
+        for (size_t i = 0; i < 3 * _n_atoms; i++)
+        {
+            xyz[i] = load_float(data + XTC_HEADER_BYTES + 4 * i);
+        }
+    }
+    else
+    {
+        decompress(data + XTC_HEADER_BYTES, _n_atoms, xyz);
+    }
+
+    // box vectors are the rows of the matrix
+    double vectors[3][3];
+    for (size_t i = 0; i < 9; i++)
+    {
+        vectors[i / 3][i % 3] = load_float(data + 16 + 4 * i);
+    }
+    auto dot = [&](size_t i, size_t j) {
+        return vectors[i][0] * vectors[j][0] + vectors[i][1] * vectors[j][1] + vectors[i][2] * vectors[j][2];
+    };
+    Vec3 lengths = {std::sqrt(dot(0, 0)), std::sqrt(dot(1, 1)), std::sqrt(dot(2, 2))};
+    if (lengths(0) == 0 && lengths(1) == 0 && lengths(2) == 0)
+    {
+        return Box();
+    }
+    // 90 - asin(x) rather than acos(x) gives exactly 90 degrees for
+    // orthogonal boxes
+    auto angle = [&](size_t i, size_t j) {
+        return 90.0 - std::asin(std::clamp(dot(i, j) / (lengths(i) * lengths(j)), -1.0, 1.0)) * 180.0 / pi;
+    };
+    return Box::from_lengths_angles(lengths, {angle(1, 2), angle(0, 2), angle(0, 1)});
+}
+
+} // namespace molcpp
@@ -1,9 +1,17 @@
 #include "doctest/doctest.h"
 #include "molcpp/box.hpp"
+#include "molcpp/simd.hpp"
+#include "molcpp/topology.hpp"
 #include "molcpp/types.hpp"
 
 #include <xtensor/xarray.hpp>
 #include <xtensor/xbuilder.hpp>
+#include <xtensor/xrandom.hpp>
+#include <xtensor/xview.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 using namespace molcpp;
 
@@ -200,6 +208,21 @@ TEST_CASE("TestBoxSetterGetter")
         cell.set_angles({80, 120, 60});
         CHECK(xt::allclose(cell.get_angles(), Vec3({80, 120, 60}), 1e-12));
     }
+
+    SUBCASE("test_set_lengths_tilts")
+    {
+        // LAMMPS lx, ly, lz and xy, xz, yz
+        auto cell = Box();
+        cell.set_lengths_tilts({10, 12, 14}, {1, 2, 3});
+        CHECK(cell.get_style() == Box::TRICLINIC);
+        CHECK(cell.get_matrix() == Mat3({{10, 1, 2}, {0, 12, 3}, {0, 0, 14}}));
+        CHECK(cell.get_volume() == doctest::Approx(10 * 12 * 14));
+        CHECK(cell.get_lengths()(1) == doctest::Approx(std::sqrt(1 + 144)));
+
+        cell.set_lengths_tilts({10, 12, 14}, {0, 0, 0});
+        CHECK(cell.get_style() == Box::ORTHOGONAL);
+        CHECK_THROWS(cell.set_lengths_tilts({0, 12, 14}, {0, 0, 0}));
+    }
 }
 
 TEST_CASE("TestBoxBoundary")
@@ -235,3 +258,266 @@ TEST_CASE("TestBoxDimension")
         CHECK(xt::allclose(triclinic.get_distance_between_faces(), Vec3({10*sind(80), 11*sind(80), 12}), 1e-5));
     }
 }
+
+TEST_CASE("TestBoxCache")
+{
+    SUBCASE("test_inverse")
+    {
+        Box ortho({10, 11, 12});
+        CHECK(xt::allclose(xt::linalg::dot(ortho.get_inv(), ortho.get_matrix()), xt::eye<double>(3)));
+
+        Box triclinic = Box::from_lengths_angles({10, 11, 12}, {70, 80, 120});
+        CHECK(xt::allclose(triclinic.get_inv(), xt::linalg::inv(triclinic.get_matrix())));
+    }
+
+    SUBCASE("test_setters_refresh_cache")
+    {
+        Box cell({10, 10, 10});
+        CHECK(cell.get_volume() == 1000);
+
+        cell.set_lengths({10, 15, 20});
+        CHECK(cell.get_volume() == 3000);
+        CHECK(xt::allclose(cell.wrap(Vec3({16, 16, 16})), Vec3({-4, 1, -4})));
+
+        cell.set_angles({90, 90, 80});
+        CHECK(cell.get_style() == Box::TRICLINIC);
+        CHECK(xt::allclose(cell.get_volume(), 3000 * sind(80)));
+        CHECK(xt::allclose(cell.get_distance_between_faces(), Vec3({10 * sind(80), 15 * sind(80), 20}), 1e-5));
+
+        cell.set_matrix(xt::diag(Vec3({5, 5, 5})));
+        CHECK(cell.get_style() == Box::ORTHOGONAL);
+        CHECK(cell.get_lengths() == Vec3({5, 5, 5}));
+    }
+}
+
+TEST_CASE("TestBoxInplace")
+{
+    SUBCASE("test_wrap_inplace")
+    {
+        Box infinite;
+        Box ortho({10, 11, 12});
+        Box triclinic = Box::from_lengths_angles({10, 11, 12}, {90, 90, 80});
+        Box tilted = Box::from_lengths_angles({10, 10, 10}, {140, 100, 100});
+
+        xt::xarray<double> xyz = {
+            {22.0, -15.0,  5.8},
+            { 6.0,   8.0, -7.0},
+            {-3.0,  40.0, 13.0}
+        };
+        for (const auto &box : {infinite, ortho, triclinic, tilted})
+        {
+            xt::xarray<double> inplace = xyz;
+            box.wrap_inplace(inplace.data(), 3);
+            CHECK(xt::allclose(inplace, box.wrap(xyz)));
+
+            std::vector<double> buffer(xyz.begin(), xyz.end());
+            box.wrap_inplace(std::span<double>(buffer));
+            CHECK(std::equal(buffer.begin(), buffer.end(), inplace.begin()));
+        }
+        CHECK_THROWS(ortho.wrap_inplace(std::span<double>(xyz.data(), 4)));
+    }
+
+    SUBCASE("test_wrap_faces")
+    {
+        // points on a face go to the lower face whatever their image, so
+        // they stay inside the box after wrapping
+        Box box({8, 8, 8});
+        xt::xarray<double> xyz = {
+            { 4.0, 12.0, -4.0},
+            {-4.0, 20.0,  4.0}
+        };
+        xt::xarray<double> expected = {
+            {-4.0, -4.0, -4.0},
+            {-4.0, -4.0, -4.0}
+        };
+        CHECK(box.wrap(xyz) == expected);
+
+        box.wrap_inplace(xyz.data(), 2);
+        CHECK(xyz == expected);
+        bool mask[2];
+        box.isin(xyz.data(), 2, mask);
+        CHECK(mask[0]);
+        CHECK(mask[1]);
+
+        xt::xarray<float> xyz_float = {{4.0f, 12.0f, -4.0f}};
+        box.wrap_inplace(xyz_float.data(), 1);
+        CHECK(xyz_float == xt::xarray<float>{{-4.0f, -4.0f, -4.0f}});
+    }
+
+    SUBCASE("test_isin_inplace")
+    {
+        Box triclinic = Box::from_lengths_angles({10, 11, 12}, {90, 90, 80});
+        xt::xarray<double> xyz = {
+            {22.0, -15.0,  5.8},
+            { 1.0,   1.0, -1.0}
+        };
+        bool mask[2];
+        triclinic.isin(xyz.data(), 2, mask);
+        CHECK(!mask[0]);
+        CHECK(mask[1]);
+
+        triclinic.wrap_inplace(xyz.data(), 2);
+        triclinic.isin(xyz.data(), 2, mask);
+        CHECK(mask[0]);
+        CHECK(mask[1]);
+    }
+
+    SUBCASE("test_isin")
+    {
+        Box box({10, 11, 12});
+        xt::xarray<double> xyz = {
+            {22.0, -15.0,  5.8},
+            { 1.0,   1.0, -1.0},
+            { 4.9,  -5.5,  5.9}
+        };
+        CHECK(box.isin(xyz) == xt::xarray<bool>{false, true, true});
+        CHECK(Box().isin(xyz) == xt::xarray<bool>{true, true, true});
+
+        // crosses a word of the bitmask, and a vector width
+        const size_t n = 203;
+        xt::xarray<double> many = xt::random::rand<double>({n, size_t{3}}, -10, 10);
+        xt::xarray<double> wrapped = box.wrap(many);
+        xt::xarray<bool> mask = box.isin(many);
+        for (size_t i = 0; i < n; i++)
+        {
+            // positions inside the box are left unchanged by `wrap`
+            bool inside = wrapped(i, 0) == many(i, 0) && wrapped(i, 1) == many(i, 1) && wrapped(i, 2) == many(i, 2);
+            CHECK(mask(i) == inside);
+        }
+    }
+
+    SUBCASE("test_unwrap_inplace")
+    {
+        Box triclinic = Box::from_lengths_angles({10, 11, 12}, {90, 90, 80});
+        xt::xarray<double> xyz = {
+            {22.0, -15.0,  5.8}
+        };
+        xt::xarray<double> wrapped = triclinic.wrap(xyz);
+
+        xt::xarray<int> images =
+            xt::transpose(xt::round(xt::linalg::dot(triclinic.get_inv(), xt::transpose(xyz - wrapped))));
+        xt::xarray<double> unwrapped = wrapped;
+        triclinic.unwrap_inplace(unwrapped.data(), images.data(), 1);
+        CHECK(xt::allclose(unwrapped, xyz));
+
+        xt::xarray<double> reference = xyz + 0.5;
+        unwrapped = wrapped;
+        triclinic.unwrap_inplace(unwrapped.data(), reference.data(), 1);
+        CHECK(xt::allclose(unwrapped, xyz));
+    }
+
+    SUBCASE("test_update_images")
+    {
+        Box triclinic = Box::from_lengths_angles({10, 11, 12}, {90, 90, 80});
+        // a trajectory moving by less than half the box per frame
+        xt::xarray<double> start = {{1.0, 2.0, 3.0}, {-4.0, 5.0, -5.5}};
+        xt::xarray<double> step = {{1.5, -2.0, 2.5}, {-3.0, 1.0, -2.0}};
+        xt::xarray<double> previous = triclinic.wrap(start);
+        xt::xarray<int> images = xt::zeros<int>({2, 3});
+        for (int frame = 1; frame <= 20; frame++)
+        {
+            xt::xarray<double> xyz = start + frame * step;
+            xt::xarray<double> wrapped = triclinic.wrap(xyz);
+            triclinic.update_images(wrapped.data(), previous.data(), images.data(), 2, ExecutionPolicy{2});
+            previous = wrapped;
+
+            // the first frame was wrapped too, so unwrap to its own image
+            xt::xarray<double> unwrapped = wrapped;
+            triclinic.unwrap_inplace(unwrapped.data(), images.data(), 2);
+            CHECK(xt::allclose(unwrapped - xt::xarray<double>(triclinic.wrap(start)), xyz - start));
+        }
+    }
+
+    SUBCASE("test_make_whole")
+    {
+        Box box = Box::from_lengths_angles({10, 11, 12}, {90, 90, 80});
+        // two chains with bonds of 1.5 along x and y, and an isolated atom
+        const size_t n = 9;
+        xt::xarray<double> whole = xt::zeros<double>({n, size_t{3}});
+        for (size_t i = 0; i < 5; i++)
+        {
+            whole(i, 0) = 7.0 + 1.5 * i;
+            whole(i, 2) = 0.5 * i;
+        }
+        for (size_t i = 5; i < 8; i++)
+        {
+            whole(i, 1) = -6.0 - 1.5 * (i - 5);
+        }
+        whole(8, 0) = 3.0;
+        Topology topology(n);
+        std::vector<Bond> bonds = {{0, 1}, {2, 1}, {2, 3}, {4, 3}, {6, 7}, {5, 6}};
+        topology.set_bonds(bonds);
+
+        xt::xarray<double> xyz = box.wrap(whole);
+        box.make_whole(xyz.data(), n, topology, ExecutionPolicy{2});
+        // each molecule is whole, around its (wrapped) first atom
+        xt::xarray<double> shift = xt::view(xyz, 0) - xt::view(whole, 0);
+        CHECK(xt::allclose(xt::view(xyz, xt::range(0, 5)), xt::view(whole, xt::range(0, 5)) + shift));
+        shift = xt::view(xyz, 5) - xt::view(whole, 5);
+        CHECK(xt::allclose(xt::view(xyz, xt::range(5, 8)), xt::view(whole, xt::range(5, 8)) + shift));
+        CHECK(xt::allclose(xt::view(xyz, 8), xt::view(box.wrap(whole), 8)));
+    }
+}
+
+TEST_CASE("TestBoxMic")
+{
+    SUBCASE("test_mic_matches_wrap")
+    {
+        const size_t n = 37; // not a multiple of the vector width
+        xt::random::seed(42);
+        xt::xarray<double> ri = xt::random::rand<double>({size_t{3}, n}, -30, 30);
+        xt::xarray<double> rj = xt::random::rand<double>({size_t{3}, n}, -30, 30);
+        SoA3<const double> pi{&ri(0, 0), &ri(1, 0), &ri(2, 0)};
+        SoA3<const double> pj{&rj(0, 0), &rj(1, 0), &rj(2, 0)};
+
+        for (const auto &box : {Box(), Box({10, 11, 12}), Box::from_lengths_angles({10, 11, 12}, {70, 80, 120})})
+        {
+            xt::xarray<double> expected = box.wrap(xt::transpose(rj - ri));
+            for (auto level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512})
+            {
+                set_simd_level(level);
+                xt::xarray<double> d = xt::zeros<double>({size_t{3}, n});
+                xt::xarray<double> r2 = xt::zeros<double>({n});
+                box.mic_displacements(pi, pj, n, {&d(0, 0), &d(1, 0), &d(2, 0)});
+                box.mic_distances2(pi, pj, n, r2.data());
+                CHECK(xt::allclose(xt::transpose(d), expected));
+                CHECK(xt::allclose(r2, xt::sum(expected * expected, {1})));
+            }
+            set_simd_level(detect_simd_level());
+        }
+    }
+
+    SUBCASE("test_float")
+    {
+        // float storage, with images found in double: the results are the
+        // double results of the same positions, rounded to float
+        const size_t n = 37;
+        xt::random::seed(42);
+        xt::xarray<float> ri = xt::random::rand<double>({size_t{3}, n}, -30, 30);
+        xt::xarray<float> rj = xt::random::rand<double>({size_t{3}, n}, -30, 30);
+        xt::xarray<double> ri_double = ri;
+        xt::xarray<double> rj_double = rj;
+
+        for (const auto &box : {Box(), Box({10, 11, 12}), Box::from_lengths_angles({10, 11, 12}, {70, 80, 120})})
+        {
+            for (auto level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512})
+            {
+                set_simd_level(level);
+                xt::xarray<double> expected = xt::zeros<double>({n});
+                box.mic_distances2({&ri_double(0, 0), &ri_double(1, 0), &ri_double(2, 0)},
+                                   {&rj_double(0, 0), &rj_double(1, 0), &rj_double(2, 0)}, n, expected.data());
+                xt::xarray<float> r2 = xt::zeros<float>({n});
+                box.mic_distances2(SoA3<const float>{&ri(0, 0), &ri(1, 0), &ri(2, 0)},
+                                   SoA3<const float>{&rj(0, 0), &rj(1, 0), &rj(2, 0)}, n, r2.data());
+                CHECK(r2 == xt::cast<float>(expected));
+            }
+            set_simd_level(detect_simd_level());
+
+            xt::xarray<float> xyz = xt::transpose(ri);
+            xt::xarray<double> expected = xt::transpose(ri_double);
+            box.wrap_inplace(xyz.data(), n);
+            box.wrap_inplace(expected.data(), n);
+            CHECK(xyz == xt::cast<float>(expected));
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#include "doctest/doctest.h"
+#include "molcpp/box_series.hpp"
+
+#include <xtensor/xarray.hpp>
+#include <xtensor/xrandom.hpp>
+#include <xtensor/xview.hpp>
+
+#include <vector>
+
+using namespace molcpp;
+
+/// An orthogonal, a triclinic and a free box, as a NPT trajectory could have
+static auto make_boxes() -> std::vector<Box>
+{
+    return {Box({10, 11, 12}), Box::from_lengths_angles({10, 11, 12}, {90, 80, 120}), Box(),
+            Box::from_lengths_angles({9.5, 11.5, 12.5}, {70, 95, 100})};
+}
+
+TEST_CASE("TestBoxSeries")
+{
+    const auto boxes = make_boxes();
+    BoxSeries series(boxes);
+    REQUIRE(series.n_frames() == boxes.size());
+
+    SUBCASE("test_properties")
+    {
+        auto volumes = series.get_volumes();
+        auto lengths = series.get_lengths();
+        auto angles = series.get_angles();
+        for (size_t frame = 0; frame < boxes.size(); frame++)
+        {
+            const auto &box = boxes[frame];
+            CHECK(series.get_style(frame) == box.get_style());
+            CHECK(series.get_box(frame) == box);
+            CHECK(volumes(frame) == doctest::Approx(box.get_volume()));
+            for (size_t d = 0; d < 3; d++)
+            {
+                CHECK(lengths(frame, d) == doctest::Approx(box.get_lengths()(d)));
+                CHECK(angles(frame, d) == doctest::Approx(box.get_angles()(d)));
+            }
+        }
+    }
+
+    SUBCASE("test_from_matrices")
+    {
+        auto matrices = series.get_matrices();
+        CHECK(matrices.shape(0) == boxes.size());
+        BoxSeries copy(matrices);
+        CHECK(copy.n_frames() == boxes.size());
+        for (size_t frame = 0; frame < boxes.size(); frame++)
+        {
+            CHECK(copy.get_box(frame) == boxes[frame]);
+        }
+    }
+
+    SUBCASE("test_wrap")
+    {
+        // more atoms than a block, so frames are split in several tasks
+        const size_t n_atoms = 5000;
+        xt::random::seed(42);
+        xt::xarray<double> xyz = xt::random::rand<double>({boxes.size(), n_atoms, size_t{3}}, -50, 50);
+        auto wrapped = series.wrap(xyz, 0, {4});
+        for (size_t frame = 0; frame < boxes.size(); frame++)
+        {
+            xt::xarray<double> expected = xt::view(xyz, frame);
+            boxes[frame].wrap_inplace(expected.data(), n_atoms);
+            CHECK(xt::allclose(xt::view(wrapped, frame), expected));
+        }
+
+        // a chunk of frames starting past the first one
+        xt::xarray<double> chunk = xt::view(xyz, xt::range(1, 3));
+        series.wrap_inplace(chunk.data(), 1, 2, n_atoms);
+        CHECK(xt::allclose(chunk, xt::view(wrapped, xt::range(1, 3))));
+    }
+
+    SUBCASE("test_errors")
+    {
+        const double lower[9] = {1, 0, 0, 1, 1, 0, 0, 0, 1};
+        CHECK_THROWS(series.push_back(lower));
+        const double singular[9] = {1, 0, 0, 0, 0, 0, 0, 0, 1};
+        CHECK_THROWS(series.push_back(singular));
+        CHECK(series.n_frames() == boxes.size());
+        CHECK_THROWS(series.get_box(boxes.size()));
+        CHECK_THROWS(series.wrap(xt::zeros<double>({boxes.size() + 1, size_t{2}, size_t{3}})));
+    }
+}
@@ -0,0 +1,87 @@
+#include "doctest/doctest.h"
+#include "molcpp/box_view.hpp"
+
+#include <xtensor/xarray.hpp>
+#include <xtensor/xrandom.hpp>
+
+#include <type_traits>
+#include <vector>
+
+using namespace molcpp;
+
+// kernels of a view are usable in constant expressions
+constexpr BoxView<Box::ORTHOGONAL> cubic({10, 0, 0, 10, 0, 10}, {0.1, 0, 0, 0.1, 0, 0.1});
+constexpr double near_face[3] = {1, 1, 1};
+constexpr double far_face[3] = {9, 1, 1};
+static_assert(cubic.distance2(near_face, far_face) == 4.0);
+static_assert(detail::round_half_up(2.5) == 3.0 && detail::round_half_up(-3.5) == -3.0);
+static_assert(detail::round_half_up(-0.5) == 0.0 && detail::round_half_up(-2.6) == -3.0);
+// a point on a face goes to the lower face, whatever its image
+constexpr auto wrapped_x(double x)
+{
+    double r[3] = {x, 0, 0};
+    cubic.wrap(r);
+    return r[0];
+}
+static_assert(wrapped_x(5) == -5 && wrapped_x(15) == -5 && wrapped_x(-5) == -5);
+
+TEST_CASE("TestBoxView")
+{
+    Box infinite;
+    Box ortho({10, 11, 12});
+    Box triclinic = Box::from_lengths_angles({10, 11, 12}, {90, 80, 120});
+
+    const size_t n = 1001;
+    xt::random::seed(42);
+    xt::xarray<double> xyz = xt::random::rand<double>({n, size_t{3}}, -40, 40);
+    xt::xarray<double> other = xt::random::rand<double>({n, size_t{3}}, -40, 40);
+
+    SUBCASE("test_wrap")
+    {
+        for (const auto &box : {infinite, ortho, triclinic})
+        {
+            xt::xarray<double> expected = xyz;
+            box.wrap_inplace(expected.data(), n);
+            xt::xarray<double> wrapped = xyz;
+            visit_box(box, [&](const auto &view) { view.wrap_inplace(wrapped.data(), n); });
+            CHECK(xt::allclose(wrapped, expected));
+        }
+    }
+
+    SUBCASE("test_distances")
+    {
+        // SoA copies of the positions
+        xt::xarray<double> ri = xt::transpose(xyz);
+        xt::xarray<double> rj = xt::transpose(other);
+        SoA3<const double> i = {ri.data(), ri.data() + n, ri.data() + 2 * n};
+        SoA3<const double> j = {rj.data(), rj.data() + n, rj.data() + 2 * n};
+        xt::xarray<float> rif = ri;
+        xt::xarray<float> rjf = rj;
+        SoA3<const float> i_float = {rif.data(), rif.data() + n, rif.data() + 2 * n};
+        SoA3<const float> j_float = {rjf.data(), rjf.data() + n, rjf.data() + 2 * n};
+        for (const auto &box : {infinite, ortho, triclinic})
+        {
+            std::vector<double> expected(n);
+            box.mic_distances2(i, j, n, expected.data());
+
+            std::vector<double> r2(n);
+            visit_box(box, [&](const auto &view) { view.mic_distances2(i, j, n, r2.data()); });
+            std::vector<float> r2_float(n);
+            visit_box<float>(box, [&](const auto &view) { view.mic_distances2(i_float, j_float, n, r2_float.data()); });
+            for (size_t k = 0; k < n; k++)
+            {
+                CHECK(r2[k] == doctest::Approx(expected[k]));
+                CHECK(r2_float[k] == doctest::Approx(expected[k]).epsilon(1e-4));
+            }
+        }
+    }
+
+    SUBCASE("test_visit")
+    {
+        auto style = [](const auto &view) { return std::decay_t<decltype(view)>::style; };
+        CHECK(visit_box(infinite, style) == Box::FREE);
+        CHECK(visit_box(ortho, style) == Box::ORTHOGONAL);
+        CHECK(visit_box(triclinic, style) == Box::TRICLINIC);
+        CHECK_THROWS(BoxView<Box::ORTHOGONAL>(triclinic));
+    }
+}
@@ -0,0 +1,165 @@
+#include "doctest/doctest.h"
+#include "molcpp/engine.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <xtensor/xrandom.hpp>
+#include <xtensor/xview.hpp>
+
+using namespace molcpp;
+
+/// Compute recording the calls of the engine
+class RecordingCompute : public Compute<RecordingCompute, Result1D<double>>
+{
+  public:
+    explicit RecordingCompute(FrameRequirements requirements = {}, bool use_neighbors = false)
+        : _requirements(requirements), _use_neighbors(use_neighbors)
+    {
+    }
+
+    auto requirements() const -> FrameRequirements
+    {
+        return _requirements;
+    }
+
+    void begin(size_t n_atoms)
+    {
+        calls.push_back("begin " + std::to_string(n_atoms));
+    }
+
+    void accumulate(const FrameContext &frame)
+    {
+        calls.push_back("frame " + std::to_string(frame.index()));
+        if (_requirements.wrapped)
+        {
+            std::vector<double> expected(frame.positions(), frame.positions() + 3 * frame.n_atoms());
+            frame.box().wrap_inplace(expected.data(), frame.n_atoms());
+            wrapped_ok &= std::equal(expected.begin(), expected.end(), frame.wrapped_positions());
+        }
+        if (_use_neighbors)
+        {
+            n_pairs += frame.neighbors().n_pairs();
+        }
+    }
+
+    void finalize()
+    {
+        calls.push_back("finalize");
+    }
+
+    std::vector<std::string> calls;
+    bool wrapped_ok = true;
+    size_t n_pairs = 0;
+
+  private:
+    FrameRequirements _requirements;
+    bool _use_neighbors;
+};
+
+TEST_CASE("TestComputeEngine")
+{
+    xt::random::seed(3);
+    const size_t n_frames = 6;
+    const size_t n_atoms = 300;
+    Box box({15, 15, 15});
+    xt::xarray<double> xyz = xt::random::rand<double>({n_frames, n_atoms, size_t{3}}, -5, 20);
+    std::vector<int> types(n_atoms);
+    for (size_t i = 0; i < n_atoms; i++)
+    {
+        types[i] = static_cast<int>(i % 2);
+    }
+
+    SUBCASE("test_hooks")
+    {
+        RecordingCompute plain;
+        RecordingCompute shared({4.0, true}, true);
+        ComputeEngine engine;
+        engine.add(plain);
+        engine.add(shared);
+        CHECK(engine.n_computes() == 2);
+        engine.run(xt::xarray<double>(xt::view(xyz, xt::range(0, 2))), box);
+
+        std::vector<std::string> expected = {"begin 300", "frame 0", "frame 1", "finalize"};
+        CHECK(plain.calls == expected);
+        CHECK(shared.calls == expected);
+        CHECK(shared.wrapped_ok);
+        CHECK(shared.n_pairs > 0);
+        CHECK(engine.get_compute_times().size() == 2);
+
+        // intermediates nobody asked for are not computed
+        RecordingCompute greedy({}, true);
+        ComputeEngine other;
+        other.add(greedy);
+        other.begin(n_atoms);
+        CHECK_THROWS_WITH(other.accumulate(0, xyz.data(), n_atoms, box),
+                          "Neighbor list was not requested by any compute");
+    }
+
+    SUBCASE("test_fused_matches_separate")
+    {
+        RDFCompute rdf_all(6.0, 30);
+        RDFCompute rdf_pair(4.0, 20);
+        rdf_pair.select_pair(0, 1);
+        StreamingMSDCompute msd(4, 2);
+
+        ComputeEngine engine({2});
+        engine.set_types(types);
+        engine.add(rdf_all);
+        engine.add(rdf_pair);
+        engine.add(msd);
+        engine.run(xyz, box);
+
+        RDFCompute separate_all(6.0, 30);
+        RDFCompute separate_pair(4.0, 20);
+        separate_pair.select_pair(0, 1);
+        StreamingMSDCompute separate_msd(4, 2);
+        for (size_t frame = 0; frame < n_frames; frame++)
+        {
+            const double *positions = xyz.data() + frame * 3 * n_atoms;
+            separate_all.push_frame(positions, n_atoms, box);
+            separate_pair.push_frame(positions, n_atoms, box, types.data());
+            separate_msd.push_frame(positions, n_atoms, box);
+        }
+
+        CHECK(rdf_all.n_frames() == n_frames);
+        CHECK(rdf_all.get_pair_counts() == separate_all.get_pair_counts());
+        CHECK(xt::allclose(rdf_pair.get_result().get(), separate_pair.get_result().get()));
+        CHECK(msd.get_result().get("streaming_msd") == separate_msd.get_result().get("streaming_msd"));
+    }
+
+    SUBCASE("test_trajectory")
+    {
+        auto path = (std::filesystem::temp_directory_path() / "molcpp_test_engine.moltraj").string();
+        {
+            BinaryTrajectoryWriter writer(path, n_atoms);
+            for (size_t frame = 0; frame < n_frames; frame++)
+            {
+                writer.write(xyz.data() + frame * 3 * n_atoms, box);
+            }
+        }
+        BinaryTrajectory trajectory(path);
+
+        RDFCompute from_file(5.0, 25);
+        RDFCompute from_array(5.0, 25);
+        ComputeEngine engine;
+        engine.add(from_file);
+        engine.run(trajectory);
+        CHECK(from_file.n_frames() == n_frames);
+
+        ComputeEngine array_engine;
+        array_engine.add(from_array);
+        array_engine.run(xyz, box);
+        CHECK(from_file.get_pair_counts() == from_array.get_pair_counts());
+
+        std::filesystem::remove(path);
+    }
+
+    SUBCASE("test_invalid")
+    {
+        ComputeEngine engine;
+        engine.set_types({0, 1});
+        CHECK_THROWS_WITH(engine.run(xyz, box), "Number of types does not match the number of atoms");
+    }
+}
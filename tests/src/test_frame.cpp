@@ -0,0 +1,125 @@
+#include "doctest/doctest.h"
+#include "molcpp/frame.hpp"
+
+#include <cstdint>
+#include <vector>
+
+using namespace molcpp;
+
+TEST_CASE("TestKey")
+{
+    SUBCASE("test_builtin_keys")
+    {
+        CHECK(Key("x") == keys::X);
+        CHECK(Key("y") == keys::Y);
+        CHECK(Key("z") == keys::Z);
+        CHECK(Key("type") == keys::TYPE);
+        CHECK(Key("charge") == keys::CHARGE);
+        CHECK(keys::MASS.name() == "mass");
+    }
+
+    SUBCASE("test_intern")
+    {
+        const Key a("test_key_velocity");
+        const Key b("test_key_velocity");
+        const Key c("test_key_force");
+        CHECK(a == b);
+        CHECK(a != c);
+        CHECK(a.name() == "test_key_velocity");
+        CHECK(a.id() < Key::n_interned());
+        CHECK_FALSE(Key().is_valid());
+    }
+}
+
+TEST_CASE("TestFrame")
+{
+    SUBCASE("test_positions")
+    {
+        Frame frame(3);
+        CHECK(frame.n_atoms() == 3);
+        CHECK(frame.has_column(keys::X));
+        CHECK(frame.column_keys() == std::vector<Key>{keys::X, keys::Y, keys::Z});
+
+        std::vector<double> xyz = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+        frame.set_positions(xyz.data());
+        auto [x, y, z] = frame.positions();
+        CHECK(x[1] == 3);
+        CHECK(y[2] == 7);
+        CHECK(z[0] == 2);
+
+        std::vector<double> out(9);
+        frame.get_positions(out.data());
+        CHECK(out == xyz);
+        CHECK_THROWS(frame.remove_column(keys::X));
+    }
+
+    SUBCASE("test_columns")
+    {
+        Frame frame(5);
+        auto charge = frame.add_column<double>(keys::CHARGE);
+        auto types = frame.add_column<int32_t>(keys::TYPE);
+        CHECK(charge.size() == 5);
+        CHECK(charge[4] == 0);
+        charge[4] = -1.5;
+        types[2] = 3;
+
+        CHECK(frame.column<double>(keys::CHARGE)[4] == -1.5);
+        CHECK(frame.column<int32_t>(Key("type"))[2] == 3);
+        CHECK(frame.column_type(keys::TYPE) == DType::INT32);
+        CHECK(frame.column_data(keys::TYPE) == types.data());
+        // adding the same column again returns it
+        CHECK(frame.add_column<int32_t>(keys::TYPE).data() == types.data());
+
+        CHECK_THROWS(frame.column<float>(keys::CHARGE));
+        CHECK_THROWS(frame.add_column<int64_t>(keys::CHARGE));
+        CHECK_THROWS(frame.column<double>(keys::MASS));
+        CHECK_THROWS(frame.add_column<double>(Key()));
+
+        frame.remove_column(keys::CHARGE);
+        CHECK_FALSE(frame.has_column(keys::CHARGE));
+        CHECK(frame.column<int32_t>(keys::TYPE)[2] == 3);
+    }
+
+    SUBCASE("test_alignment")
+    {
+        Frame frame(7);
+        frame.add_column<float>(Key("test_frame_float"));
+        frame.add_column<int64_t>(keys::ID);
+        for (auto key : frame.column_keys())
+        {
+            CHECK(reinterpret_cast<uintptr_t>(frame.column_data(key)) % 64 == 0);
+        }
+    }
+
+    SUBCASE("test_resize")
+    {
+        Frame frame(2);
+        auto mass = frame.add_column<double>(keys::MASS);
+        mass[0] = 1;
+        mass[1] = 2;
+
+        frame.resize(100);
+        mass = frame.column<double>(keys::MASS);
+        CHECK(mass.size() == 100);
+        CHECK(mass[1] == 2);
+        CHECK(mass[99] == 0);
+
+        frame.resize(1);
+        frame.resize(2);
+        CHECK(frame.column<double>(keys::MASS)[0] == 1);
+        CHECK(frame.column<double>(keys::MASS)[1] == 0);
+    }
+
+    SUBCASE("test_copy")
+    {
+        Frame frame(4);
+        frame.add_column<double>(keys::CHARGE)[0] = 1;
+        frame.set_box(Box({10.0, 10.0, 10.0}));
+
+        Frame copy = frame;
+        copy.column<double>(keys::CHARGE)[0] = 2;
+        CHECK(frame.column<double>(keys::CHARGE)[0] == 1);
+        CHECK(copy.column_data(keys::CHARGE) != frame.column_data(keys::CHARGE));
+        CHECK(copy.get_box().get_volume() == doctest::Approx(1000.0));
+    }
+}
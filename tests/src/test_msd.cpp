@@ -2,6 +2,7 @@
 #include "molcpp/compute.hpp"
 #include <xtensor/xbuilder.hpp>
 #include <xtensor/xmanipulation.hpp>
+#include <xtensor/xrandom.hpp>
 using namespace molcpp;
 
 TEST_CASE("TestMSD")
@@ -19,4 +20,133 @@ TEST_CASE("TestMSD")
     xt::view(xyz, xt::all(), 0, 0) = xt::arange(10);
     CHECK(xt::allclose(xt::view(direct_msd_kernel.compute(xyz).get("direct_msd"), xt::all(), 0, 0),
                        xt::pow(xt::arange<double>(10), 2.0)));
-}
\ No newline at end of file
+}
+TEST_CASE("TestWindowMSD")
+{
+    xt::random::seed(42);
+    const size_t n_frames = 50;
+    const size_t n_atoms = 4;
+    xt::xarray<double> xyz = xt::cumsum(xt::random::randn<double>({n_frames, n_atoms, size_t{3}}), 0);
+
+    // O(T^2) reference: average over all time origins
+    xt::xarray<double> expected = xt::zeros<double>({n_frames, n_atoms});
+    for (size_t lag = 0; lag < n_frames; lag++)
+    {
+        auto later = xt::view(xyz, xt::range(lag, n_frames), xt::all(), xt::all());
+        auto earlier = xt::view(xyz, xt::range(0, n_frames - lag), xt::all(), xt::all());
+        xt::view(expected, lag, xt::all()) = xt::mean(xt::sum(xt::pow(later - earlier, 2), {2}), {0});
+    }
+
+    SUBCASE("test_average")
+    {
+        auto msd = MSDCompute(MSDCompute::MSDStyle::WINDOW).compute(xyz).get("window_msd");
+        CHECK(msd.dimension() == 1);
+        CHECK(msd.shape(0) == n_frames);
+        CHECK(msd(0) == doctest::Approx(0));
+        CHECK(xt::allclose(msd, xt::mean(expected, {1})));
+    }
+
+    SUBCASE("test_per_atom")
+    {
+        auto msd = MSDCompute(MSDCompute::MSDStyle::WINDOW, true).compute(xyz).get("window_msd");
+        CHECK(msd.dimension() == 2);
+        CHECK(msd.shape(0) == n_frames);
+        CHECK(msd.shape(1) == n_atoms);
+        CHECK(xt::allclose(msd, expected));
+    }
+
+    SUBCASE("test_ballistic")
+    {
+        // r(t) = v t gives MSD(m) = |v|^2 m^2 for every time origin
+        xt::xarray<double> line = xt::zeros<double>({size_t{10}, size_t{1}, size_t{3}});
+        xt::view(line, xt::all(), 0, 0) = 2.0 * xt::arange<double>(10);
+        auto msd = MSDCompute(MSDCompute::MSDStyle::WINDOW).compute(line).get("window_msd");
+        CHECK(xt::allclose(msd, 4.0 * xt::pow(xt::arange<double>(10), 2.0)));
+    }
+
+    SUBCASE("test_far_from_origin")
+    {
+        // r(t) = r0 + v t, far from the origin: the windowed MSD is |v|^2 m^2
+        // for every lag, like the squared displacement from the first frame
+        const size_t n_long = 1000;
+        xt::xarray<double> velocities = xt::random::randn<double>({size_t{1}, n_atoms, size_t{3}});
+        xt::xarray<double> times = xt::arange<double>(static_cast<double>(n_long));
+        xt::xarray<double> line = 1e6 + xt::view(times, xt::all(), xt::newaxis(), xt::newaxis()) * velocities;
+        auto window = MSDCompute(MSDCompute::MSDStyle::WINDOW, true).compute(line).get("window_msd");
+        auto direct = xt::sum(MSDCompute(MSDCompute::MSDStyle::DIRECT).compute(line).get("direct_msd"), {2});
+        CHECK(xt::allclose(window, direct));
+    }
+
+    SUBCASE("test_views")
+    {
+        // views which do not start at the beginning of their buffer, taking
+        // every other frame from frame 1, and the atoms from atom 1
+        auto frames = xt::view(xyz, xt::range(1, n_frames, 2), xt::all(), xt::all());
+        auto atoms = xt::view(xyz, xt::range(1, n_frames), xt::range(1, n_atoms), xt::all());
+        MSDCompute msd(MSDCompute::MSDStyle::WINDOW, true);
+        xt::xarray<double> frames_copy = frames;
+        xt::xarray<double> atoms_copy = atoms;
+        CHECK(msd.compute(frames).get("window_msd") == msd.compute(frames_copy).get("window_msd"));
+        CHECK(msd.compute(atoms).get("window_msd") == msd.compute(atoms_copy).get("window_msd"));
+    }
+
+    SUBCASE("test_float")
+    {
+        // float positions are accumulated in double, like the same positions
+        // stored as double
+        xt::xarray<float> xyz_float = xyz;
+        xt::xarray<double> rounded = xyz_float;
+        MSDCompute msd(MSDCompute::MSDStyle::WINDOW, true);
+        CHECK(msd.compute(xyz_float).get("window_msd") == msd.compute(rounded).get("window_msd"));
+    }
+
+    SUBCASE("test_threads")
+    {
+        // more atoms than blocks, and results independent of the thread count
+        xt::xarray<double> many = xt::cumsum(xt::random::randn<double>({size_t{20}, size_t{300}, size_t{3}}), 0);
+        MSDCompute serial(MSDCompute::MSDStyle::WINDOW);
+        auto reference = serial.compute(many).get("window_msd");
+        auto reference_per_atom = MSDCompute(MSDCompute::MSDStyle::WINDOW, true).compute(many).get("window_msd");
+        CHECK(xt::allclose(reference, xt::mean(reference_per_atom, {1})));
+        for (size_t n_threads : {2, 4, 0})
+        {
+            CHECK(serial.compute(many, {n_threads}).get("window_msd") == reference);
+            MSDCompute per_atom(MSDCompute::MSDStyle::WINDOW, true, {n_threads});
+            CHECK(per_atom.compute(many).get("window_msd") == reference_per_atom);
+        }
+    }
+}
+
+TEST_CASE("TestStreamingMSD")
+{
+    xt::random::seed(7);
+    const size_t n_frames = 20;
+    const size_t n_atoms = 3;
+    xt::xarray<double> xyz = xt::cumsum(xt::random::randn<double>({n_frames, n_atoms, size_t{3}}), 0);
+    Box box({10, 10, 10});
+
+    StreamingMSDCompute streaming(4, 2);
+    for (size_t frame = 0; frame < n_frames; frame++)
+    {
+        xt::xarray<double> wrapped = xt::view(xyz, frame, xt::all(), xt::all());
+        box.wrap_inplace(wrapped.data(), n_atoms);
+        streaming.push_frame(wrapped, box);
+    }
+    CHECK(streaming.n_frames() == n_frames);
+
+    // 4 points on level 0, then every second point of the level below
+    auto lags = streaming.get_lags();
+    CHECK(lags == xt::xarray<size_t>{0, 1, 2, 3, 4, 6, 8, 12, 16});
+
+    // level 0 uses all time origins, like the windowed MSD of the unwrapped
+    // trajectory
+    auto msd = streaming.get_result().get("streaming_msd");
+    auto window = MSDCompute(MSDCompute::MSDStyle::WINDOW).compute(xyz).get("window_msd");
+    CHECK(xt::allclose(xt::view(msd, xt::range(0, 4)), xt::view(window, xt::range(0, 4))));
+
+    // level 3 holds frames 0, 8 and 16, so lag 16 has a single time origin
+    xt::xarray<double> delta = xt::view(xyz, 16, xt::all(), xt::all()) - xt::view(xyz, 0, xt::all(), xt::all());
+    CHECK(msd(8) == doctest::Approx(xt::sum(delta * delta)() / n_atoms));
+
+    CHECK_THROWS_WITH(StreamingMSDCompute(5, 2), "Points per level must be a multiple of decimation, which must be >= 2");
+}
@@ -0,0 +1,197 @@
+#include "doctest/doctest.h"
+#include "molcpp/box.hpp"
+#include "molcpp/neighbor.hpp"
+#include <cmath>
+
+#include <set>
+#include <utility>
+#include <xtensor/xarray.hpp>
+#include <xtensor/xrandom.hpp>
+#include <xtensor/xview.hpp>
+
+using namespace molcpp;
+
+using PairSet = std::set<std::pair<size_t, size_t>>;
+
+static PairSet brute_force_pairs(const xt::xarray<double> &xyz, const Box &box, double cutoff, bool full)
+{
+    PairSet pairs;
+    size_t n = xyz.shape(0);
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = full ? 0 : i + 1; j < n; j++)
+        {
+            if (i == j)
+            {
+                continue;
+            }
+            xt::xarray<double> d = xt::view(xyz, j, xt::all()) - xt::view(xyz, i, xt::all());
+            box.wrap_inplace(d.data(), 1);
+            if (xt::sum(d * d)() <= cutoff * cutoff)
+            {
+                pairs.insert({i, j});
+            }
+        }
+    }
+    return pairs;
+}
+
+static PairSet list_pairs(const NeighborList &list)
+{
+    PairSet pairs;
+    for (size_t i = 0; i < list.n_atoms(); i++)
+    {
+        for (auto j : list.neighbors(i))
+        {
+            pairs.insert({i, j});
+        }
+    }
+    return pairs;
+}
+
+TEST_CASE("TestCellList")
+{
+    xt::random::seed(42);
+    xt::xarray<double> xyz = xt::random::rand<double>({size_t{500}, size_t{3}}, -15, 15);
+
+    SUBCASE("test_against_brute_force")
+    {
+        for (const auto &box : {Box(), Box({20, 22, 24}), Box::from_lengths_angles({20, 22, 24}, {70, 80, 120})})
+        {
+            for (double cutoff : {2.5, 7.0})
+            {
+                for (bool full : {false, true})
+                {
+                    CellList cells(cutoff, full, true);
+                    auto list = cells.build(xyz, box);
+                    CHECK(list.n_atoms() == 500);
+                    CHECK(list_pairs(list) == brute_force_pairs(xyz, box, cutoff, full));
+                    for (auto d : list.distances)
+                    {
+                        CHECK(d <= cutoff);
+                    }
+                }
+            }
+        }
+    }
+
+    SUBCASE("test_threads")
+    {
+        // the parallel counting sort keeps the atom order of the serial one
+        for (const auto &box : {Box(), Box::from_lengths_angles({20, 22, 24}, {70, 80, 120})})
+        {
+            CellList serial(4.0, false, true);
+            auto expected = serial.build(xyz, box);
+            for (size_t n_threads : {2, 4, 0})
+            {
+                CellList threaded(4.0, false, true);
+                threaded.set_n_threads(n_threads);
+                auto list = threaded.build(xyz, box);
+                CHECK(list.offsets == expected.offsets);
+                CHECK(list.indices == expected.indices);
+                CHECK(list.distances == expected.distances);
+            }
+        }
+    }
+
+    SUBCASE("test_float")
+    {
+        // float positions give the list of the same positions in double
+        xt::xarray<float> xyz_float = xyz;
+        xt::xarray<double> rounded = xyz_float;
+        for (const auto &box : {Box(), Box::from_lengths_angles({20, 22, 24}, {70, 80, 120})})
+        {
+            CellList cells(4.0, false, true);
+            auto expected = cells.build(rounded, box);
+            auto list = cells.build(xyz_float.data(), xyz_float.shape(0), box);
+            CHECK(list.offsets == expected.offsets);
+            CHECK(list.indices == expected.indices);
+            CHECK(list.distances == expected.distances);
+        }
+    }
+
+    SUBCASE("test_grid")
+    {
+        CellList cells(2.5);
+        cells.build(xyz, Box::from_lengths_angles({20, 22, 24}, {90, 90, 60}));
+        auto grid = cells.get_grid();
+        // distances between faces are {20, 22, 24} * sin(60°) for a and b
+        CHECK(grid[0] == 6);
+        CHECK(grid[1] == 7);
+        CHECK(grid[2] == 9);
+    }
+
+    SUBCASE("test_errors")
+    {
+        CHECK_THROWS_WITH(CellList(0), "Cutoff must be > 0");
+        CHECK_THROWS_WITH(CellList(11).build(xyz, Box({20, 22, 24})),
+                          "Cutoff must be at most half the distance between box faces");
+    }
+}
+
+TEST_CASE("TestVerletList")
+{
+    xt::random::seed(42);
+    xt::xarray<double> xyz = xt::random::rand<double>({size_t{500}, size_t{3}}, -10, 10);
+    Box box({20, 20, 20});
+
+    SUBCASE("test_rebuild_on_displacement")
+    {
+        VerletList verlet(3.0, 1.0);
+        CHECK(verlet.update(xyz, box));
+        CHECK(!verlet.update(xyz, box));
+
+        // below half the skin: the list is still valid
+        xyz(0, 0) += 0.4;
+        CHECK(!verlet.update(xyz, box));
+        CHECK(verlet.get_stats().max_displacement == doctest::Approx(0.4));
+
+        xyz(1, 1) -= 0.6;
+        CHECK(verlet.update(xyz, box));
+
+        auto stats = verlet.get_stats();
+        CHECK(stats.n_updates == 4);
+        CHECK(stats.n_rebuilds == 2);
+    }
+
+    SUBCASE("test_rebuild_on_box_change")
+    {
+        VerletList verlet(3.0, 1.0);
+        CHECK(verlet.update(xyz, box));
+        CHECK(!verlet.update(xyz, Box({20.1, 20.1, 20.1})));
+        CHECK(verlet.update(xyz, Box({21, 20, 20})));
+        CHECK(verlet.update(xyz, Box::from_lengths_angles({21, 20, 20}, {90, 90, 80})));
+    }
+
+    SUBCASE("test_rebuild_on_shrinking_box")
+    {
+        // 4.1 apart in the first box, 2.2 apart through the boundary once the
+        // box shrinks by 1.9: a cell vector change moves images by its norm
+        xt::xarray<double> pair = {{0.0, 0.0, 0.0}, {15.9, 0.0, 0.0}};
+        VerletList verlet(3.0, 1.0);
+        CHECK(verlet.update(pair, Box({20, 20, 20})));
+        CHECK(verlet.update(pair, Box({18.1, 20, 20})));
+        CHECK(verlet.get_list().n_pairs() == 1);
+    }
+
+    SUBCASE("test_contains_all_pairs")
+    {
+        VerletList verlet(3.0, 1.0);
+        CellList exact(3.0);
+        xt::random::seed(7);
+        for (size_t frame = 0; frame < 20; frame++)
+        {
+            // the box fluctuates as in NPT, which moves periodic images
+            // without moving the atoms
+            const double scale = 1.0 + 0.04 * std::sin(0.9 * static_cast<double>(frame));
+            Box current = Box::from_lengths_angles({20 * scale, 20 / scale, 20}, {90, 90, 90 - 2 * (scale - 1) * 90});
+            xyz += xt::random::randn<double>(xyz.shape(), 0, 0.1);
+            verlet.update(xyz, current);
+            PairSet candidates = list_pairs(verlet.get_list());
+            for (const auto &pair : list_pairs(exact.build(xyz, current)))
+            {
+                CHECK(candidates.count(pair) == 1);
+            }
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#include "doctest/doctest.h"
+#include "molcpp/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace molcpp;
+
+TEST_CASE("TestParallelFor")
+{
+    SUBCASE("test_tasks")
+    {
+        // the pool is reused between calls, with more and fewer threads
+        for (size_t n_threads : {4, 2, 8, 1, 0, 3})
+        {
+            for (size_t repeat = 0; repeat < 20; repeat++)
+            {
+                std::vector<std::atomic<int>> calls(100);
+                std::atomic<bool> valid_thread{true};
+                const size_t max_threads = resolve_n_threads(n_threads);
+                parallel_for(calls.size(), n_threads, [&](size_t task, size_t thread) {
+                    calls[task]++;
+                    if (thread >= max_threads)
+                    {
+                        valid_thread = false;
+                    }
+                });
+                CHECK(valid_thread);
+                CHECK(std::all_of(calls.begin(), calls.end(), [](const auto &count) { return count == 1; }));
+            }
+        }
+    }
+
+    SUBCASE("test_nested")
+    {
+        std::atomic<size_t> sum{0};
+        parallel_for(8, 4, [&](size_t outer, size_t) {
+            parallel_for(8, 4, [&](size_t inner, size_t) { sum += 8 * outer + inner; });
+        });
+        CHECK(sum == 63 * 64 / 2);
+    }
+
+    SUBCASE("test_concurrent_callers")
+    {
+        std::vector<size_t> sums(4, 0);
+        std::vector<std::thread> callers;
+        for (size_t caller = 0; caller < sums.size(); caller++)
+        {
+            callers.emplace_back([&, caller] {
+                for (size_t repeat = 0; repeat < 50; repeat++)
+                {
+                    std::atomic<size_t> sum{0};
+                    parallel_for(100, 4, [&](size_t task, size_t) { sum += task; });
+                    sums[caller] += sum;
+                }
+            });
+        }
+        for (auto &caller : callers)
+        {
+            caller.join();
+        }
+        CHECK(sums == std::vector<size_t>(4, 50 * 99 * 100 / 2));
+    }
+
+    SUBCASE("test_exceptions")
+    {
+        auto fail = [] {
+            parallel_for(100, 4, [](size_t task, size_t) {
+                if (task == 42)
+                {
+                    throw std::runtime_error("task 42");
+                }
+            });
+        };
+        CHECK_THROWS_AS(fail(), std::runtime_error);
+        // the pool keeps working after a failed call
+        std::atomic<size_t> count{0};
+        parallel_for(100, 4, [&](size_t, size_t) { count++; });
+        CHECK(count == 100);
+    }
+
+    SUBCASE("test_ranges")
+    {
+        std::vector<int> covered(1000, 0);
+        parallel_ranges(covered.size(), 7, 3, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                covered[i]++;
+            }
+        });
+        CHECK(std::accumulate(covered.begin(), covered.end(), 0) == 1000);
+        CHECK(std::all_of(covered.begin(), covered.end(), [](int count) { return count == 1; }));
+    }
+}
@@ -0,0 +1,129 @@
+#include "doctest/doctest.h"
+#include "molcpp/compute.hpp"
+#include "molcpp/pipeline.hpp"
+
+#include <filesystem>
+#include <xtensor/xmanipulation.hpp>
+#include <xtensor/xrandom.hpp>
+#include <xtensor/xview.hpp>
+
+using namespace molcpp;
+
+/// Trajectory whose positions encode the frame index, failing on one frame
+class CountingTrajectory : public TrajectoryReader
+{
+  public:
+    explicit CountingTrajectory(size_t failing = static_cast<size_t>(-1)) : _failing(failing)
+    {
+    }
+
+    auto n_frames() const -> size_t override
+    {
+        return 50;
+    }
+
+    auto n_atoms() const -> size_t override
+    {
+        return 4;
+    }
+
+    auto read(size_t frame, double *xyz) const -> Box override
+    {
+        if (frame == _failing)
+        {
+            throw std::runtime_error("unreadable frame");
+        }
+        std::fill_n(xyz, 12, static_cast<double>(frame));
+        return Box();
+    }
+
+  private:
+    size_t _failing;
+};
+
+TEST_CASE("TestFramePipeline")
+{
+    SUBCASE("test_order")
+    {
+        CountingTrajectory trajectory;
+        for (size_t depth : {1, 3})
+        {
+            for (size_t n_readers : {1, 4})
+            {
+                FramePipeline pipeline(trajectory, depth, n_readers);
+                std::vector<size_t> frames;
+                bool consistent = true;
+                pipeline.add_consumer([&](const FrameBuffer &buffer) {
+                    frames.push_back(buffer.frame);
+                    consistent &= buffer.xyz[11] == static_cast<double>(buffer.frame);
+                });
+                pipeline.run(2, 45, 4);
+                CHECK(consistent);
+                CHECK(frames == std::vector<size_t>{2, 6, 10, 14, 18, 22, 26, 30, 34, 38, 42});
+
+                const auto &stats = pipeline.get_stats();
+                CHECK(stats.n_frames == 11);
+                CHECK(stats.compute_time.size() == 1);
+                CHECK(stats.read_time >= 0);
+                CHECK(stats.io_wait_time >= 0);
+
+                pipeline.run();
+                CHECK(pipeline.get_stats().n_frames == 50);
+            }
+        }
+    }
+
+    SUBCASE("test_several_consumers")
+    {
+        auto path = (std::filesystem::temp_directory_path() / "molcpp_test_pipeline.moltraj").string();
+        xt::random::seed(7);
+        xt::xarray<double> xyz = xt::cumsum(xt::random::randn<double>({size_t{40}, size_t{10}, size_t{3}}), 0);
+        {
+            BinaryTrajectoryWriter writer(path, 10);
+            for (size_t frame = 0; frame < 40; frame++)
+            {
+                writer.write(xt::xarray<double>(xt::view(xyz, frame)), Box());
+            }
+        }
+        BinaryTrajectory trajectory(path);
+
+        StreamingMSDCompute streaming;
+        StreamingMSDCompute expected;
+        size_t n_frames = 0;
+        FramePipeline pipeline(trajectory, 2, 2);
+        pipeline.add_consumer([&](const FrameBuffer &frame) { streaming.push_frame(frame.xyz.data(), 10, frame.box); });
+        pipeline.add_consumer([&](const FrameBuffer &) { n_frames++; });
+        pipeline.run();
+
+        for (size_t frame = 0; frame < 40; frame++)
+        {
+            expected.push_frame(xt::xarray<double>(xt::view(xyz, frame)), Box());
+        }
+        CHECK(n_frames == 40);
+        CHECK(streaming.get_result().get("streaming_msd") == expected.get_result().get("streaming_msd"));
+        CHECK(pipeline.get_stats().compute_time.size() == 2);
+        std::filesystem::remove(path);
+    }
+
+    SUBCASE("test_errors")
+    {
+        CountingTrajectory failing(20);
+        FramePipeline pipeline(failing, 4, 3);
+        size_t n_frames = 0;
+        pipeline.add_consumer([&](const FrameBuffer &) { n_frames++; });
+        CHECK_THROWS_WITH(pipeline.run(), "unreadable frame");
+        CHECK(n_frames <= 20);
+
+        CountingTrajectory trajectory;
+        FramePipeline throwing(trajectory);
+        throwing.add_consumer([](const FrameBuffer &buffer) {
+            if (buffer.frame == 5)
+            {
+                throw std::runtime_error("consumer failed");
+            }
+        });
+        CHECK_THROWS_WITH(throwing.run(), "consumer failed");
+        CHECK_THROWS(throwing.run(10, 5));
+        CHECK_THROWS(FramePipeline(trajectory, 0));
+    }
+}
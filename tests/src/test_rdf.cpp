@@ -0,0 +1,110 @@
+#include "doctest/doctest.h"
+#include "molcpp/compute.hpp"
+
+#include <cmath>
+#include <xtensor/xarray.hpp>
+#include <xtensor/xrandom.hpp>
+#include <xtensor/xview.hpp>
+
+using namespace molcpp;
+
+/// Pair counts of each bin by checking every pair
+static auto brute_force_counts(const xt::xarray<double> &xyz, const Box &box, double r_max, size_t n_bins,
+                               const std::vector<int> &types = {}, int type_a = 0, int type_b = 0)
+    -> xt::xarray<uint64_t>
+{
+    xt::xarray<uint64_t> counts = xt::zeros<uint64_t>({n_bins});
+    const size_t n = xyz.shape(0);
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = i + 1; j < n; j++)
+        {
+            if (!types.empty() && !((types[i] == type_a && types[j] == type_b) ||
+                                    (types[i] == type_b && types[j] == type_a)))
+            {
+                continue;
+            }
+            xt::xarray<double> d = xt::view(xyz, j, xt::all()) - xt::view(xyz, i, xt::all());
+            box.wrap_inplace(d.data(), 1);
+            auto bin = static_cast<size_t>(std::sqrt(xt::sum(d * d)()) * static_cast<double>(n_bins) / r_max);
+            if (bin < n_bins)
+            {
+                counts(bin)++;
+            }
+        }
+    }
+    return counts;
+}
+
+TEST_CASE("TestRDF")
+{
+    xt::random::seed(42);
+    const size_t n_atoms = 400;
+    Box box = Box::from_lengths_angles({15, 16, 17}, {80, 95, 110});
+    xt::xarray<double> xyz = xt::random::rand<double>({n_atoms, size_t{3}}, 0, 15);
+
+    SUBCASE("test_against_brute_force")
+    {
+        RDFCompute rdf(6.0, 30);
+        rdf.push_frame(xyz, box);
+        CHECK(rdf.n_frames() == 1);
+        CHECK(rdf.get_pair_counts() == brute_force_counts(xyz, box, 6.0, 30));
+        CHECK(xt::allclose(rdf.get_bin_centers(), xt::arange(0.1, 6.0, 0.2)));
+    }
+
+    SUBCASE("test_pair_selection")
+    {
+        std::vector<int> types(n_atoms);
+        for (size_t i = 0; i < n_atoms; i++)
+        {
+            types[i] = static_cast<int>(i % 3);
+        }
+        RDFCompute rdf(6.0, 30);
+        rdf.select_pair(2, 0);
+        rdf.push_frame(xyz.data(), n_atoms, box, types.data());
+        CHECK(rdf.get_pair_counts() == brute_force_counts(xyz, box, 6.0, 30, types, 0, 2));
+
+        rdf.select_pair(1, 1);
+        rdf.push_frame(xyz.data(), n_atoms, box, types.data());
+        CHECK(rdf.get_pair_counts() == brute_force_counts(xyz, box, 6.0, 30, types, 1, 1));
+
+        CHECK_THROWS_WITH(rdf.push_frame(xyz, box), "Atom types are required to select pairs");
+    }
+
+    SUBCASE("test_ideal_gas")
+    {
+        // uniform positions have g(r) = 1, whatever the volume of each frame
+        Box cube({20, 20, 20});
+        RDFCompute rdf(8.0, 8);
+        for (size_t frame = 0; frame < 10; frame++)
+        {
+            double scale = 1.0 + 0.05 * static_cast<double>(frame);
+            xt::xarray<double> uniform = xt::random::rand<double>({size_t{2000}, size_t{3}}, 0, 20 * scale);
+            rdf.push_frame(uniform, Box({20 * scale, 20 * scale, 20 * scale}));
+        }
+        auto result = rdf.get_result();
+        CHECK(result.get_key() == "rdf");
+        CHECK(result.get_axis() == rdf.get_bin_centers());
+        auto g = result.get();
+        CHECK(xt::all(xt::abs(xt::view(g, xt::range(2, 8)) - 1.0) < 0.05));
+    }
+
+    SUBCASE("test_threads")
+    {
+        xt::xarray<double> frames = xt::random::rand<double>({size_t{3}, n_atoms, size_t{3}}, 0, 15);
+        auto serial = RDFCompute(6.0, 30).compute(frames, box).get();
+        for (size_t n_threads : {2, 3, 8})
+        {
+            CHECK(RDFCompute(6.0, 30, {n_threads}).compute(frames, box).get() == serial);
+        }
+    }
+
+    SUBCASE("test_invalid")
+    {
+        CHECK_THROWS(RDFCompute(0.0));
+        CHECK_THROWS(RDFCompute(6.0, 0));
+        RDFCompute rdf(6.0);
+        CHECK_THROWS_WITH(rdf.push_frame(xyz, Box()), "RDF requires a periodic box");
+        CHECK_THROWS(rdf.push_frame(xyz, Box({10, 10, 10})));
+    }
+}
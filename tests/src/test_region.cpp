@@ -0,0 +1,110 @@
+#include "doctest/doctest.h"
+#include "molcpp/region.hpp"
+#include "molcpp/simd.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <xtensor/xarray.hpp>
+#include <xtensor/xrandom.hpp>
+
+using namespace molcpp;
+
+/// Random positions, not a multiple of the bitmask word or vector sizes
+static auto random_positions(size_t n) -> xt::xarray<double>
+{
+    xt::random::seed(42);
+    return xt::random::rand<double>({n, size_t{3}}, -10, 10);
+}
+
+/// Check every output of `region` against `expected(x, y, z)` at every
+/// instruction set
+template <typename Expected> static void check_region(const Region &region, Expected &&expected)
+{
+    const size_t n = 4133;
+    auto xyz = random_positions(n);
+    for (auto level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+        set_simd_level(level);
+        xt::xarray<bool> mask = region.isin(xyz);
+        std::vector<uint64_t> bits((n + 63) / 64);
+        region.select(xyz.data(), n, bits.data());
+        std::vector<uint32_t> indices;
+        region.select_indices(xyz.data(), n, indices);
+
+        std::vector<uint32_t> expected_indices;
+        for (size_t i = 0; i < n; i++)
+        {
+            const bool inside = expected(xyz(i, 0), xyz(i, 1), xyz(i, 2));
+            CHECK(mask(i) == inside);
+            CHECK(static_cast<bool>((bits[i / 64] >> (i % 64)) & 1) == inside);
+            if (inside)
+            {
+                expected_indices.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        // bits past the last position are cleared
+        CHECK((bits.back() >> (n % 64)) == 0);
+        CHECK(indices == expected_indices);
+        CHECK(region.count(xyz.data(), n) == expected_indices.size());
+        CHECK(!expected_indices.empty());
+    }
+    set_simd_level(detect_simd_level());
+}
+
+static auto in_sphere(double x, double y, double z) -> bool
+{
+    x -= 1;
+    y -= 2;
+    z -= 3;
+    return x * x + y * y + z * z < 25;
+}
+
+static auto in_slab(double, double, double z) -> bool
+{
+    return z >= -2 && z < 4;
+}
+
+TEST_CASE("TestRegion")
+{
+    auto sphere = std::make_shared<Sphere>(Vec3{1, 2, 3}, 5.0);
+    auto slab = std::make_shared<Slab>(Vec3{0, 0, 2}, -2.0, 4.0);
+
+    SUBCASE("test_sphere")
+    {
+        check_region(*sphere, in_sphere);
+        CHECK_THROWS(Sphere({0, 0, 0}, -1.0));
+    }
+
+    SUBCASE("test_cylinder")
+    {
+        Cylinder cylinder({0, 0, 0}, {1, 1, 0}, 3.0, 8.0);
+        CHECK(cylinder.get_axis()(0) == doctest::Approx(1 / std::sqrt(2.0)));
+        check_region(cylinder, [](double x, double y, double z) {
+            const double t = (x + y) / std::sqrt(2.0);
+            return x * x + y * y + z * z - t * t < 9 && t >= -4 && t < 4;
+        });
+        // infinite along the axis by default
+        check_region(Cylinder({0, 0, 0}, {0, 0, 1}, 3.0), [](double x, double y, double) { return x * x + y * y < 9; });
+        CHECK_THROWS(Cylinder({0, 0, 0}, {0, 0, 0}, 3.0));
+    }
+
+    SUBCASE("test_slab")
+    {
+        check_region(*slab, in_slab);
+    }
+
+    SUBCASE("test_union")
+    {
+        Union both({sphere, slab});
+        check_region(both, [](double x, double y, double z) { return in_sphere(x, y, z) || in_slab(x, y, z); });
+        CHECK_THROWS(Union(std::vector<std::shared_ptr<const Region>>{}));
+    }
+
+    SUBCASE("test_intersection")
+    {
+        Intersection both({sphere, slab});
+        check_region(both, [](double x, double y, double z) { return in_sphere(x, y, z) && in_slab(x, y, z); });
+        CHECK_THROWS(Intersection({sphere, nullptr}));
+    }
+}
@@ -0,0 +1,85 @@
+#include "doctest/doctest.h"
+#include "molcpp/topology.hpp"
+
+#include <algorithm>
+#include <vector>
+
+using namespace molcpp;
+
+TEST_CASE("TestTopology")
+{
+    SUBCASE("test_butane")
+    {
+        // C0-C1-C2-C3 with one hydrogen on each carbon, and C1 branched
+        Topology topology(8);
+        std::vector<Bond> bonds = {{0, 1}, {1, 2}, {2, 3}, {0, 4}, {1, 5}, {2, 6}, {3, 7}, {2, 1}};
+        topology.set_bonds(bonds);
+
+        CHECK(topology.n_atoms() == 8);
+        CHECK(topology.n_bonds() == 7);
+        CHECK(topology.degree(1) == 3);
+        auto neighbors = topology.neighbors(1);
+        CHECK(std::vector<uint32_t>(neighbors.begin(), neighbors.end()) == std::vector<uint32_t>{0, 2, 5});
+        CHECK(topology.bonds() ==
+              std::vector<Bond>{{0, 1}, {0, 4}, {1, 2}, {1, 5}, {2, 3}, {2, 6}, {3, 7}});
+
+        auto angles = topology.angles();
+        CHECK(angles.size() == 8);
+        CHECK(topology.n_angles() == 8);
+        CHECK(angles.front() == Angle{1, 0, 4});
+        CHECK(std::find(angles.begin(), angles.end(), Angle{0, 1, 2}) != angles.end());
+
+        // 2 x 2 around the central bond, 2 x 1 around each outer C-C bond
+        auto dihedrals = topology.dihedrals();
+        CHECK(dihedrals.size() == 8);
+        CHECK(std::find(dihedrals.begin(), dihedrals.end(), Dihedral{0, 1, 2, 3}) != dihedrals.end());
+        CHECK(std::find(dihedrals.begin(), dihedrals.end(), Dihedral{4, 0, 1, 2}) != dihedrals.end());
+
+        CHECK(topology.impropers() == std::vector<Improper>{{1, 0, 2, 5}, {2, 1, 3, 6}});
+        CHECK(topology.n_impropers() == 2);
+    }
+
+    SUBCASE("test_ring")
+    {
+        // a 3-membered ring has no dihedral
+        Topology topology(3);
+        std::vector<Bond> bonds = {{0, 1}, {1, 2}, {2, 0}};
+        topology.set_bonds(bonds);
+        CHECK(topology.angles().size() == 3);
+        CHECK(topology.dihedrals().empty());
+    }
+
+    SUBCASE("test_molecules")
+    {
+        Topology topology(7);
+        std::vector<Bond> bonds = {{5, 6}, {0, 2}, {2, 4}};
+        topology.set_bonds(bonds);
+        CHECK(topology.molecules() == std::vector<uint32_t>{0, 1, 0, 2, 0, 3, 3});
+        CHECK(topology.n_molecules() == 4);
+    }
+
+    SUBCASE("test_invalid_bonds")
+    {
+        Topology topology(3);
+        std::vector<Bond> out_of_range = {{0, 3}};
+        std::vector<Bond> self = {{1, 1}};
+        CHECK_THROWS(topology.set_bonds(out_of_range));
+        CHECK_THROWS(topology.set_bonds(self));
+    }
+
+    SUBCASE("test_guess_bonds")
+    {
+        // chain across the periodic boundary of a 10 A box
+        Box box({10.0, 10.0, 10.0});
+        std::vector<double> xyz = {0.5, 5, 5, 9.5, 5, 5, 8.0, 5, 5, 3.0, 5, 5};
+        Topology topology(4, ExecutionPolicy{2});
+        topology.guess_bonds(xyz.data(), 4, box, 1.6);
+        CHECK(topology.bonds() == std::vector<Bond>{{0, 1}, {1, 2}});
+        CHECK(topology.n_molecules() == 2);
+
+        std::vector<double> radii = {0.7, 0.7, 0.3, 1.8};
+        topology.guess_bonds(xyz.data(), 4, box, radii, 0.1);
+        CHECK(topology.bonds() == std::vector<Bond>{{0, 1}, {0, 3}});
+        CHECK_THROWS(topology.guess_bonds(xyz.data(), 3, box, 1.6));
+    }
+}
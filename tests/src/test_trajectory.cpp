@@ -0,0 +1,454 @@
+#include "doctest/doctest.h"
+#include "molcpp/compute.hpp"
+#include "molcpp/trajectory.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <xtensor/xmanipulation.hpp>
+#include <xtensor/xrandom.hpp>
+#include <xtensor/xview.hpp>
+
+using namespace molcpp;
+
+TEST_CASE("TestBinaryTrajectory")
+{
+    auto dir = std::filesystem::temp_directory_path();
+    auto path = (dir / "molcpp_test_trajectory.moltraj").string();
+
+    xt::random::seed(42);
+    const size_t n_frames = 5;
+    const size_t n_atoms = 7;
+    xt::xarray<double> xyz = xt::random::rand<double>({n_frames, n_atoms, size_t{3}}) * 10.0;
+    Box box({{10, 1, 2}, {0, 11, 3}, {0, 0, 12}});
+
+    SUBCASE("test_roundtrip_float64")
+    {
+        {
+            BinaryTrajectoryWriter writer(path, n_atoms);
+            for (size_t frame = 0; frame < n_frames; frame++)
+            {
+                writer.write(xt::xarray<double>(xt::view(xyz, frame)), frame == 0 ? Box() : box);
+            }
+        }
+        BinaryTrajectory trajectory(path);
+        CHECK(trajectory.n_frames() == n_frames);
+        CHECK(trajectory.n_atoms() == n_atoms);
+        CHECK(trajectory.get_precision() == BinaryTrajectory::Precision::FLOAT64);
+        CHECK(trajectory.box(0).get_style() == Box::FREE);
+        CHECK(trajectory.box(1) == box);
+
+        for (size_t frame = 0; frame < n_frames; frame++)
+        {
+            auto positions = trajectory.positions<double>(frame);
+            CHECK(positions.shape(0) == n_atoms);
+            CHECK(positions == xt::view(xyz, frame));
+            // aligned, and pointing in the mapping
+            CHECK(reinterpret_cast<uintptr_t>(positions.data()) % 64 == 0);
+            CHECK(positions.data() == trajectory.positions<double>(frame).data());
+        }
+        CHECK(trajectory.positions<double>() == xyz);
+        CHECK(trajectory.read_positions(0, n_frames) == xyz);
+        CHECK(trajectory.read_positions(2, 4) == xt::view(xyz, xt::range(2, 4)));
+
+        CHECK_THROWS(trajectory.positions<float>(0));
+        CHECK_THROWS(trajectory.box(n_frames));
+        CHECK_THROWS(trajectory.read_positions(3, 2));
+    }
+
+    SUBCASE("test_roundtrip_float32")
+    {
+        {
+            BinaryTrajectoryWriter writer(path, n_atoms, BinaryTrajectory::Precision::FLOAT32);
+            for (size_t frame = 0; frame < n_frames; frame++)
+            {
+                writer.write(xt::xarray<double>(xt::view(xyz, frame)), box);
+            }
+        }
+        BinaryTrajectory trajectory(path);
+        CHECK(trajectory.get_precision() == BinaryTrajectory::Precision::FLOAT32);
+        CHECK(trajectory.positions<float>(3) == xt::cast<float>(xt::view(xyz, 3)));
+        CHECK(xt::allclose(trajectory.read_positions(0, n_frames), xyz, 1e-6));
+        CHECK_THROWS(trajectory.positions<double>());
+    }
+
+    SUBCASE("test_msd_without_copy")
+    {
+        xt::xarray<double> walk = xt::cumsum(xt::random::randn<double>({size_t{30}, n_atoms, size_t{3}}), 0);
+        {
+            BinaryTrajectoryWriter writer(path, n_atoms);
+            for (size_t frame = 0; frame < walk.shape(0); frame++)
+            {
+                writer.write(xt::xarray<double>(xt::view(walk, frame)), Box());
+            }
+        }
+        BinaryTrajectory trajectory(path);
+        MSDCompute msd(MSDCompute::MSDStyle::WINDOW, true);
+        CHECK(msd.compute(trajectory.positions<double>()).get("window_msd") ==
+              msd.compute(walk).get("window_msd"));
+    }
+
+    SUBCASE("test_invalid")
+    {
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << "not a trajectory, but long enough to hold a complete header of 64 bytes";
+        }
+        CHECK_THROWS(BinaryTrajectory(path));
+        CHECK_THROWS(BinaryTrajectory((dir / "molcpp_missing.moltraj").string()));
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("TestXYZToBinary")
+{
+    auto dir = std::filesystem::temp_directory_path();
+    auto xyz_path = (dir / "molcpp_test_trajectory.xyz").string();
+    auto path = (dir / "molcpp_test_trajectory_xyz.moltraj").string();
+
+    {
+        std::ofstream file(xyz_path);
+        file << "2\nframe 0\nO 0.0 1.0 2.0\nH 3.0 4.0 5.0\n";
+        file << "2\nframe 1\nO 0.5 1.5 2.5\nH -3.0 -4.0 -5.0\n";
+    }
+    CHECK(xyz_to_binary(xyz_path, path, Box({10, 10, 10})) == 2);
+
+    BinaryTrajectory trajectory(path);
+    CHECK(trajectory.n_frames() == 2);
+    CHECK(trajectory.n_atoms() == 2);
+    CHECK(trajectory.box(1) == Box({10, 10, 10}));
+    CHECK(trajectory.positions<double>(0) == xt::xarray<double>{{0, 1, 2}, {3, 4, 5}});
+    CHECK(trajectory.positions<double>(1) == xt::xarray<double>{{0.5, 1.5, 2.5}, {-3, -4, -5}});
+
+    {
+        std::ofstream file(xyz_path);
+        file << "2\ntruncated\nO 0.0 1.0 2.0\n";
+    }
+    CHECK_THROWS(xyz_to_binary(xyz_path, path));
+
+    std::filesystem::remove(xyz_path);
+    std::filesystem::remove(FrameIndex::sidecar_path(xyz_path));
+    std::filesystem::remove(path);
+}
+
+static const char *const LAMMPS_DUMP = "ITEM: TIMESTEP\n"
+                                       "0\n"
+                                       "ITEM: NUMBER OF ATOMS\n"
+                                       "3\n"
+                                       "ITEM: BOX BOUNDS pp pp pp\n"
+                                       "0.0 10.0\n"
+                                       "-1.0 11.0\n"
+                                       "2.0 16.0\n"
+                                       "ITEM: ATOMS id type x y z\n"
+                                       "2 1 4.0 5.0 6.0\n"
+                                       "1 1 1.0 2.0 3.0\n"
+                                       "3 2 7.0 8.0 9.0\n"
+                                       "ITEM: TIMESTEP\n"
+                                       "100\n"
+                                       "ITEM: NUMBER OF ATOMS\n"
+                                       "3\n"
+                                       "ITEM: BOX BOUNDS xy xz yz pp pp pp\n"
+                                       "-1.0 12.0 1.0\n"
+                                       "0.0 12.0 -1.0\n"
+                                       "0.0 14.0 3.0\n"
+                                       "ITEM: ATOMS id xs ys zs\n"
+                                       "1 0.0 0.0 0.0\n"
+                                       "2 1.0 1.0 1.0\n"
+                                       "3 0.5 0.5 0.5\n";
+
+TEST_CASE("TestLAMMPSDumpTrajectory")
+{
+    auto path = (std::filesystem::temp_directory_path() / "molcpp_test.lammpstrj").string();
+    std::filesystem::remove(FrameIndex::sidecar_path(path));
+    {
+        std::ofstream file(path);
+        file << LAMMPS_DUMP;
+    }
+
+    SUBCASE("test_read")
+    {
+        LAMMPSDumpTrajectory trajectory(path);
+        CHECK(trajectory.n_frames() == 2);
+        CHECK(trajectory.n_atoms() == 3);
+        CHECK(trajectory.get_step(1) == 100);
+
+        // atoms are sorted by id
+        xt::xarray<double> xyz = xt::zeros<double>({3, 3});
+        Box box = trajectory.read(0, xyz.data());
+        CHECK(box == Box({10, 12, 14}));
+        CHECK(xyz == xt::xarray<double>{{1, 2, 3}, {4, 5, 6}, {7, 8, 9}});
+
+        // the bounds of a triclinic box enclose the tilted box, and scaled
+        // positions are converted with its matrix
+        box = trajectory.read(1, xyz.data());
+        CHECK(box == Box({{11, 1, -1}, {0, 9, 3}, {0, 0, 14}}));
+        CHECK(xt::allclose(xyz, xt::xarray<double>{{0, 0, 0}, {11, 12, 14}, {5.5, 6, 7}}));
+
+        CHECK(LAMMPSDumpTrajectory(path, {4}).read_positions(0, 2, {2}) == trajectory.read_positions(0, 2));
+    }
+
+    SUBCASE("test_unsorted_ids")
+    {
+        {
+            std::ofstream file(path, std::ios::trunc);
+            file << "ITEM: TIMESTEP\n0\nITEM: NUMBER OF ATOMS\n2\nITEM: BOX BOUNDS pp pp pp\n0 10\n0 10\n0 10\n";
+            file << "ITEM: ATOMS id x y z\n7 1 2 3\n3 4 5 6\n";
+        }
+        xt::xarray<double> xyz = xt::zeros<double>({2, 3});
+        LAMMPSDumpTrajectory(path).read(0, xyz.data());
+        CHECK(xyz == xt::xarray<double>{{1, 2, 3}, {4, 5, 6}});
+    }
+
+    SUBCASE("test_truncated")
+    {
+        {
+            std::ofstream file(path, std::ios::trunc);
+            std::string dump = LAMMPS_DUMP;
+            file << dump.substr(0, dump.size() - 10);
+        }
+        CHECK(LAMMPSDumpTrajectory(path).n_frames() == 1);
+    }
+
+    SUBCASE("test_invalid")
+    {
+        {
+            std::ofstream file(path, std::ios::trunc);
+            file << "not a dump\n";
+        }
+        CHECK_THROWS(LAMMPSDumpTrajectory(path));
+        {
+            std::ofstream file(path, std::ios::trunc);
+            file << "ITEM: TIMESTEP\n0\nITEM: NUMBER OF ATOMS\n1\nITEM: BOX BOUNDS abc origin pp pp pp\n";
+            file << "10 0 0 0\n0 10 0 0\n0 0 10 0\nITEM: ATOMS id x y z\n1 1 2 3\n";
+        }
+        std::vector<double> xyz(3);
+        CHECK_THROWS(LAMMPSDumpTrajectory(path).read(0, xyz.data()));
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(FrameIndex::sidecar_path(path));
+}
+
+TEST_CASE("TestExtendedXYZTrajectory")
+{
+    auto path = (std::filesystem::temp_directory_path() / "molcpp_test_extended.xyz").string();
+    std::filesystem::remove(FrameIndex::sidecar_path(path));
+    {
+        std::ofstream file(path);
+        file << "2\nLattice=\"10 0 0 1 11 0 2 3 12\" Properties=species:S:1:charge:R:1:pos:R:3 pbc=\"T T T\"\n";
+        file << "O -0.8 0.0 1.0 2.0\nH 0.4 3.0 4.0 5.0\n";
+        file << "2\nplain comment\nO 0.5 1.5 2.5\nH -3.0 -4.0 -5.0\n\n";
+    }
+
+    SUBCASE("test_read")
+    {
+        ExtendedXYZTrajectory trajectory(path);
+        CHECK(trajectory.n_frames() == 2);
+        CHECK(trajectory.n_atoms() == 2);
+
+        // lattice vectors are the rows of Lattice
+        xt::xarray<double> xyz = xt::zeros<double>({2, 3});
+        Box box = trajectory.read(0, xyz.data());
+        CHECK(box == Box({{10, 1, 2}, {0, 11, 3}, {0, 0, 12}}));
+        CHECK(xyz == xt::xarray<double>{{0, 1, 2}, {3, 4, 5}});
+
+        box = trajectory.read(1, xyz.data());
+        CHECK(box.get_style() == Box::FREE);
+        CHECK(xyz == xt::xarray<double>{{0.5, 1.5, 2.5}, {-3, -4, -5}});
+
+        CHECK(ExtendedXYZTrajectory(path, {4}).read_positions(0, 2, {2}) == trajectory.read_positions(0, 2));
+    }
+
+    SUBCASE("test_incomplete")
+    {
+        {
+            std::ofstream file(path, std::ios::app);
+            file << "2\nmissing an atom\nO 0.0 0.0 0.0\n";
+        }
+        CHECK_THROWS(ExtendedXYZTrajectory(path));
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(FrameIndex::sidecar_path(path));
+}
+
+/// Write a little-endian DCD file with a unit cell, as written by LAMMPS
+static void write_dcd(const std::string &path, const std::vector<std::vector<float>> &frames, const double cell[6])
+{
+    std::ofstream file(path, std::ios::binary);
+    auto write_int = [&](int32_t value) { file.write(reinterpret_cast<const char *>(&value), sizeof(value)); };
+    const auto n_atoms = static_cast<int32_t>(frames[0].size() / 3);
+
+    int32_t control[20] = {};
+    control[0] = static_cast<int32_t>(frames.size());
+    control[10] = 1;
+    control[19] = 24;
+    write_int(84);
+    file.write("CORD", 4);
+    for (auto value : control)
+    {
+        write_int(value);
+    }
+    write_int(84);
+    write_int(84);
+    write_int(1);
+    file.write(std::string(80, ' ').data(), 80);
+    write_int(84);
+    write_int(4);
+    write_int(n_atoms);
+    write_int(4);
+
+    for (const auto &frame : frames)
+    {
+        write_int(48);
+        file.write(reinterpret_cast<const char *>(cell), 48);
+        write_int(48);
+        for (size_t d = 0; d < 3; d++)
+        {
+            write_int(4 * n_atoms);
+            for (int32_t i = 0; i < n_atoms; i++)
+            {
+                file.write(reinterpret_cast<const char *>(&frame[3 * i + d]), sizeof(float));
+            }
+            write_int(4 * n_atoms);
+        }
+    }
+}
+
+TEST_CASE("TestDCDTrajectory")
+{
+    auto path = (std::filesystem::temp_directory_path() / "molcpp_test.dcd").string();
+    std::vector<std::vector<float>> frames = {{0, 1, 2, 3, 4, 5}, {6, 7, 8, 9, 10, 11}, {-1, -2, -3, -4, -5, -6}};
+
+    SUBCASE("test_read")
+    {
+        // A, cos(gamma), B, cos(beta), cos(alpha), C
+        const double cell[6] = {10, 0.5, 11, 0, 0, 12};
+        write_dcd(path, frames, cell);
+
+        DCDTrajectory trajectory(path);
+        CHECK(trajectory.n_frames() == 3);
+        CHECK(trajectory.n_atoms() == 2);
+
+        std::vector<double> xyz(6);
+        for (size_t frame = 0; frame < 3; frame++)
+        {
+            Box box = trajectory.read(frame, xyz.data());
+            CHECK(std::equal(xyz.begin(), xyz.end(), frames[frame].begin()));
+            CHECK(xt::allclose(box.get_lengths(), Vec3{10, 11, 12}));
+            CHECK(xt::allclose(box.get_angles(), Vec3{90, 90, 60}));
+        }
+        CHECK(trajectory.read_positions(1, 3, {2})(1, 1, 2) == -6);
+        CHECK_THROWS(trajectory.read(3, xyz.data()));
+    }
+
+    SUBCASE("test_angles_in_degrees")
+    {
+        const double cell[6] = {10, 90, 10, 90, 90, 10};
+        write_dcd(path, frames, cell);
+        std::vector<double> xyz(6);
+        CHECK(DCDTrajectory(path).read(0, xyz.data()) == Box({10, 10, 10}));
+    }
+
+    SUBCASE("test_invalid")
+    {
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << std::string(200, 'x');
+        }
+        CHECK_THROWS(DCDTrajectory(path));
+    }
+
+    std::filesystem::remove(path);
+}
+
+// Two frames of 12 atoms, compressed by GROMACS' algorithm at a precision of
+// 1000, with a cubic box of 3 nm
+static const unsigned char XTC_FRAMES[] = {
+    0x00, 0x00, 0x07, 0xcb, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x44, 0x7a, 0x00, 0x00, 0x00, 0x00, 0x03, 0xac,
+    0x00, 0x00, 0x04, 0x2e, 0x00, 0x00, 0x01, 0xb8, 0x00, 0x00, 0x0c, 0x62, 0x00, 0x00, 0x07, 0xf8,
+    0x00, 0x00, 0x07, 0x3a, 0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x00, 0x28, 0xec, 0x20, 0xb1, 0x0a,
+    0x9c, 0x98, 0xe8, 0x4a, 0x03, 0x42, 0x19, 0xae, 0x35, 0x10, 0xc4, 0xc7, 0x42, 0x50, 0x1a, 0x11,
+    0xc0, 0x9f, 0xf0, 0xf8, 0x26, 0x3a, 0x12, 0x80, 0xd0, 0x85, 0xae, 0x71, 0xbb, 0x61, 0x31, 0xd0,
+    0x94, 0x06, 0x84, 0x00, 0x00, 0x00, 0x07, 0xcb, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x0a,
+    0x3f, 0x00, 0x00, 0x00, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x44, 0x7a, 0x00, 0x00,
+    0x00, 0x00, 0x03, 0xde, 0x00, 0x00, 0x04, 0x2e, 0x00, 0x00, 0x01, 0xb8, 0x00, 0x00, 0x0c, 0x94,
+    0x00, 0x00, 0x07, 0xf8, 0x00, 0x00, 0x07, 0x3a, 0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x00, 0x28,
+    0xec, 0x20, 0xb1, 0x0a, 0x9c, 0x98, 0xe8, 0x4a, 0x03, 0x42, 0x19, 0xae, 0x35, 0x10, 0xc4, 0xc7,
+    0x42, 0x50, 0x1a, 0x11, 0xc0, 0x9f, 0xf0, 0xf8, 0x26, 0x3a, 0x12, 0x80, 0xd0, 0x85, 0xae, 0x71,
+    0xbb, 0x61, 0x31, 0xd0, 0x94, 0x06, 0x84, 0x00};
+
+TEST_CASE("TestXTCTrajectory")
+{
+    auto path = (std::filesystem::temp_directory_path() / "molcpp_test.xtc").string();
+    std::filesystem::remove(FrameIndex::sidecar_path(path));
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(XTC_FRAMES), sizeof(XTC_FRAMES));
+    }
+
+    xt::xarray<double> expected = {1,    2,    0.5,  1.07, 1.97, 0.47, 0.94, 2.04, 0.44, 1.7,  1.7,  0.95,
+                                   1.77, 1.67, 0.92, 1.64, 1.74, 0.89, 2.4,  1.4,  1.4,  2.47, 1.37, 1.37,
+                                   2.34, 1.44, 1.34, 3.1,  1.1,  1.85, 3.17, 1.07, 1.82, 3.04, 1.14, 1.79};
+    expected.reshape({12, 3});
+
+    SUBCASE("test_read")
+    {
+        XTCTrajectory trajectory(path);
+        CHECK(trajectory.n_frames() == 2);
+        CHECK(trajectory.n_atoms() == 12);
+        CHECK(trajectory.get_step(1) == 10);
+        CHECK(trajectory.get_time(1) == 0.5);
+
+        xt::xarray<double> xyz = xt::zeros<double>({12, 3});
+        Box box = trajectory.read(0, xyz.data());
+        CHECK(box == Box({3, 3, 3}));
+        CHECK(xt::allclose(xyz, expected, 0, 1e-6));
+
+        // only the x coordinates move in the second frame
+        trajectory.read(1, xyz.data());
+        xt::view(expected, xt::all(), 0) += 0.05;
+        CHECK(xt::allclose(xyz, expected, 0, 1e-6));
+
+        CHECK(trajectory.read_positions(0, 2, {2}) == trajectory.read_positions(0, 2));
+    }
+
+    SUBCASE("test_sidecar_index")
+    {
+        CHECK_FALSE(XTCTrajectory(path).get_index().from_sidecar());
+        CHECK(std::filesystem::exists(FrameIndex::sidecar_path(path)));
+        XTCTrajectory cached(path);
+        CHECK(cached.get_index().from_sidecar());
+        CHECK(cached.n_frames() == 2);
+        CHECK(cached.get_index().begin(1) == sizeof(XTC_FRAMES) / 2);
+
+        // a trajectory which changed is scanned again
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::app);
+            file.write(reinterpret_cast<const char *>(XTC_FRAMES), sizeof(XTC_FRAMES) / 2);
+        }
+        XTCTrajectory appended(path);
+        CHECK_FALSE(appended.get_index().from_sidecar());
+        CHECK(appended.n_frames() == 3);
+    }
+
+    SUBCASE("test_truncated")
+    {
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(XTC_FRAMES), sizeof(XTC_FRAMES) - 20);
+        }
+        CHECK(XTCTrajectory(path).n_frames() == 1);
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(FrameIndex::sidecar_path(path));
+}
@@ -2,6 +2,8 @@
 
 #include "molcpp/types.hpp"
 
+#include <string>
+#include <vector>
 #include <xtensor/xarray.hpp>
 #include <xtensor/xbuilder.hpp>
 
@@ -20,4 +22,76 @@ TEST_CASE("TestProperties") {
         CHECK(prop.get<std::string>("string") == "42");
     }
 
+    SUBCASE("test_keys") {
+
+        Property<int, double, std::string> prop;
+        prop.set(keys::CHARGE, -0.8);
+        prop.set(keys::TYPE, 3);
+        CHECK(prop.get<double>(keys::CHARGE) == -0.8);
+        CHECK(prop.get<int>("type") == 3);
+        CHECK(prop.size() == 2);
+
+        prop.set(keys::CHARGE, 0.5);
+        CHECK(prop.get<double>(keys::CHARGE) == 0.5);
+        CHECK(prop.size() == 2);
+
+        CHECK(prop.find<int>(keys::CHARGE) == nullptr);
+        CHECK_THROWS(prop.get<int>(keys::CHARGE));
+        // a missing key is not inserted
+        CHECK_THROWS(prop.get<int>(keys::MASS));
+        CHECK_FALSE(prop.contains(keys::MASS));
+        CHECK(prop.size() == 2);
+    }
+
+    SUBCASE("test_many_keys") {
+
+        Property<int, double> prop;
+        std::vector<Key> keys;
+        for (int i = 0; i < 100; i++)
+        {
+            keys.emplace_back("test_property_" + std::to_string(i));
+            prop.set(keys.back(), i);
+        }
+        CHECK(prop.size() == 100);
+        // erasing shifts colliding entries back, which must stay reachable
+        for (int i = 0; i < 100; i += 2)
+        {
+            CHECK(prop.erase(keys[i]));
+        }
+        CHECK_FALSE(prop.erase(keys[0]));
+        CHECK(prop.size() == 50);
+        for (int i = 0; i < 100; i++)
+        {
+            CHECK(prop.contains(keys[i]) == (i % 2 == 1));
+            if (i % 2 == 1)
+            {
+                CHECK(prop.get<int>(keys[i]) == i);
+            }
+        }
+    }
+
+    SUBCASE("test_columns") {
+
+        PropertyColumns<int, double> bonds(3);
+        auto order = bonds.add_column<int>(Key("order"));
+        CHECK(order.size() == 3);
+        order[1] = 2;
+        bonds.set_column<double>(Key("length"), {1.0, 1.5, 2.0});
+
+        CHECK(bonds.column<int>(Key("order"))[1] == 2);
+        CHECK(bonds.column<double>(Key("length"))[2] == 2.0);
+        CHECK(bonds.n_columns() == 2);
+        CHECK_THROWS(bonds.column<double>(Key("order")));
+        CHECK_THROWS(bonds.column<int>(keys::MASS));
+        CHECK_THROWS(bonds.set_column<double>(keys::MASS, {1.0}));
+
+        bonds.resize(5);
+        CHECK(bonds.column<int>(Key("order")).size() == 5);
+        CHECK(bonds.column<int>(Key("order"))[1] == 2);
+        CHECK(bonds.column<double>(Key("length"))[4] == 0.0);
+
+        CHECK(bonds.erase(Key("order")));
+        CHECK_FALSE(bonds.contains(Key("order")));
+    }
+
 }